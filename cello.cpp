@@ -27,7 +27,19 @@
 #error "Incorrect use of JUCE cpp file"
 #endif
 
+#include "cello/cello_change_feed.cpp"
+#include "cello/cello_checksum.cpp"
+#include "cello/cello_chunked_store.cpp"
+#include "cello/cello_codec.cpp"
+#include "cello/cello_compact.cpp"
+#include "cello/cello_diff.cpp"
+#include "cello/cello_filter.cpp"
+#include "cello/cello_hash.cpp"
+#include "cello/cello_journal.cpp"
+#include "cello/cello_json.cpp"
+#include "cello/cello_lazy.cpp"
 #include "cello/cello_object.cpp"
 #include "cello/cello_path.cpp"
 #include "cello/cello_query.cpp"
-#include "cello/cello_value.cpp"
\ No newline at end of file
+#include "cello/cello_value.cpp"
+#include "cello/cello_xml_reader.cpp"
\ No newline at end of file
@@ -35,8 +35,26 @@ BEGIN_JUCE_MODULE_DECLARATION
 END_JUCE_MODULE_DECLARATION
 */
 
+#include "cello/cello_change_detection.h"
+#include "cello/cello_change_feed.h"
+#include "cello/cello_checksum.h"
+#include "cello/cello_chunked_store.h"
+#include "cello/cello_codec.h"
+#include "cello/cello_column.h"
+#include "cello/cello_compact.h"
+#include "cello/cello_diff.h"
+#include "cello/cello_filter.h"
+#include "cello/cello_hash.h"
+#include "cello/cello_id.h"
+#include "cello/cello_journal.h"
+#include "cello/cello_json.h"
+#include "cello/cello_lazy.h"
 #include "cello/cello_object.h"
+#include "cello/cello_packed_array.h"
 #include "cello/cello_path.h"
 #include "cello/cello_query.h"
+#include "cello/cello_reflect.h"
 #include "cello/cello_update_source.h"
+#include "cello/cello_validator.h"
 #include "cello/cello_value.h"
+#include "cello/cello_xml_reader.h"
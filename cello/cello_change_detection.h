@@ -0,0 +1,171 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace cello
+{
+
+/**
+ * @brief How a `cello::Value` decides whether a value it's being set to differs
+ * from the value it already holds. Only a change is written into the tree (and
+ * so sent to listeners and recorded by the undo manager). Each Value has its
+ * own; see `Value::setChangeDetection()`.
+ *
+ * - `exact ()`: any difference, using `operator !=`.
+ * - `absolute (epsilon)`: arithmetic values must differ by more than `epsilon`.
+ * - `ulps (maxUlps)`: floating point values must be more than `maxUlps` units in
+ *   the last place apart, a tolerance that scales with their magnitude.
+ * - `always ()`: every set notifies listeners, even if the value hasn't changed.
+ *
+ * Values of types that a tolerance doesn't apply to (strings with `absolute()`,
+ * or integers with `ulps()`) are compared exactly. A NaN is always a change.
+ */
+class ChangeDetection
+{
+public:
+    enum class Mode
+    {
+        exact,
+        absolute,
+        ulps,
+        always
+    };
+
+    static constexpr ChangeDetection exact () { return { Mode::exact, 0.0, 0 }; }
+
+    static constexpr ChangeDetection absolute (double epsilon)
+    {
+        return { Mode::absolute, epsilon, 0 };
+    }
+
+    static constexpr ChangeDetection ulps (std::uint64_t maxUlps)
+    {
+        return { Mode::ulps, 0.0, maxUlps };
+    }
+
+    static constexpr ChangeDetection always () { return { Mode::always, 0.0, 0 }; }
+
+    /**
+     * @return the initial setting for a Value of type `T`: `absolute (0.001)` for
+     * floating point types, `exact ()` for everything else.
+     */
+    template <typename T> static constexpr ChangeDetection defaultFor ()
+    {
+        if constexpr (std::is_floating_point_v<T>)
+            return absolute (0.001);
+        else
+            return exact ();
+    }
+
+    Mode getMode () const { return mode; }
+
+    double getEpsilon () const { return epsilon; }
+
+    std::uint64_t getMaxUlps () const { return maxUlps; }
+
+    /**
+     * @return true if every set should notify listeners, whether or not the
+     * value changed.
+     */
+    bool forcesUpdate () const { return mode == Mode::always; }
+
+    /**
+     * @brief Compare a new value to the current one.
+     *
+     * @return true if `newValue` should replace `current`.
+     */
+    template <typename T> bool isChange (const T& newValue, const T& current) const
+    {
+        if constexpr (std::is_floating_point_v<T>)
+        {
+            if (mode == Mode::absolute)
+                return !(std::fabs (newValue - current) <= epsilon);
+            if (mode == Mode::ulps)
+                return ulpsApart (newValue, current) > maxUlps;
+        }
+        else if constexpr (std::is_arithmetic_v<T> && !std::is_same_v<T, bool>)
+        {
+            if (mode == Mode::absolute)
+                return std::fabs (static_cast<double> (newValue) -
+                                  static_cast<double> (current)) > epsilon;
+        }
+        return newValue != current;
+    }
+
+    /**
+     * @return the number of representable values between `a` and `b` (1 for
+     * adjacent values), or the largest possible distance if either is a NaN.
+     */
+    template <typename F> static std::uint64_t ulpsApart (F a, F b)
+    {
+        static_assert (std::is_floating_point_v<F>);
+        if (a == b)
+            return 0;
+        if (std::isnan (a) || std::isnan (b))
+            return ~std::uint64_t { 0 };
+
+        if constexpr (sizeof (F) == sizeof (std::uint32_t))
+        {
+            const auto orderedA { ordered<std::uint32_t> (a) };
+            const auto orderedB { ordered<std::uint32_t> (b) };
+            return orderedA > orderedB ? orderedA - orderedB : orderedB - orderedA;
+        }
+        else
+        {
+            const auto orderedA { ordered<std::uint64_t> (static_cast<double> (a)) };
+            const auto orderedB { ordered<std::uint64_t> (static_cast<double> (b)) };
+            return orderedA > orderedB ? orderedA - orderedB : orderedB - orderedA;
+        }
+    }
+
+private:
+    constexpr ChangeDetection (Mode mode_, double epsilon_, std::uint64_t maxUlps_)
+    : mode { mode_ }
+    , epsilon { epsilon_ }
+    , maxUlps { maxUlps_ }
+    {
+    }
+
+    /**
+     * @brief Map the bits of a float or double onto an unsigned integer that
+     * sorts the same way the value does, so that neighbouring values map to
+     * neighbouring integers and both zeros map to the same one.
+     */
+    template <typename Bits, typename F> static std::uint64_t ordered (F val)
+    {
+        static_assert (sizeof (Bits) == sizeof (F));
+        Bits bits;
+        std::memcpy (&bits, &val, sizeof (bits));
+        constexpr Bits sign { Bits { 1 } << (sizeof (Bits) * 8 - 1) };
+        const Bits magnitude = bits & static_cast<Bits> (~sign);
+        return (bits & sign) != 0 ? sign - magnitude : sign + magnitude;
+    }
+
+    Mode mode;
+    double epsilon;
+    std::uint64_t maxUlps;
+};
+
+} // namespace cello
@@ -0,0 +1,282 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "JuceHeader.h"
+
+#include "cello_change_feed.h"
+#include "cello_lazy.h"
+#include "cello_object.h"
+
+namespace cello
+{
+
+ChangeFeed::Scalar ChangeFeed::Scalar::fromVar (const juce::var& value)
+{
+    Scalar scalar;
+    if (value.isBool ())
+    {
+        scalar.type     = Type::boolean;
+        scalar.intValue = static_cast<bool> (value) ? 1 : 0;
+    }
+    else if (value.isInt () || value.isInt64 ())
+    {
+        scalar.type     = Type::integer;
+        scalar.intValue = static_cast<juce::int64> (value);
+    }
+    else if (value.isDouble ())
+    {
+        scalar.type        = Type::floating;
+        scalar.doubleValue = static_cast<double> (value);
+    }
+    else if (!value.isVoid ())
+        scalar.type = Type::other;
+
+    return scalar;
+}
+
+class ChangeFeed::Node : public juce::ValueTree::Listener
+{
+public:
+    Node (ChangeFeed& owner, const juce::ValueTree& watched)
+    : feed { owner }
+    , tree { watched }
+    {
+        handle = feed.addNode (this);
+        children.reserve (static_cast<size_t> (tree.getNumChildren ()));
+        for (int i { 0 }; i < tree.getNumChildren (); ++i)
+            children.push_back (std::make_unique<Node> (feed, tree.getChild (i)));
+        tree.addListener (this);
+    }
+
+    ~Node () override
+    {
+        tree.removeListener (this);
+        feed.removeNode (handle);
+    }
+
+    /**
+     * @brief Find the node mirroring `target`, given the trees between our
+     * tree and `target`.
+     */
+    const Node* find (const juce::ValueTree& target) const
+    {
+        if (target == tree)
+            return this;
+
+        const auto parent { target.getParent () };
+        if (!parent.isValid ())
+            return nullptr;
+        const auto* parentNode { find (parent) };
+        if (parentNode == nullptr)
+            return nullptr;
+        const auto index { parent.indexOf (target) };
+        if (!juce::isPositiveAndBelow (index, static_cast<int> (parentNode->children.size ())))
+            return nullptr;
+        return parentNode->children[static_cast<size_t> (index)].get ();
+    }
+
+    // Our listener sees changes to our tree and all of its descendants; the
+    // node mirroring the tree that changed is the one that records it. We keep
+    // mirroring the children that appear when a lazily loaded placeholder is
+    // filled in, but don't record them as changes.
+
+    void valueTreePropertyChanged (juce::ValueTree& changedTree,
+                                   const juce::Identifier& property) override
+    {
+        if (changedTree != tree || LazyTree::isMaterializing ())
+            return;
+
+        Record record;
+        const auto* value { tree.getPropertyPointer (property) };
+        record.type     = (value != nullptr) ? Record::Type::propertyChanged
+                                             : Record::Type::propertyRemoved;
+        record.node     = handle;
+        record.property = feed.getPropertyIndex (property);
+        if (value != nullptr)
+            record.value = Scalar::fromVar (*value);
+        feed.push (record);
+    }
+
+    void valueTreeChildAdded (juce::ValueTree& parentTree, juce::ValueTree& childTree) override
+    {
+        if (parentTree != tree)
+            return;
+
+        const auto index { tree.indexOf (childTree) };
+        auto child { std::make_unique<Node> (feed, childTree) };
+        const auto childHandle { child->handle };
+        children.insert (children.begin () + index, std::move (child));
+
+        if (LazyTree::isMaterializing ())
+            return;
+
+        Record record;
+        record.type     = Record::Type::childAdded;
+        record.node     = handle;
+        record.child    = childHandle;
+        record.newIndex = index;
+        feed.push (record);
+    }
+
+    void valueTreeChildRemoved (juce::ValueTree& parentTree, juce::ValueTree&,
+                                int index) override
+    {
+        if (parentTree != tree)
+            return;
+
+        const auto it { children.begin () + index };
+        Record record;
+        record.type     = Record::Type::childRemoved;
+        record.node     = handle;
+        record.child    = (*it)->handle;
+        record.oldIndex = index;
+        // releases the handles of the removed subtree.
+        children.erase (it);
+        feed.push (record);
+    }
+
+    void valueTreeChildOrderChanged (juce::ValueTree& parentTree, int oldIndex,
+                                     int newIndex) override
+    {
+        if (parentTree != tree)
+            return;
+
+        auto child { std::move (children[static_cast<size_t> (oldIndex)]) };
+        children.erase (children.begin () + oldIndex);
+        children.insert (children.begin () + newIndex, std::move (child));
+
+        Record record;
+        record.type     = Record::Type::childMoved;
+        record.node     = handle;
+        record.child    = children[static_cast<size_t> (newIndex)]->handle;
+        record.oldIndex = oldIndex;
+        record.newIndex = newIndex;
+        feed.push (record);
+    }
+
+    ChangeFeed& feed;
+    juce::ValueTree tree;
+    NodeHandle handle { invalidNode };
+    /// nodes for each of our tree's children, in the same order.
+    std::vector<std::unique_ptr<Node>> children;
+};
+
+static_assert (std::is_trivially_copyable_v<ChangeFeed::Record>,
+               "Records are copied between threads as plain data");
+
+ChangeFeed::ChangeFeed (const Object& object, int capacity)
+: fifo { capacity + 1 }
+, records (static_cast<size_t> (capacity + 1))
+{
+    // AbstractFifo keeps one slot empty to tell full from empty, so we ask for
+    // one more than the requested capacity.
+    root = std::make_unique<Node> (*this, object);
+    jassert (root->handle == rootNode);
+}
+
+ChangeFeed::~ChangeFeed ()
+{
+    root.reset ();
+}
+
+bool ChangeFeed::pop (Record& record)
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToRead (1, start1, size1, start2, size2);
+    if (size1 + size2 == 0)
+        return false;
+
+    record = records[static_cast<size_t> (size1 > 0 ? start1 : start2)];
+    fifo.finishedRead (1);
+    return true;
+}
+
+ChangeFeed::NodeHandle ChangeFeed::getHandle (const juce::ValueTree& tree) const
+{
+    if (!tree.isValid ())
+        return invalidNode;
+
+    const auto* node { root->find (tree) };
+    return (node != nullptr) ? node->handle : invalidNode;
+}
+
+juce::ValueTree ChangeFeed::getTree (NodeHandle handle) const
+{
+    if (handle < nodes.size () && nodes[handle] != nullptr)
+        return nodes[handle]->tree;
+    return {};
+}
+
+ChangeFeed::PropertyIndex ChangeFeed::getPropertyIndex (const juce::Identifier& property)
+{
+    const auto found { propertyIndices.find (property) };
+    if (found != propertyIndices.end ())
+        return found->second;
+
+    const auto index { static_cast<PropertyIndex> (propertyNames.size ()) };
+    propertyNames.push_back (property);
+    propertyIndices.emplace (property, index);
+    return index;
+}
+
+juce::Identifier ChangeFeed::getPropertyName (PropertyIndex index) const
+{
+    if (index < propertyNames.size ())
+        return propertyNames[index];
+    return {};
+}
+
+ChangeFeed::NodeHandle ChangeFeed::addNode (Node* node)
+{
+    if (!freeHandles.empty ())
+    {
+        const auto handle { freeHandles.back () };
+        freeHandles.pop_back ();
+        nodes[handle] = node;
+        return handle;
+    }
+    nodes.push_back (node);
+    return static_cast<NodeHandle> (nodes.size () - 1);
+}
+
+void ChangeFeed::removeNode (NodeHandle handle)
+{
+    jassert (handle < nodes.size ());
+    nodes[handle] = nullptr;
+    freeHandles.push_back (handle);
+}
+
+void ChangeFeed::push (const Record& record)
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite (1, start1, size1, start2, size2);
+    if (size1 + size2 == 0)
+    {
+        overflowed.store (true);
+        return;
+    }
+    records[static_cast<size_t> (size1 > 0 ? start1 : start2)] = record;
+    fifo.finishedWrite (1);
+}
+
+} // namespace cello
+
+#if RUN_UNIT_TESTS
+#include "test/test_cello_change_feed.inl"
+#endif
@@ -0,0 +1,273 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <juce_data_structures/juce_data_structures.h>
+
+#include <map>
+
+namespace cello
+{
+class Object;
+
+/**
+ * @class ChangeFeed
+ * @brief Capture the property and child changes made to an Object (and all of
+ * its descendants) into a preallocated lock-free single-producer/single-consumer
+ * queue, so that another thread (e.g. an audio or worker thread) can react to
+ * model changes without locking or allocating.
+ *
+ * The producer is whichever thread modifies the tree (usually the message thread);
+ * records are pushed from inside the ValueTree listener callbacks. Exactly one
+ * consumer thread may call `pop()` or `drain()`.
+ *
+ * If the consumer falls behind and the queue fills up, new records are dropped
+ * and the feed is marked as having overflowed. When `checkAndClearOverflow()`
+ * returns true, the consumer should ask the writer thread to resynchronize it
+ * with the current state of the tree.
+ *
+ * Records are plain data: trees and property names are identified by small
+ * integers instead of by `juce::ValueTree` or `juce::Identifier`. The feed keeps
+ * a handle for every tree below the watched Object, so resolving the tree of a
+ * change costs one check per level of depth rather than a search. A consumer
+ * that needs to know which tree a handle refers to should keep its own table
+ * indexed by handle: fill it in from `getHandle()` before it starts consuming,
+ * then keep it current from the `childAdded` and `childRemoved` records. In the
+ * same way, look up the `PropertyIndex` of each property you're interested in
+ * with `getPropertyIndex()` before consuming, and compare records against those.
+ */
+class ChangeFeed
+{
+public:
+    /**
+     * @brief A compact handle identifying a tree in this feed. The tree of the
+     * Object that the feed was created from is always handle 0. A handle is
+     * released when its tree is removed from the watched tree, and may be
+     * reused by a tree added later; the consumer will always see the
+     * `childRemoved` record before the `childAdded` record that reuses it.
+     */
+    using NodeHandle = juce::uint32;
+
+    /**
+     * @brief A compact index identifying a property name in this feed;
+     * see `getPropertyIndex()`.
+     */
+    using PropertyIndex = juce::uint32;
+
+    static constexpr NodeHandle rootNode { 0 };
+    static constexpr NodeHandle invalidNode { std::numeric_limits<NodeHandle>::max () };
+    static constexpr PropertyIndex invalidProperty {
+        std::numeric_limits<PropertyIndex>::max ()
+    };
+
+    /**
+     * @brief Plain copy of a property value. Booleans, integers and floating
+     * point values are copied directly; any other type of var (strings, arrays,
+     * binary data, etc.) is marked as `other`, and the consumer will need to look
+     * up the current value itself if it needs it.
+     */
+    struct Scalar
+    {
+        enum class Type : juce::uint8
+        {
+            none,      ///< property was removed or is void
+            boolean,   ///< stored in `intValue` as 0/1
+            integer,   ///< int or int64, stored in `intValue`
+            floating,  ///< stored in `doubleValue`
+            other      ///< not representable as a POD value
+        };
+
+        static Scalar fromVar (const juce::var& value);
+
+        /**
+         * @brief Convert the stored value to an arithmetic type.
+         * @return T, or a default-constructed T if the value is `none` or `other`.
+         */
+        template <typename T> T get () const
+        {
+            static_assert (std::is_arithmetic_v<T>, "Scalar only holds arithmetic values");
+            if (type == Type::floating)
+                return static_cast<T> (doubleValue);
+            return static_cast<T> (intValue);
+        }
+
+        Type type { Type::none };
+        juce::int64 intValue { 0 };
+        double doubleValue { 0.0 };
+    };
+
+    /**
+     * @brief One change to the tree.
+     */
+    struct Record
+    {
+        enum class Type : juce::uint8
+        {
+            propertyChanged,
+            propertyRemoved,
+            childAdded,
+            childRemoved,
+            childMoved
+        };
+
+        Type type { Type::propertyChanged };
+        /// tree whose property changed, or the parent tree for child changes.
+        NodeHandle node { invalidNode };
+        /// the child that was added/removed/moved (`invalidNode` for properties)
+        NodeHandle child { invalidNode };
+        /// property that changed (`invalidProperty` for child changes)
+        PropertyIndex property { invalidProperty };
+        /// new value of the property.
+        Scalar value;
+        /// child index before the change; -1 for added children.
+        int oldIndex { -1 };
+        /// child index after the change; -1 for removed children.
+        int newIndex { -1 };
+    };
+
+    /**
+     * @brief Start capturing changes made to `object` and its descendants.
+     *
+     * @param object Object to watch.
+     * @param capacity maximum number of records that may be waiting for the
+     *        consumer before we start dropping them.
+     */
+    ChangeFeed (const Object& object, int capacity = 1024);
+
+    ~ChangeFeed ();
+
+    /**
+     * @name Consumer thread
+     */
+    ///@{
+    /**
+     * @brief Pop the oldest waiting record, if there is one.
+     *
+     * @param record filled in with the next change.
+     * @return false if the queue was empty.
+     */
+    bool pop (Record& record);
+
+    /**
+     * @brief Pop every waiting record, passing each in turn to `fn`,
+     * which must accept a `const Record&`.
+     *
+     * @return number of records handled.
+     */
+    template <typename Fn> int drain (Fn&& fn)
+    {
+        int count { 0 };
+        Record record;
+        while (pop (record))
+        {
+            fn (static_cast<const Record&> (record));
+            ++count;
+        }
+        return count;
+    }
+
+    /**
+     * @brief Test whether records have been dropped because the queue was full
+     * since the last time this was called.
+     */
+    bool checkAndClearOverflow () noexcept { return overflowed.exchange (false); }
+
+    /**
+     * @return number of records waiting to be consumed.
+     */
+    int getNumReady () const noexcept { return fifo.getNumReady (); }
+    ///@}
+
+    /**
+     * @name Writer thread
+     */
+    ///@{
+    /**
+     * @brief Get the handle used in records for `tree`, which must be the
+     * watched tree or one of its descendants. This walks from `tree` up to the
+     * watched tree, so it's meant for setting up a consumer rather than for
+     * use while handling each record.
+     *
+     * @param tree
+     * @return NodeHandle, `invalidNode` if `tree` isn't being watched.
+     */
+    NodeHandle getHandle (const juce::ValueTree& tree) const;
+
+    /**
+     * @brief Look up the tree that currently belongs to a handle.
+     *
+     * @param handle
+     * @return juce::ValueTree, invalid if the handle isn't in use.
+     */
+    juce::ValueTree getTree (NodeHandle handle) const;
+
+    /**
+     * @brief Get (assigning if needed) the index used in records for a
+     * property name. Indices are assigned in order starting from 0.
+     *
+     * @param property
+     * @return PropertyIndex
+     */
+    PropertyIndex getPropertyIndex (const juce::Identifier& property);
+
+    /**
+     * @brief Look up the property name that belongs to an index from a record.
+     *
+     * @param index
+     * @return juce::Identifier, null if the index is unknown.
+     */
+    juce::Identifier getPropertyName (PropertyIndex index) const;
+    ///@}
+
+private:
+    /// listens to one tree, mirroring its children.
+    class Node;
+
+    void push (const Record& record);
+
+    NodeHandle addNode (Node* node);
+    void removeNode (NodeHandle handle);
+
+private:
+    /// nodes currently using each handle (nullptr for unused handles).
+    std::vector<Node*> nodes;
+
+    /// handles released by removed trees, ready to be reused.
+    std::vector<NodeHandle> freeHandles;
+
+    /// mirror of the watched tree; declared after the handle tables, which it uses.
+    std::unique_ptr<Node> root;
+
+    /// property names we've handed out indices for; the position is the index.
+    std::vector<juce::Identifier> propertyNames;
+    std::map<juce::Identifier, PropertyIndex> propertyIndices;
+
+    /// read/write positions in the `records` ring.
+    juce::AbstractFifo fifo;
+
+    /// preallocated storage for the records.
+    std::vector<Record> records;
+
+    /// set by the producer when a record had to be dropped.
+    std::atomic<bool> overflowed { false };
+};
+
+} // namespace cello
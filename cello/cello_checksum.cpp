@@ -0,0 +1,227 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "JuceHeader.h"
+
+#include "cello_checksum.h"
+
+#if (defined(__x86_64__) || defined(_M_X64)) && !defined(CELLO_CRC32C_SOFTWARE)
+#define CELLO_CRC32C_SSE42 1
+#include <nmmintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define CELLO_TARGET_SSE42
+#else
+#include <cpuid.h>
+#define CELLO_TARGET_SSE42 __attribute__ ((target ("sse4.2")))
+#endif
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32) && !defined(CELLO_CRC32C_SOFTWARE)
+#define CELLO_CRC32C_ARM 1
+#include <arm_acle.h>
+#endif
+
+namespace
+{
+// reflected Castagnoli polynomial
+constexpr juce::uint32 polynomial { 0x82f63b78 };
+
+const char footerMagic[] { 'C', 'L', 'C', 'K' };
+
+/**
+ * @brief Lookup tables for slicing-by-8: table[0] is the usual bytewise table,
+ * and table[n] advances a byte through n more zero bytes.
+ */
+struct Tables
+{
+    Tables ()
+    {
+        for (juce::uint32 i { 0 }; i < 256; ++i)
+        {
+            auto crc { i };
+            for (int bit { 0 }; bit < 8; ++bit)
+                crc = (crc >> 1) ^ ((crc & 1) != 0 ? polynomial : 0);
+            table[0][i] = crc;
+        }
+        for (size_t n { 1 }; n < 8; ++n)
+        {
+            for (size_t i { 0 }; i < 256; ++i)
+                table[n][i] = (table[n - 1][i] >> 8) ^ table[0][table[n - 1][i] & 0xff];
+        }
+    }
+
+    juce::uint32 table[8][256];
+};
+
+juce::uint32 calculateSoftware (const juce::uint8* data, size_t size, juce::uint32 crc)
+{
+    static const Tables tables;
+    const auto& t { tables.table };
+
+    for (; size >= 8; size -= 8, data += 8)
+    {
+        const auto low { crc ^ juce::ByteOrder::littleEndianInt (data) };
+        const auto high { juce::ByteOrder::littleEndianInt (data + 4) };
+        crc = t[7][low & 0xff] ^ t[6][(low >> 8) & 0xff] ^ t[5][(low >> 16) & 0xff] ^
+              t[4][low >> 24] ^ t[3][high & 0xff] ^ t[2][(high >> 8) & 0xff] ^
+              t[1][(high >> 16) & 0xff] ^ t[0][high >> 24];
+    }
+    for (; size > 0; --size, ++data)
+        crc = (crc >> 8) ^ t[0][(crc ^ *data) & 0xff];
+    return crc;
+}
+
+#if CELLO_CRC32C_SSE42
+bool hasHardwareSupport ()
+{
+    static const bool supported = [] ()
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        int info[4] {};
+        __cpuid (info, 1);
+        return (info[2] & (1 << 20)) != 0;
+#else
+        unsigned int eax {}, ebx {}, ecx {}, edx {};
+        return __get_cpuid (1, &eax, &ebx, &ecx, &edx) != 0 && (ecx & bit_SSE4_2) != 0;
+#endif
+    }();
+    return supported;
+}
+
+CELLO_TARGET_SSE42 juce::uint32 calculateHardware (const juce::uint8* data, size_t size,
+                                                   juce::uint32 crc)
+{
+    juce::uint64 crc64 { crc };
+    for (; size >= 8; size -= 8, data += 8)
+    {
+        juce::uint64 word;
+        std::memcpy (&word, data, sizeof (word));
+        crc64 = _mm_crc32_u64 (crc64, word);
+    }
+    crc = static_cast<juce::uint32> (crc64);
+    for (; size > 0; --size, ++data)
+        crc = _mm_crc32_u8 (crc, *data);
+    return crc;
+}
+#elif CELLO_CRC32C_ARM
+bool hasHardwareSupport ()
+{
+    return true;
+}
+
+juce::uint32 calculateHardware (const juce::uint8* data, size_t size, juce::uint32 crc)
+{
+    for (; size >= 8; size -= 8, data += 8)
+    {
+        juce::uint64 word;
+        std::memcpy (&word, data, sizeof (word));
+        crc = __crc32cd (crc, word);
+    }
+    for (; size > 0; --size, ++data)
+        crc = __crc32cb (crc, *data);
+    return crc;
+}
+#else
+bool hasHardwareSupport ()
+{
+    return false;
+}
+
+juce::uint32 calculateHardware (const juce::uint8* data, size_t size, juce::uint32 crc)
+{
+    return calculateSoftware (data, size, crc);
+}
+#endif
+} // namespace
+
+namespace cello
+{
+
+juce::uint32 Crc32c::calculate (const void* data, size_t size, juce::uint32 crc)
+{
+    const auto* bytes { static_cast<const juce::uint8*> (data) };
+    crc = ~crc;
+    crc = hasHardwareSupport () ? calculateHardware (bytes, size, crc)
+                                : calculateSoftware (bytes, size, crc);
+    return ~crc;
+}
+
+bool Crc32c::isHardwareAccelerated ()
+{
+    return hasHardwareSupport ();
+}
+
+ChecksumOutputStream::ChecksumOutputStream (juce::OutputStream& destStream)
+: dest { destStream }
+{
+}
+
+bool ChecksumOutputStream::writeFooter ()
+{
+    // footer: checksum, size of the data, magic number.
+    return dest.writeInt (static_cast<int> (crc)) &&
+           dest.writeInt64 (static_cast<juce::int64> (bytesWritten)) &&
+           dest.write (footerMagic, sizeof (footerMagic));
+}
+
+juce::int64 ChecksumOutputStream::verify (const void* data, size_t size, bool footerExpected)
+{
+    const auto* bytes { static_cast<const juce::uint8*> (data) };
+    if (size < footerSize || std::memcmp (bytes + size - sizeof (footerMagic), footerMagic,
+                                          sizeof (footerMagic)) != 0)
+        return footerExpected ? -1 : static_cast<juce::int64> (size);
+
+    const auto* footer { bytes + size - footerSize };
+    const auto dataSize { static_cast<juce::uint64> (
+        juce::ByteOrder::littleEndianInt64 (footer + 4)) };
+    if (dataSize != size - footerSize ||
+        Crc32c::calculate (bytes, static_cast<size_t> (dataSize)) !=
+            juce::ByteOrder::littleEndianInt (footer))
+        return -1;
+
+    return static_cast<juce::int64> (dataSize);
+}
+
+void ChecksumOutputStream::flush ()
+{
+    dest.flush ();
+}
+
+bool ChecksumOutputStream::setPosition (juce::int64)
+{
+    // the checksum can only be calculated over data written in order.
+    return false;
+}
+
+juce::int64 ChecksumOutputStream::getPosition ()
+{
+    return static_cast<juce::int64> (bytesWritten);
+}
+
+bool ChecksumOutputStream::write (const void* data, size_t size)
+{
+    crc = Crc32c::calculate (data, size, crc);
+    bytesWritten += size;
+    return dest.write (data, size);
+}
+
+} // namespace cello
+
+#if RUN_UNIT_TESTS
+#include "test/test_cello_checksum.inl"
+#endif
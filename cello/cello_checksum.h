@@ -0,0 +1,103 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+namespace cello
+{
+
+/**
+ * @class Crc32c
+ * @brief CRC-32C (Castagnoli) checksums, calculated with the CPU's CRC
+ * instructions (SSE 4.2 on x86-64, the CRC extension on ARMv8) when they're
+ * available, and with a table-driven implementation otherwise.
+ */
+class Crc32c
+{
+public:
+    /**
+     * @brief Calculate the checksum of a block of data.
+     *
+     * @param data
+     * @param size
+     * @param crc checksum of any preceding data, to calculate a checksum
+     * incrementally.
+     * @return juce::uint32
+     */
+    static juce::uint32 calculate (const void* data, size_t size, juce::uint32 crc = 0);
+
+    /**
+     * @return true if checksums are calculated with CPU instructions.
+     */
+    static bool isHardwareAccelerated ();
+};
+
+/**
+ * @class ChecksumOutputStream
+ * @brief Passes data through to another stream, keeping a running checksum of
+ * it so that `writeFooter()` can append a footer that `verify()` checks when
+ * the data is read back.
+ */
+class ChecksumOutputStream : public juce::OutputStream
+{
+public:
+    /// size in bytes of the footer that `writeFooter()` adds.
+    static constexpr size_t footerSize { 16 };
+
+    /**
+     * @param destStream stream to write to; must outlive this object.
+     */
+    explicit ChecksumOutputStream (juce::OutputStream& destStream);
+
+    /**
+     * @brief Append the checksum and size of everything written so far.
+     *
+     * @return false if writing failed.
+     */
+    bool writeFooter ();
+
+    /**
+     * @brief Check the data of a file that may have been written through one
+     * of these streams.
+     *
+     * @param data
+     * @param size
+     * @param footerExpected true if the data must have a footer, so a missing
+     * one means the data is incomplete; false to also accept data that was
+     * written without one.
+     * @return size of the data preceding the footer if the checksum matches;
+     * `size` if the data has no footer and `footerExpected` is false; or -1 if
+     * the data is corrupt or is missing its footer.
+     */
+    static juce::int64 verify (const void* data, size_t size, bool footerExpected);
+
+    void flush () override;
+    bool setPosition (juce::int64 newPosition) override;
+    juce::int64 getPosition () override;
+    bool write (const void* data, size_t size) override;
+
+private:
+    juce::OutputStream& dest;
+    juce::uint32 crc { 0 };
+    juce::uint64 bytesWritten { 0 };
+};
+
+} // namespace cello
@@ -0,0 +1,434 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "JuceHeader.h"
+
+#include "cello_chunked_store.h"
+#include "cello_hash.h"
+#include "cello_lazy.h"
+
+namespace
+{
+const juce::Identifier manifestType { "ChunkedStore" };
+const juce::Identifier formatProperty { "format" };
+const juce::Identifier depthProperty { "chunkDepth" };
+const juce::Identifier chunkProperty { "_chunk" };
+const juce::Identifier hashProperty { "_hash" };
+
+juce::File getManifestFile (const juce::File& directory)
+{
+    return directory.getChildFile ("manifest");
+}
+
+juce::File getChunkFile (const juce::File& directory, const juce::String& id)
+{
+    return directory.getChildFile (id + ".chunk");
+}
+
+juce::ValueTree readManifest (const juce::File& directory)
+{
+    const auto file { getManifestFile (directory) };
+    if (!file.existsAsFile ())
+        return {};
+
+    auto manifest { cello::Object::load (file, cello::Object::FileFormat::binary) };
+    if (!manifest.hasType (manifestType) || manifest.getNumChildren () != 1)
+        return {};
+    return manifest;
+}
+
+/**
+ * @brief Remove the chunk ids and hashes from the placeholders in a manifest's
+ * tree, adding them to `ids` and `hashes` in order (a missing hash is 0).
+ */
+void extractIds (juce::ValueTree node, int depth, int chunkDepth, juce::StringArray& ids,
+                 std::vector<juce::uint64>& hashes)
+{
+    if (depth == chunkDepth)
+    {
+        ids.add (node[chunkProperty].toString ());
+        const auto hash { static_cast<juce::int64> (node[hashProperty]) };
+        hashes.push_back (static_cast<juce::uint64> (hash));
+        node.removeProperty (chunkProperty, nullptr);
+        node.removeProperty (hashProperty, nullptr);
+        return;
+    }
+    for (auto child : node)
+        extractIds (child, depth + 1, chunkDepth, ids, hashes);
+}
+
+/**
+ * @brief Get the trees from `root` down to `node`, or an empty list if `node`
+ * isn't part of `root`'s tree.
+ */
+std::vector<juce::ValueTree> getLineage (juce::ValueTree node, const juce::ValueTree& root)
+{
+    std::vector<juce::ValueTree> lineage;
+    for (; node.isValid (); node = node.getParent ())
+    {
+        lineage.push_back (node);
+        if (node == root)
+        {
+            std::reverse (lineage.begin (), lineage.end ());
+            return lineage;
+        }
+    }
+    return {};
+}
+} // namespace
+
+namespace cello
+{
+
+ChunkedStore::ChunkedStore (const Object& object, juce::File directory_, int chunkDepth_,
+                            Object::FileFormat format_)
+: tree { object }
+, directory { directory_ }
+, chunkDepth { juce::jmax (1, chunkDepth_) }
+, format { format_ }
+{
+    // these formats each need a file of their own.
+    jassert (format != Object::FileFormat::journaled && format != Object::FileFormat::lazy);
+    jassert (chunkDepth_ > 0);
+
+    updateChunks ();
+    adoptManifest ();
+    tree.addListener (this);
+}
+
+ChunkedStore::~ChunkedStore ()
+{
+    tree.removeListener (this);
+}
+
+juce::Result ChunkedStore::save ()
+{
+    if (!isDirty ())
+        return juce::Result::ok ();
+
+    auto res { directory.createDirectory () };
+    if (res.failed ())
+        return res;
+
+    // write each changed chunk to a new file...
+    juce::StringArray ids;
+    std::vector<juce::uint64> hashes;
+    hashes.reserve (chunks.size ());
+    juce::StringArray written;
+    for (const auto& chunk : chunks)
+    {
+        if (!chunk.dirty && chunk.id.isNotEmpty ())
+        {
+            ids.add (chunk.id);
+            hashes.push_back (chunk.hash);
+            continue;
+        }
+
+        const auto id { juce::Uuid ().toDashedString () };
+        const auto file { getChunkFile (directory, id) };
+        const Object chunkObject { chunk.tree.getType ().toString (), chunk.tree };
+        res = chunkObject.save (file, format);
+        if (res.failed ())
+            break;
+        ids.add (id);
+        hashes.push_back (hashSaved (chunk, file));
+        written.add (id);
+    }
+
+    // ...then switch to them by replacing the manifest.
+    if (res.wasOk ())
+    {
+        juce::ValueTree manifest { manifestType };
+        manifest.setProperty (formatProperty, static_cast<int> (format), nullptr);
+        manifest.setProperty (depthProperty, chunkDepth, nullptr);
+        int nextChunk { 0 };
+        manifest.appendChild (makeSpine (tree, 0, ids, hashes, nextChunk), nullptr);
+        const Object manifestObject { manifestType.toString (), manifest };
+        res = manifestObject.save (getManifestFile (directory), Object::FileFormat::binary);
+    }
+
+    if (res.failed ())
+    {
+        // the previous manifest is still intact; discard the new chunks.
+        for (const auto& id : written)
+            getChunkFile (directory, id).deleteFile ();
+        return res;
+    }
+
+    for (size_t i { 0 }; i < chunks.size (); ++i)
+    {
+        auto& chunk { chunks[i] };
+        const auto& id { ids[static_cast<int> (i)] };
+        if (chunk.id.isNotEmpty () && chunk.id != id)
+            obsoleteIds.add (chunk.id);
+        chunk.id    = id;
+        chunk.hash  = hashes[i];
+        chunk.dirty = false;
+    }
+    spineDirty = false;
+
+    for (const auto& id : obsoleteIds)
+    {
+        if (id.isNotEmpty ())
+            getChunkFile (directory, id).deleteFile ();
+    }
+    obsoleteIds.clear ();
+    return juce::Result::ok ();
+}
+
+bool ChunkedStore::isDirty () const
+{
+    return spineDirty || getNumDirtyChunks () > 0;
+}
+
+int ChunkedStore::getNumDirtyChunks () const
+{
+    return static_cast<int> (std::count_if (chunks.begin (), chunks.end (),
+                                            [] (const Chunk& chunk) { return chunk.dirty; }));
+}
+
+juce::ValueTree ChunkedStore::load (juce::File directory)
+{
+    const auto manifest { readManifest (directory) };
+    if (!manifest.isValid ())
+        return {};
+
+    const auto format { static_cast<Object::FileFormat> (
+        static_cast<int> (manifest[formatProperty])) };
+    const auto chunkDepth { static_cast<int> (manifest[depthProperty]) };
+    auto root { manifest.getChild (0).createCopy () };
+
+    // replace each placeholder with the contents of its chunk file.
+    std::function<bool (juce::ValueTree, int)> loadChunks = [&] (juce::ValueTree node, int depth)
+    {
+        for (int i { 0 }; i < node.getNumChildren (); ++i)
+        {
+            auto child { node.getChild (i) };
+            if (depth + 1 < chunkDepth)
+            {
+                if (!loadChunks (child, depth + 1))
+                    return false;
+                continue;
+            }
+
+            const auto file { getChunkFile (directory, child[chunkProperty].toString ()) };
+            if (!file.existsAsFile ())
+                return false;
+            auto chunk { Object::load (file, format) };
+            if (!chunk.hasType (child.getType ()))
+                return false;
+            node.removeChild (i, nullptr);
+            node.addChild (chunk, i, nullptr);
+        }
+        return true;
+    };
+
+    if (chunkDepth < 1 || !loadChunks (root, 0))
+        return {};
+    return root;
+}
+
+void ChunkedStore::updateChunks ()
+{
+    std::vector<Chunk> updated;
+    size_t hint { 0 };
+    std::function<void (const juce::ValueTree&, int)> collect =
+        [&] (const juce::ValueTree& node, int depth)
+    {
+        if (depth < chunkDepth)
+        {
+            for (const auto& child : node)
+                collect (child, depth + 1);
+            return;
+        }
+
+        // look for an existing chunk, starting after the last one we found, since
+        // the order of chunks doesn't usually change.
+        for (size_t i { 0 }; i < chunks.size (); ++i)
+        {
+            auto& existing { chunks[(hint + i) % chunks.size ()] };
+            if (existing.tree == node)
+            {
+                updated.push_back (existing);
+                existing.tree = {};
+                hint          = (hint + i + 1) % chunks.size ();
+                return;
+            }
+        }
+        updated.push_back ({ node, {}, true });
+    };
+    collect (tree, 0);
+
+    // chunks that are no longer in the tree
+    for (const auto& chunk : chunks)
+    {
+        if (chunk.tree.isValid () && chunk.id.isNotEmpty ())
+            obsoleteIds.add (chunk.id);
+    }
+
+    chunks     = std::move (updated);
+    spineDirty = true;
+}
+
+void ChunkedStore::adoptManifest ()
+{
+    auto manifest { readManifest (directory) };
+    if (!manifest.isValid ())
+        return;
+
+    auto saved { manifest.getChild (0) };
+    juce::StringArray savedIds;
+    std::vector<juce::uint64> savedHashes;
+    extractIds (saved, 0, chunkDepth, savedIds, savedHashes);
+
+    int nextChunk { 0 };
+    const auto matches { static_cast<int> (manifest[formatProperty]) == static_cast<int> (format) &&
+                         static_cast<int> (manifest[depthProperty]) == chunkDepth &&
+                         savedIds.size () == static_cast<int> (chunks.size ()) &&
+                         saved.isEquivalentTo (makeSpine (tree, 0, {}, {}, nextChunk)) };
+    if (!matches)
+    {
+        // the first save will replace that store.
+        obsoleteIds.addArray (savedIds);
+        return;
+    }
+
+    // a matching structure doesn't mean matching contents; only keep the chunk
+    // files that hold what our chunks hold now.
+    for (size_t i { 0 }; i < chunks.size (); ++i)
+    {
+        auto& chunk { chunks[i] };
+        const auto& savedId { savedIds[static_cast<int> (i)] };
+        const auto savedHash { savedHashes[i] };
+        if (savedHash != 0 && HashNode { chunk.tree }.hash == savedHash)
+        {
+            chunk.id    = savedId;
+            chunk.hash  = savedHash;
+            chunk.dirty = false;
+        }
+        else
+            obsoleteIds.add (savedId);
+    }
+    spineDirty = false;
+}
+
+juce::ValueTree ChunkedStore::makeSpine (const juce::ValueTree& node, int depth,
+                                         const juce::StringArray& ids,
+                                         const std::vector<juce::uint64>& hashes,
+                                         int& nextChunk) const
+{
+    juce::ValueTree spine { node.getType () };
+    spine.copyPropertiesFrom (node, nullptr);
+    for (const auto& child : node)
+    {
+        if (depth + 1 < chunkDepth)
+            spine.appendChild (makeSpine (child, depth + 1, ids, hashes, nextChunk), nullptr);
+        else
+        {
+            juce::ValueTree placeholder { child.getType () };
+            if (!ids.isEmpty ())
+            {
+                placeholder.setProperty (chunkProperty, ids[nextChunk], nullptr);
+                placeholder.setProperty (
+                    hashProperty,
+                    static_cast<juce::int64> (hashes[static_cast<size_t> (nextChunk)]), nullptr);
+            }
+            ++nextChunk;
+            spine.appendChild (placeholder, nullptr);
+        }
+    }
+    return spine;
+}
+
+juce::uint64 ChunkedStore::hashSaved (const Chunk& chunk, const juce::File& file) const
+{
+    // XML doesn't keep the types of values, so hash the tree that loading it
+    // will produce; the other formats read back the tree we saved.
+    if (format == Object::FileFormat::xml)
+        return HashNode { Object::load (file, format) }.hash;
+    return HashNode { chunk.tree }.hash;
+}
+
+void ChunkedStore::markDirty (const juce::ValueTree& changedTree, bool structureChanged)
+{
+    const auto lineage { getLineage (changedTree, tree) };
+    if (lineage.empty ())
+        return;
+
+    const auto depth { static_cast<int> (lineage.size ()) - 1 };
+    if (depth < chunkDepth)
+    {
+        if (structureChanged)
+            updateChunks ();
+        else
+            spineDirty = true;
+        return;
+    }
+
+    const auto& chunkTree { lineage[static_cast<size_t> (chunkDepth)] };
+    for (auto& chunk : chunks)
+    {
+        if (chunk.tree == chunkTree)
+        {
+            chunk.dirty = true;
+            return;
+        }
+    }
+    // every tree at the chunk depth should have a chunk.
+    jassertfalse;
+}
+
+void ChunkedStore::valueTreePropertyChanged (juce::ValueTree& changedTree,
+                                             const juce::Identifier&)
+{
+    // filling in a lazily loaded placeholder doesn't change the contents.
+    if (LazyTree::isMaterializing ())
+        return;
+
+    markDirty (changedTree, false);
+}
+
+void ChunkedStore::valueTreeChildAdded (juce::ValueTree& parentTree, juce::ValueTree&)
+{
+    if (LazyTree::isMaterializing ())
+        return;
+
+    markDirty (parentTree, true);
+}
+
+void ChunkedStore::valueTreeChildRemoved (juce::ValueTree& parentTree, juce::ValueTree&, int)
+{
+    markDirty (parentTree, true);
+}
+
+void ChunkedStore::valueTreeChildOrderChanged (juce::ValueTree& parentTree, int, int)
+{
+    markDirty (parentTree, true);
+}
+
+void ChunkedStore::valueTreeRedirected (juce::ValueTree&)
+{
+    updateChunks ();
+}
+
+} // namespace cello
+
+#if RUN_UNIT_TESTS
+#include "test/test_cello_chunked_store.inl"
+#endif
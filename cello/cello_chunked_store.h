@@ -0,0 +1,169 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <juce_data_structures/juce_data_structures.h>
+
+#include "cello_object.h"
+
+namespace cello
+{
+
+/**
+ * @class ChunkedStore
+ * @brief Persists an Object in a directory of separate chunk files, so that
+ * saving only rewrites the parts of the tree that changed.
+ *
+ * Each tree at the chunk depth (by default, each child of the root) is saved as
+ * its own chunk file. The trees above that depth are saved in a small manifest
+ * file that records which chunk file holds each chunk. The store listens to the
+ * tree and tracks which chunks have changed since the last save, and `save()`
+ * only writes those chunks and the manifest.
+ *
+ * Changed chunks are written to new files, and the manifest that refers to them
+ * is written last (replacing the previous one), so an interrupted save leaves
+ * the previously saved state intact. Chunk files that are no longer referenced
+ * are deleted once the new manifest has been written.
+ *
+ * The store should only be used from the thread that changes the tree.
+ */
+class ChunkedStore : private juce::ValueTree::Listener
+{
+public:
+    /**
+     * @brief Start tracking changes made to `object`.
+     *
+     * If `directory` already holds a store whose manifest has the same structure
+     * as `object` (e.g. the object was loaded from it), the saved chunk files
+     * whose contents match the object's chunks (checked against a hash of each
+     * chunk stored in the manifest) are kept, and the first save only writes the
+     * other chunks and what changes after this. Otherwise, the first save writes
+     * every chunk.
+     *
+     * @param object
+     * @param directory
+     * @param chunkDepth depth (below the root) of the trees saved as chunks.
+     * @param format one of (xml, binary, zipped, compact, lz), used for chunk files.
+     */
+    ChunkedStore (const Object& object, juce::File directory, int chunkDepth = 1,
+                  Object::FileFormat format = Object::FileFormat::binary);
+
+    ~ChunkedStore () override;
+
+    /**
+     * @brief Write the chunks that have changed since the last save, and a new
+     * manifest if anything changed.
+     *
+     * @return juce::Result
+     */
+    juce::Result save ();
+
+    /**
+     * @return true if anything has changed since the last save.
+     */
+    bool isDirty () const;
+
+    /**
+     * @return the number of chunks that will be written by the next save.
+     */
+    int getNumDirtyChunks () const;
+
+    /**
+     * @brief Load a tree that was saved by a ChunkedStore.
+     *
+     * @param directory
+     * @return juce::ValueTree, invalid if the store couldn't be read.
+     */
+    static juce::ValueTree load (juce::File directory);
+
+private:
+    struct Chunk
+    {
+        /// the tree saved in this chunk.
+        juce::ValueTree tree;
+        /// name of the file it was last saved to (empty if never saved).
+        juce::String id;
+        /// has it changed since then?
+        bool dirty { true };
+        /// hash of the tree as it was saved (see `hashSaved()`).
+        juce::uint64 hash { 0 };
+    };
+
+    /**
+     * @brief Rebuild the list of chunks after their structure changed, keeping
+     * the state of existing chunks.
+     */
+    void updateChunks ();
+
+    /**
+     * @brief Adopt the chunk files of an existing manifest if it matches our tree.
+     */
+    void adoptManifest ();
+
+    /**
+     * @brief Build the tree saved in the manifest: the trees above the chunk
+     * depth, with a placeholder for each chunk that holds its chunk file id and
+     * hash.
+     */
+    juce::ValueTree makeSpine (const juce::ValueTree& node, int depth,
+                               const juce::StringArray& ids,
+                               const std::vector<juce::uint64>& hashes, int& nextChunk) const;
+
+    /**
+     * @brief Hash a chunk that was just saved to `file`, as it will be read back.
+     */
+    juce::uint64 hashSaved (const Chunk& chunk, const juce::File& file) const;
+
+    /**
+     * @brief Mark whatever contains `changedTree` as dirty.
+     *
+     * @param changedTree
+     * @param structureChanged true if a child was added, removed or moved.
+     */
+    void markDirty (const juce::ValueTree& changedTree, bool structureChanged);
+
+    void valueTreePropertyChanged (juce::ValueTree& tree,
+                                   const juce::Identifier& property) override;
+    void valueTreeChildAdded (juce::ValueTree& parentTree,
+                              juce::ValueTree& childTree) override;
+    void valueTreeChildRemoved (juce::ValueTree& parentTree, juce::ValueTree& childTree,
+                                int index) override;
+    void valueTreeChildOrderChanged (juce::ValueTree& parentTree, int oldIndex,
+                                     int newIndex) override;
+    void valueTreeRedirected (juce::ValueTree& treeWhichHasBeenChanged) override;
+
+private:
+    juce::ValueTree tree;
+    juce::File directory;
+    int chunkDepth;
+    Object::FileFormat format;
+
+    /// the chunks, in the order they appear in the tree.
+    std::vector<Chunk> chunks;
+
+    /// have the trees above the chunks changed?
+    bool spineDirty { true };
+
+    /// ids of saved chunk files that the next manifest won't refer to.
+    juce::StringArray obsoleteIds;
+};
+
+} // namespace cello
@@ -0,0 +1,292 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "JuceHeader.h"
+
+#include "cello_codec.h"
+
+namespace
+{
+const char lzMagic[] { 'C', 'L', 'L', '4' };
+constexpr size_t lzHeaderSize { sizeof (lzMagic) + sizeof (juce::uint64) };
+constexpr size_t minMatch { 4 };
+constexpr size_t maxOffset { 65535 };
+constexpr size_t windowMask { 65535 };
+constexpr int hashBits { 16 };
+// LZ4's end of block rules: the last 5 bytes are always literals, and the last
+// match starts at least 12 bytes before the end.
+constexpr size_t lastLiterals { 5 };
+constexpr size_t matchStartLimit { 12 };
+
+juce::uint32 read32 (const juce::uint8* p)
+{
+    juce::uint32 value;
+    std::memcpy (&value, p, sizeof (value));
+    return value;
+}
+
+juce::uint32 hash4 (const juce::uint8* p)
+{
+    return (read32 (p) * 2654435761u) >> (32 - hashBits);
+}
+
+void writeLength (std::vector<juce::uint8>& out, size_t length)
+{
+    for (; length >= 255; length -= 255)
+        out.push_back (255);
+    out.push_back (static_cast<juce::uint8> (length));
+}
+
+/**
+ * @brief The Adler-32 checksum that zlib writes (big-endian) at the end of a
+ * complete stream.
+ */
+juce::uint32 adler32 (const void* data, size_t size)
+{
+    constexpr juce::uint32 modulus { 65521 };
+    // the largest number of bytes that can be summed before the sums overflow.
+    constexpr size_t maxRun { 5552 };
+    juce::uint32 a { 1 };
+    juce::uint32 b { 0 };
+    const auto* bytes { static_cast<const juce::uint8*> (data) };
+    while (size > 0)
+    {
+        const auto count { std::min (size, maxRun) };
+        for (size_t i { 0 }; i < count; ++i)
+        {
+            a += bytes[i];
+            b += a;
+        }
+        a %= modulus;
+        b %= modulus;
+        bytes += count;
+        size -= count;
+    }
+    return (b << 16) | a;
+}
+
+/**
+ * @brief Write an LZ4 sequence: a token, literal bytes, and a match (which is
+ * omitted from the last sequence, when `matchLength` is 0).
+ */
+void writeSequence (std::vector<juce::uint8>& out, const juce::uint8* literals,
+                    size_t numLiterals, size_t offset, size_t matchLength)
+{
+    const auto literalCode { std::min<size_t> (numLiterals, 15) };
+    const auto matchCode { matchLength == 0 ? 0 : std::min<size_t> (matchLength - minMatch, 15) };
+    out.push_back (static_cast<juce::uint8> ((literalCode << 4) | matchCode));
+    if (literalCode == 15)
+        writeLength (out, numLiterals - 15);
+    out.insert (out.end (), literals, literals + numLiterals);
+
+    if (matchLength == 0)
+        return;
+    out.push_back (static_cast<juce::uint8> (offset & 0xff));
+    out.push_back (static_cast<juce::uint8> (offset >> 8));
+    if (matchCode == 15)
+        writeLength (out, matchLength - minMatch - 15);
+}
+} // namespace
+
+namespace cello
+{
+
+bool GzipCodec::compress (const void* data, size_t size, juce::OutputStream& dest,
+                          int level) const
+{
+    juce::GZIPCompressorOutputStream zipper { dest,
+                                              level == defaultLevel ? -1
+                                                                    : juce::jlimit (1, 9, level) };
+    return zipper.write (data, size);
+}
+
+bool GzipCodec::decompress (const void* data, size_t size, juce::MemoryBlock& dest) const
+{
+    dest.reset ();
+    // a zlib stream has a 2 byte header and a 4 byte checksum.
+    if (size < 6)
+        return false;
+
+    juce::MemoryInputStream in { data, size, false };
+    juce::GZIPDecompressorInputStream unzipper { in };
+    unzipper.readIntoMemoryBlock (dest);
+
+    // a truncated or damaged stream just stops early, so check that we got to
+    // the end: a complete stream ends with the checksum of its contents.
+    const auto* trailer { static_cast<const juce::uint8*> (data) + size - 4 };
+    juce::uint32 checksum { 0 };
+    for (int i { 0 }; i < 4; ++i)
+        checksum = (checksum << 8) | trailer[i];
+    return adler32 (dest.getData (), dest.getSize ()) == checksum;
+}
+
+bool LzCodec::compress (const void* data, size_t size, juce::OutputStream& dest, int level) const
+{
+    const auto* in { static_cast<const juce::uint8*> (data) };
+    const auto maxCandidates { 1 << (juce::jlimit (1, 9, level == defaultLevel ? 1 : level) - 1) };
+
+    std::vector<juce::uint8> out;
+    out.reserve (lzHeaderSize + size + size / 255 + 16);
+    out.insert (out.end (), lzMagic, lzMagic + sizeof (lzMagic));
+    for (size_t i { 0 }; i < sizeof (juce::uint64); ++i)
+        out.push_back (static_cast<juce::uint8> (static_cast<juce::uint64> (size) >> (8 * i)));
+
+    // the most recent position for each hash, and (above level 1) a chain of the
+    // previous positions with the same hash within the window.
+    std::vector<juce::int64> head (1 << hashBits, -1);
+    std::vector<juce::int64> chain (maxCandidates > 1 ? windowMask + 1 : 0, -1);
+    const auto insert = [&] (size_t position)
+    {
+        auto& latest { head[hash4 (in + position)] };
+        if (!chain.empty ())
+            chain[position & windowMask] = latest;
+        latest = static_cast<juce::int64> (position);
+    };
+
+    // matches may not extend into the last literals.
+    const auto matchLimit { size > lastLiterals ? size - lastLiterals : 0 };
+    size_t anchor { 0 };
+    size_t position { 0 };
+    while (position + matchStartLimit <= size)
+    {
+        size_t bestLength { 0 };
+        size_t bestOffset { 0 };
+        auto candidate { head[hash4 (in + position)] };
+        for (int i { 0 }; i < maxCandidates && candidate >= 0; ++i)
+        {
+            const auto start { static_cast<size_t> (candidate) };
+            if (position - start > maxOffset)
+                break;
+            if (read32 (in + start) == read32 (in + position))
+            {
+                auto length { minMatch };
+                while (position + length < matchLimit &&
+                       in[start + length] == in[position + length])
+                    ++length;
+                if (length > bestLength)
+                {
+                    bestLength = length;
+                    bestOffset = position - start;
+                }
+            }
+            if (chain.empty ())
+                break;
+            // a newer position means this slot was reused after leaving the window.
+            const auto next { chain[start & windowMask] };
+            if (next >= candidate)
+                break;
+            candidate = next;
+        }
+
+        insert (position);
+        if (bestLength >= minMatch)
+        {
+            writeSequence (out, in + anchor, position - anchor, bestOffset, bestLength);
+            const auto matchEnd { position + bestLength };
+            for (++position; position < matchEnd && position + minMatch <= size; ++position)
+                insert (position);
+            position = anchor = matchEnd;
+        }
+        else
+            ++position;
+    }
+    writeSequence (out, in + anchor, size - anchor, 0, 0);
+
+    return dest.write (out.data (), out.size ());
+}
+
+bool LzCodec::decompress (const void* data, size_t size, juce::MemoryBlock& dest) const
+{
+    const auto* in { static_cast<const juce::uint8*> (data) };
+    if (size < lzHeaderSize || std::memcmp (in, lzMagic, sizeof (lzMagic)) != 0)
+        return false;
+
+    juce::uint64 outSize { 0 };
+    for (size_t i { 0 }; i < sizeof (juce::uint64); ++i)
+        outSize |= static_cast<juce::uint64> (in[sizeof (lzMagic) + i]) << (8 * i);
+    // no input byte can expand to more than 255 output bytes; don't trust a
+    // damaged header enough to allocate more than that.
+    if (outSize / 255 > size)
+        return false;
+
+    dest.setSize (static_cast<size_t> (outSize));
+    auto* out { static_cast<juce::uint8*> (dest.getData ()) };
+    size_t ip { lzHeaderSize };
+    size_t op { 0 };
+
+    const auto readLength = [&] (size_t& length)
+    {
+        while (ip < size)
+        {
+            const auto byte { in[ip++] };
+            length += byte;
+            if (byte != 255)
+                return true;
+        }
+        return false;
+    };
+
+    for (;;)
+    {
+        if (ip >= size)
+            return false;
+        const auto token { in[ip++] };
+
+        size_t numLiterals { static_cast<size_t> (token >> 4) };
+        if (numLiterals == 15 && !readLength (numLiterals))
+            return false;
+        if (numLiterals > size - ip || numLiterals > outSize - op)
+            return false;
+        if (numLiterals > 0)
+            std::memcpy (out + op, in + ip, numLiterals);
+        ip += numLiterals;
+        op += numLiterals;
+
+        // the last sequence has no match.
+        if (ip == size)
+            return op == outSize;
+
+        if (size - ip < 2)
+            return false;
+        const size_t offset { static_cast<size_t> (in[ip] | (in[ip + 1] << 8)) };
+        ip += 2;
+        size_t length { static_cast<size_t> (token & 15) };
+        if (length == 15 && !readLength (length))
+            return false;
+        length += minMatch;
+        if (offset == 0 || offset > op || length > outSize - op)
+            return false;
+
+        if (offset >= length)
+            std::memcpy (out + op, out + op - offset, length);
+        else
+        {
+            // overlapping match, e.g. a run of repeated bytes.
+            for (size_t i { 0 }; i < length; ++i)
+                out[op + i] = out[op + i - offset];
+        }
+        op += length;
+    }
+}
+
+} // namespace cello
+
+#if RUN_UNIT_TESTS
+#include "test/test_cello_codec.inl"
+#endif
@@ -0,0 +1,100 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+namespace cello
+{
+
+/**
+ * @class Codec
+ * @brief Interface for a compression codec that can be used to save and load
+ * Objects (see `Object::save (juce::File, const Codec&, int)`).
+ */
+class Codec
+{
+public:
+    /// pass as the compression level to use the codec's default.
+    static constexpr int defaultLevel { -1 };
+
+    virtual ~Codec () = default;
+
+    /**
+     * @brief Compress a block of data.
+     *
+     * @param data
+     * @param size
+     * @param dest stream to write the compressed data to.
+     * @param level 1 (fastest) through 9 (smallest), or `defaultLevel`.
+     * @return false if writing the data failed.
+     */
+    virtual bool compress (const void* data, size_t size, juce::OutputStream& dest,
+                           int level = defaultLevel) const = 0;
+
+    /**
+     * @brief Decompress data that was written by `compress()`.
+     *
+     * @param data
+     * @param size
+     * @param dest replaced with the decompressed data.
+     * @return false if the data couldn't be decompressed.
+     */
+    virtual bool decompress (const void* data, size_t size, juce::MemoryBlock& dest) const = 0;
+};
+
+/**
+ * @class GzipCodec
+ * @brief zlib compression, using juce's GZIP streams. Saving a tree with this
+ * codec creates the same data as `Object::FileFormat::zipped`, but lets you
+ * select the compression level. `decompress()` fails unless the data is a
+ * complete zlib stream whose checksum matches its contents.
+ */
+class GzipCodec : public Codec
+{
+public:
+    bool compress (const void* data, size_t size, juce::OutputStream& dest,
+                   int level = defaultLevel) const override;
+
+    bool decompress (const void* data, size_t size, juce::MemoryBlock& dest) const override;
+};
+
+/**
+ * @class LzCodec
+ * @brief A fast LZ77-family codec (using the LZ4 block format) that trades some
+ * compression ratio for much faster compression and decompression than zlib.
+ * The compression level sets how hard the compressor searches for matches: level
+ * 1 (the default) only checks the most recent candidate, and each level above
+ * that doubles the number of candidates it checks.
+ *
+ * The compressed data is a header (a magic number and the uncompressed size)
+ * followed by a single LZ4 block that follows the format's end of block rules,
+ * so other LZ4 block decoders can decompress it.
+ */
+class LzCodec : public Codec
+{
+public:
+    bool compress (const void* data, size_t size, juce::OutputStream& dest,
+                   int level = defaultLevel) const override;
+
+    bool decompress (const void* data, size_t size, juce::MemoryBlock& dest) const override;
+};
+
+} // namespace cello
@@ -0,0 +1,126 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include <type_traits>
+#include <vector>
+
+#include <juce_core/juce_core.h>
+#include <juce_data_structures/juce_data_structures.h>
+
+namespace cello
+{
+
+/**
+ * @class Column
+ * @brief The values of one property across all of an Object's children, stored
+ * contiguously (structure-of-arrays), so numeric code can run over them as a
+ * plain buffer instead of walking the children and converting each var. See
+ * `Object::exportColumns()` and `Object::importColumns()`.
+ *
+ * A `Column<bool>` stores each value as a `juce::uint8` (0 or 1), since a
+ * `std::vector<bool>` packs its values into bits instead of an array.
+ *
+ * @tparam T the type to convert each value to, using its `juce::VariantConverter`.
+ */
+template <typename T> class Column
+{
+public:
+    /// type of the stored values.
+    using Storage = std::conditional_t<std::is_same_v<T, bool>, juce::uint8, T>;
+
+    /**
+     * @param id_ the property to read/write from each child.
+     * @param defaultVal_ value to use for children that don't have the property.
+     */
+    Column (const juce::Identifier& id_, T defaultVal_ = {})
+    : id { id_ }
+    , defaultValue { defaultVal_ }
+    {
+    }
+
+    juce::Identifier getId () const { return id; }
+
+    size_t size () const noexcept { return values.size (); }
+    Storage* data () noexcept { return values.data (); }
+    const Storage* data () const noexcept { return values.data (); }
+
+    Storage& operator[] (size_t index) noexcept { return values[index]; }
+    const Storage& operator[] (size_t index) const noexcept { return values[index]; }
+
+    auto begin () noexcept { return values.begin (); }
+    auto end () noexcept { return values.end (); }
+    auto begin () const noexcept { return values.begin (); }
+    auto end () const noexcept { return values.end (); }
+
+    /**
+     * @brief Empty the column and reserve space for `count` values.
+     */
+    void reset (size_t count)
+    {
+        values.clear ();
+        values.reserve (count);
+    }
+
+    /**
+     * @brief Append the value of our property in `tree`.
+     */
+    void read (const juce::ValueTree& tree)
+    {
+        values.push_back (static_cast<Storage> (valueIn (tree)));
+    }
+
+    /**
+     * @brief Set our property in `tree` to the value at `index` if that's
+     * different from the value `read()` would get from it now (which is the
+     * default value if the tree doesn't have the property).
+     *
+     * @return true if the tree was changed.
+     */
+    bool write (juce::ValueTree& tree, size_t index, juce::UndoManager* undo) const
+    {
+        if (!differs (tree, index))
+            return false;
+        tree.setProperty (id, juce::VariantConverter<T>::toVar (static_cast<T> (values[index])),
+                          undo);
+        return true;
+    }
+
+    /**
+     * @brief Would `write()` change `tree`?
+     */
+    bool differs (const juce::ValueTree& tree, size_t index) const
+    {
+        return valueIn (tree) != static_cast<T> (values[index]);
+    }
+
+private:
+    T valueIn (const juce::ValueTree& tree) const
+    {
+        const auto* value { tree.getPropertyPointer (id) };
+        return value != nullptr ? juce::VariantConverter<T>::fromVar (*value) : defaultValue;
+    }
+
+    juce::Identifier id;
+    T defaultValue;
+    std::vector<Storage> values;
+};
+
+} // namespace cello
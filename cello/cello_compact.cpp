@@ -0,0 +1,424 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "JuceHeader.h"
+
+#include "cello_compact.h"
+#include "cello_lazy.h"
+
+namespace
+{
+const char compactMagic[] { 'C', 'L', 'C', 'F' };
+
+enum CompactTag : juce::uint8
+{
+    voidValue,
+    intValue,
+    int64Value,
+    trueValue,
+    falseValue,
+    doubleValue,
+    stringValue,
+    binaryValue,
+    arrayValue,
+    otherValue // anything else, in juce's own var format.
+};
+
+juce::uint64 zigzag (juce::int64 value)
+{
+    return (static_cast<juce::uint64> (value) << 1) ^ static_cast<juce::uint64> (value >> 63);
+}
+
+juce::int64 unzigzag (juce::uint64 value)
+{
+    return static_cast<juce::int64> (value >> 1) ^ -static_cast<juce::int64> (value & 1);
+}
+
+const void* getAddress (const juce::Identifier& id)
+{
+    // Identifiers are pooled, so equal identifiers share the same text.
+    return id.getCharPointer ().getAddress ();
+}
+
+class Writer
+{
+public:
+    explicit Writer (juce::OutputStream& outputStream)
+    : stream { outputStream }
+    {
+    }
+
+    bool writeTree (const juce::ValueTree& tree)
+    {
+        // build the identifier table
+        collectIdentifiers (tree);
+        ok = stream.write (compactMagic, sizeof (compactMagic));
+        writeVarint (identifiers.size ());
+        for (const auto& id : identifiers)
+            writeString (id.toString ());
+
+        writeNode (tree);
+        return ok;
+    }
+
+private:
+    void collectIdentifiers (const juce::ValueTree& tree)
+    {
+        addIdentifier (tree.getType ());
+        for (int i { 0 }; i < tree.getNumProperties (); ++i)
+            addIdentifier (tree.getPropertyName (i));
+        for (const auto& child : tree)
+            collectIdentifiers (child);
+    }
+
+    void addIdentifier (const juce::Identifier& id)
+    {
+        if (indices.emplace (getAddress (id), identifiers.size ()).second)
+            identifiers.push_back (id);
+    }
+
+    void writeNode (const juce::ValueTree& tree)
+    {
+        writeVarint (indices[getAddress (tree.getType ())]);
+        const auto numProperties { tree.getNumProperties () };
+        writeVarint (static_cast<juce::uint64> (numProperties));
+        for (int i { 0 }; i < numProperties; ++i)
+        {
+            const auto name { tree.getPropertyName (i) };
+            writeVarint (indices[getAddress (name)]);
+            writeValue (*tree.getPropertyPointer (name));
+        }
+
+        writeVarint (static_cast<juce::uint64> (tree.getNumChildren ()));
+        for (const auto& child : tree)
+            writeNode (child);
+    }
+
+    void writeValue (const juce::var& value)
+    {
+        if (value.isVoid ())
+            writeByte (voidValue);
+        else if (value.isInt () || value.isInt64 ())
+        {
+            writeByte (value.isInt () ? intValue : int64Value);
+            writeVarint (zigzag (static_cast<juce::int64> (value)));
+        }
+        else if (value.isBool ())
+            writeByte (static_cast<bool> (value) ? trueValue : falseValue);
+        else if (value.isDouble ())
+        {
+            writeByte (doubleValue);
+            const auto number { static_cast<double> (value) };
+            juce::uint64 bits;
+            std::memcpy (&bits, &number, sizeof (bits));
+            bits = juce::ByteOrder::swapIfBigEndian (bits);
+            writeBytes (&bits, sizeof (bits));
+        }
+        else if (value.isString ())
+        {
+            writeByte (stringValue);
+            writeString (value.toString ());
+        }
+        else if (const auto* block { value.getBinaryData () })
+        {
+            writeByte (binaryValue);
+            writeVarint (block->getSize ());
+            writeBytes (block->getData (), block->getSize ());
+        }
+        else if (const auto* array { value.getArray () })
+        {
+            writeByte (arrayValue);
+            writeVarint (static_cast<juce::uint64> (array->size ()));
+            for (const auto& item : *array)
+                writeValue (item);
+        }
+        else
+        {
+            writeByte (otherValue);
+            juce::MemoryOutputStream data;
+            value.writeToStream (data);
+            writeVarint (data.getDataSize ());
+            writeBytes (data.getData (), data.getDataSize ());
+        }
+    }
+
+    void writeString (const juce::String& text)
+    {
+        const auto size { text.getNumBytesAsUTF8 () };
+        writeVarint (size);
+        writeBytes (text.toRawUTF8 (), size);
+    }
+
+    void writeVarint (juce::uint64 value)
+    {
+        juce::uint8 bytes[10];
+        size_t count { 0 };
+        while (value >= 0x80)
+        {
+            bytes[count++] = static_cast<juce::uint8> (value | 0x80);
+            value >>= 7;
+        }
+        bytes[count++] = static_cast<juce::uint8> (value);
+        writeBytes (bytes, count);
+    }
+
+    void writeByte (juce::uint8 byte) { writeBytes (&byte, 1); }
+
+    void writeBytes (const void* data, size_t size)
+    {
+        if (size > 0)
+            ok = stream.write (data, size) && ok;
+    }
+
+    juce::OutputStream& stream;
+    std::vector<juce::Identifier> identifiers;
+    std::unordered_map<const void*, juce::uint64> indices;
+    bool ok { true };
+};
+
+class Reader
+{
+public:
+    explicit Reader (juce::InputStream& inputStream)
+    : stream { inputStream }
+    , buffer (32 * 1024)
+    {
+    }
+
+    juce::ValueTree readTree ()
+    {
+        char header[sizeof (compactMagic)];
+        if (!readBytes (header, sizeof (header)) ||
+            std::memcmp (header, compactMagic, sizeof (compactMagic)) != 0)
+            return {};
+
+        // intern each identifier once.
+        const auto count { readVarint () };
+        for (juce::uint64 i { 0 }; i < count && !failed; ++i)
+        {
+            const auto name { readString () };
+            if (name.isEmpty ())
+                return {};
+            identifiers.push_back (name);
+        }
+
+        auto tree { readNode () };
+        if (failed)
+            return {};
+
+        // give back what we read ahead of the end of the tree, so the stream can
+        // be read from there (if it can seek).
+        if (position < end)
+            stream.setPosition (stream.getPosition () - (end - position));
+        return tree;
+    }
+
+private:
+    juce::ValueTree readNode ()
+    {
+        const auto* type { readIdentifier () };
+        if (type == nullptr)
+            return {};
+
+        juce::ValueTree tree { *type };
+        const auto numProperties { readVarint () };
+        for (juce::uint64 i { 0 }; i < numProperties && !failed; ++i)
+        {
+            const auto* name { readIdentifier () };
+            if (name == nullptr)
+                return {};
+            tree.setProperty (*name, readValue (), nullptr);
+        }
+
+        const auto numChildren { readVarint () };
+        for (juce::uint64 i { 0 }; i < numChildren && !failed; ++i)
+        {
+            auto child { readNode () };
+            if (!child.isValid ())
+                return {};
+            tree.appendChild (child, nullptr);
+        }
+        return tree;
+    }
+
+    const juce::Identifier* readIdentifier ()
+    {
+        const auto index { readVarint () };
+        if (failed || index >= identifiers.size ())
+        {
+            failed = true;
+            return nullptr;
+        }
+        return &identifiers[static_cast<size_t> (index)];
+    }
+
+    juce::var readValue ()
+    {
+        switch (readByte ())
+        {
+            case voidValue: return {};
+            case intValue: return static_cast<int> (unzigzag (readVarint ()));
+            case int64Value: return unzigzag (readVarint ());
+            case trueValue: return true;
+            case falseValue: return false;
+            case doubleValue:
+            {
+                juce::uint64 bits { 0 };
+                readBytes (&bits, sizeof (bits));
+                bits = juce::ByteOrder::swapIfBigEndian (bits);
+                double number;
+                std::memcpy (&number, &bits, sizeof (number));
+                return number;
+            }
+            case stringValue: return readString ();
+            case binaryValue:
+            {
+                const auto size { readSize () };
+                juce::MemoryBlock block { size };
+                readBytes (block.getData (), size);
+                return block;
+            }
+            case arrayValue:
+            {
+                juce::Array<juce::var> array;
+                const auto size { readSize () };
+                for (size_t i { 0 }; i < size && !failed; ++i)
+                    array.add (readValue ());
+                return array;
+            }
+            case otherValue:
+            {
+                const auto size { readSize () };
+                juce::MemoryBlock block { size };
+                readBytes (block.getData (), size);
+                juce::MemoryInputStream data { block, false };
+                return juce::var::readFromStream (data);
+            }
+            default: failed = true; return {};
+        }
+    }
+
+    juce::String readString ()
+    {
+        const auto size { readSize () };
+        if (size <= static_cast<size_t> (end - position))
+        {
+            // read directly from the buffer when we can.
+            const auto* start { buffer.data () + position };
+            position += static_cast<int> (size);
+            return juce::String::fromUTF8 (start, static_cast<int> (size));
+        }
+        scratch.resize (size);
+        readBytes (scratch.data (), size);
+        return juce::String::fromUTF8 (scratch.data (), static_cast<int> (size));
+    }
+
+    /**
+     * @brief Read a length, which can't be larger than the remaining data if we
+     * know how much that is (to avoid huge allocations when reading damaged data).
+     */
+    size_t readSize ()
+    {
+        const auto size { readVarint () };
+        const auto remaining { stream.getNumBytesRemaining () };
+        if (failed ||
+            (remaining >= 0 && size > static_cast<juce::uint64> (remaining + (end - position))))
+        {
+            failed = true;
+            return 0;
+        }
+        return static_cast<size_t> (size);
+    }
+
+    juce::uint64 readVarint ()
+    {
+        juce::uint64 value { 0 };
+        for (int shift { 0 }; shift < 64; shift += 7)
+        {
+            const auto byte { readByte () };
+            value |= static_cast<juce::uint64> (byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0)
+                return value;
+        }
+        failed = true;
+        return 0;
+    }
+
+    juce::uint8 readByte ()
+    {
+        if (position == end && !refill ())
+            return 0;
+        return static_cast<juce::uint8> (buffer[static_cast<size_t> (position++)]);
+    }
+
+    bool readBytes (void* dest, size_t size)
+    {
+        auto* out { static_cast<char*> (dest) };
+        while (size > 0)
+        {
+            if (position == end && !refill ())
+                return false;
+            const auto count { std::min (size, static_cast<size_t> (end - position)) };
+            std::memcpy (out, buffer.data () + position, count);
+            position += static_cast<int> (count);
+            out += count;
+            size -= count;
+        }
+        return true;
+    }
+
+    bool refill ()
+    {
+        position = 0;
+        end      = std::max (0, stream.read (buffer.data (), static_cast<int> (buffer.size ())));
+        if (end == 0)
+            failed = true;
+        return end > 0;
+    }
+
+    juce::InputStream& stream;
+    std::vector<char> buffer;
+    int position { 0 };
+    int end { 0 };
+    std::vector<char> scratch;
+    std::vector<juce::Identifier> identifiers;
+    bool failed { false };
+};
+} // namespace
+
+namespace cello
+{
+
+bool CompactFormat::write (const juce::ValueTree& tree, juce::OutputStream& stream)
+{
+    Writer writer { stream };
+    return writer.writeTree (LazyTree::withoutPlaceholders (tree));
+}
+
+juce::ValueTree CompactFormat::read (juce::InputStream& stream)
+{
+    Reader reader { stream };
+    return reader.readTree ();
+}
+
+} // namespace cello
+
+#if RUN_UNIT_TESTS
+#include "test/test_cello_compact.inl"
+#endif
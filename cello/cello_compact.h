@@ -0,0 +1,65 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <juce_data_structures/juce_data_structures.h>
+
+namespace cello
+{
+
+/**
+ * @class CompactFormat
+ * @brief Reads and writes trees in a compact binary format.
+ *
+ * juce's binary format writes the name of each property and the type of each
+ * tree as a string every time it occurs. This format writes a table of those
+ * identifiers once at the start of the data, and then refers to each of them by
+ * its index. Integers and lengths are stored as variable-length integers, and
+ * values use compact typed encodings, so the data is usually much smaller than
+ * juce's binary format (without the cost of compressing it), and faster to
+ * read, since each identifier is only looked up once.
+ */
+class CompactFormat
+{
+public:
+    /**
+     * @brief Write a tree and all its descendants to a stream.
+     *
+     * @param tree
+     * @param stream
+     * @return false if writing to the stream failed.
+     */
+    static bool write (const juce::ValueTree& tree, juce::OutputStream& stream);
+
+    /**
+     * @brief Read a tree that was written by `write()`. The stream is read in
+     * blocks; once the tree has been read, the stream is moved back to the
+     * position just after it. If the stream can't change its position (see
+     * `juce::InputStream::setPosition()`), data following the tree may have been
+     * consumed.
+     *
+     * @param stream
+     * @return ValueTree, invalid if the data couldn't be read.
+     */
+    static juce::ValueTree read (juce::InputStream& stream);
+};
+
+} // namespace cello
@@ -0,0 +1,340 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "JuceHeader.h"
+
+#include "cello_diff.h"
+#include "cello_hash.h"
+
+#include <unordered_map>
+
+namespace
+{
+/**
+ * @brief Find the longest increasing subsequence of `values`.
+ * @return a flag for each entry of `values`, true if it's part of the subsequence.
+ */
+std::vector<bool> longestIncreasingSubsequence (const std::vector<int>& values)
+{
+    const auto count { values.size () };
+    // tails[k] is the index of the smallest value that ends an increasing run
+    // of length k + 1.
+    std::vector<size_t> tails;
+    std::vector<int> previous (count, -1);
+    for (size_t i { 0 }; i < count; ++i)
+    {
+        const auto pos { std::lower_bound (tails.begin (), tails.end (), values[i],
+                                           [&values] (size_t tail, int value)
+                                           { return values[tail] < value; }) };
+        if (pos != tails.begin ())
+            previous[i] = static_cast<int> (*(pos - 1));
+        if (pos == tails.end ())
+            tails.push_back (i);
+        else
+            *pos = i;
+    }
+
+    std::vector<bool> inSequence (count, false);
+    int current { tails.empty () ? -1 : static_cast<int> (tails.back ()) };
+    while (current >= 0)
+    {
+        inSequence[static_cast<size_t> (current)] = true;
+        current                                   = previous[static_cast<size_t> (current)];
+    }
+    return inSequence;
+}
+
+} // namespace
+
+namespace cello
+{
+
+bool Patch::apply (juce::ValueTree tree, juce::UndoManager* undo) const
+{
+    for (const auto& edit : edits)
+    {
+        auto target { tree };
+        for (auto index : edit.path)
+            target = target.getChild (index);
+
+        if (!target.isValid ())
+        {
+            jassertfalse;
+            return false;
+        }
+
+        const auto numChildren { target.getNumChildren () };
+        switch (edit.type)
+        {
+            case EditType::setProperty:
+                target.setProperty (edit.property, edit.value, undo);
+                break;
+
+            case EditType::removeProperty:
+                target.removeProperty (edit.property, undo);
+                break;
+
+            case EditType::insertChild:
+                if (edit.index > numChildren)
+                    return false;
+                // insert a copy so that the patch may be applied more than once.
+                target.addChild (edit.child.createCopy (), edit.index, undo);
+                break;
+
+            case EditType::removeChild:
+                if (!juce::isPositiveAndBelow (edit.index, numChildren))
+                    return false;
+                target.removeChild (edit.index, undo);
+                break;
+
+            case EditType::moveChild:
+                if (!juce::isPositiveAndBelow (edit.index, numChildren) ||
+                    !juce::isPositiveAndBelow (edit.newIndex, numChildren))
+                    return false;
+                target.moveChild (edit.index, edit.newIndex, undo);
+                break;
+        }
+    }
+    return true;
+}
+
+Diff::Diff (const juce::Identifier& key_)
+: key { key_ }
+{
+}
+
+Patch Diff::compare (const juce::ValueTree& from, const juce::ValueTree& to) const
+{
+    return compare (from, HashNode { from }, to, HashNode { to });
+}
+
+Patch Diff::compare (const juce::ValueTree& from, const HashNode& fromHash,
+                     const juce::ValueTree& to, const HashNode& toHash) const
+{
+    jassert (from.getType () == to.getType ());
+    Patch patch;
+    std::vector<int> path;
+    compareTrees (from, fromHash, to, toHash, path, patch);
+    return patch;
+}
+
+void Diff::compareTrees (const juce::ValueTree& from, const HashNode& fromHash,
+                         const juce::ValueTree& to, const HashNode& toHash,
+                         std::vector<int>& path, Patch& patch) const
+{
+    // unchanged subtree, nothing to do.
+    if (fromHash.hash == toHash.hash)
+        return;
+
+    compareProperties (from, to, path, patch);
+    compareChildren (from, fromHash, to, toHash, path, patch);
+}
+
+void Diff::compareProperties (const juce::ValueTree& from, const juce::ValueTree& to,
+                              const std::vector<int>& path, Patch& patch) const
+{
+    for (int i { 0 }; i < to.getNumProperties (); ++i)
+    {
+        const auto name { to.getPropertyName (i) };
+        const auto& newValue { to.getProperty (name) };
+        const auto* oldValue { from.getPropertyPointer (name) };
+        if (oldValue == nullptr || !oldValue->equalsWithSameType (newValue))
+        {
+            Patch::Edit edit;
+            edit.type     = Patch::EditType::setProperty;
+            edit.path     = path;
+            edit.property = name;
+            edit.value    = newValue;
+            patch.edits.push_back (std::move (edit));
+        }
+    }
+
+    for (int i { 0 }; i < from.getNumProperties (); ++i)
+    {
+        const auto name { from.getPropertyName (i) };
+        if (!to.hasProperty (name))
+        {
+            Patch::Edit edit;
+            edit.type     = Patch::EditType::removeProperty;
+            edit.path     = path;
+            edit.property = name;
+            patch.edits.push_back (std::move (edit));
+        }
+    }
+}
+
+std::vector<int> Diff::matchChildren (const juce::ValueTree& from,
+                                      const juce::ValueTree& to) const
+{
+    const auto numFrom { from.getNumChildren () };
+    const auto numTo { to.getNumChildren () };
+    std::vector<int> matches (static_cast<size_t> (numTo), -1);
+    std::vector<bool> used (static_cast<size_t> (numFrom), false);
+
+    const auto hasKey = [this] (const juce::ValueTree& tree)
+    { return key.isValid () && tree.hasProperty (key); };
+
+    if (key.isValid ())
+    {
+        // index the old children by (a hash of) their key so this isn't quadratic.
+        std::unordered_multimap<juce::uint64, int> keyed;
+        for (int f { 0 }; f < numFrom; ++f)
+        {
+            const auto child { from.getChild (f) };
+            if (hasKey (child))
+                keyed.emplace (HashNode::hashValue (child[key]), f);
+        }
+
+        for (int t { 0 }; t < numTo; ++t)
+        {
+            const auto child { to.getChild (t) };
+            if (!hasKey (child))
+                continue;
+            const auto range { keyed.equal_range (HashNode::hashValue (child[key])) };
+            for (auto it { range.first }; it != range.second; ++it)
+            {
+                const auto f { it->second };
+                const auto candidate { from.getChild (f) };
+                if (!used[static_cast<size_t> (f)] &&
+                    candidate.getType () == child.getType () &&
+                    candidate[key].equalsWithSameType (child[key]))
+                {
+                    matches[static_cast<size_t> (t)] = f;
+                    used[static_cast<size_t> (f)]    = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    // anything without a key is matched by position.
+    for (int t { 0 }; t < juce::jmin (numFrom, numTo); ++t)
+    {
+        const auto fromChild { from.getChild (t) };
+        const auto toChild { to.getChild (t) };
+        if (matches[static_cast<size_t> (t)] < 0 && !used[static_cast<size_t> (t)] &&
+            !hasKey (fromChild) && !hasKey (toChild) &&
+            fromChild.getType () == toChild.getType ())
+        {
+            matches[static_cast<size_t> (t)] = t;
+            used[static_cast<size_t> (t)]    = true;
+        }
+    }
+    return matches;
+}
+
+void Diff::compareChildren (const juce::ValueTree& from, const HashNode& fromHash,
+                            const juce::ValueTree& to, const HashNode& toHash,
+                            std::vector<int>& path, Patch& patch) const
+{
+    const auto numFrom { from.getNumChildren () };
+    const auto numTo { to.getNumChildren () };
+    const auto matches { matchChildren (from, to) };
+
+    std::vector<int> targetOf (static_cast<size_t> (numFrom), -1);
+    for (int t { 0 }; t < numTo; ++t)
+    {
+        if (const auto f { matches[static_cast<size_t> (t)] }; f >= 0)
+            targetOf[static_cast<size_t> (f)] = t;
+    }
+
+    const auto addEdit = [&] (Patch::EditType type, int index, int newIndex)
+    {
+        Patch::Edit edit;
+        edit.type     = type;
+        edit.path     = path;
+        edit.index    = index;
+        edit.newIndex = newIndex;
+        patch.edits.push_back (std::move (edit));
+        return &patch.edits.back ();
+    };
+
+    // 1. remove unmatched children, last first so the other indices stay valid.
+    for (int f { numFrom - 1 }; f >= 0; --f)
+    {
+        if (targetOf[static_cast<size_t> (f)] < 0)
+            addEdit (Patch::EditType::removeChild, f, -1);
+    }
+
+    // 2. the surviving children, in their current order, identified by the
+    // index they need to end up at. The longest run that's already in order
+    // stays put, and everything else is moved into place around it.
+    std::vector<int> order;
+    for (auto target : targetOf)
+    {
+        if (target >= 0)
+            order.push_back (target);
+    }
+    auto settled { longestIncreasingSubsequence (order) };
+
+    std::vector<int> toMove;
+    for (size_t i { 0 }; i < order.size (); ++i)
+    {
+        if (!settled[i])
+            toMove.push_back (order[i]);
+    }
+    std::sort (toMove.begin (), toMove.end ());
+
+    for (auto target : toMove)
+    {
+        const auto fromPos { static_cast<size_t> (
+            std::find (order.begin (), order.end (), target) - order.begin ()) };
+        order.erase (order.begin () + static_cast<std::ptrdiff_t> (fromPos));
+        settled.erase (settled.begin () + static_cast<std::ptrdiff_t> (fromPos));
+
+        // place it in front of the first settled child that belongs after it.
+        size_t toPos { 0 };
+        while (toPos < order.size () && !(settled[toPos] && order[toPos] > target))
+            ++toPos;
+
+        order.insert (order.begin () + static_cast<std::ptrdiff_t> (toPos), target);
+        settled.insert (settled.begin () + static_cast<std::ptrdiff_t> (toPos), true);
+        if (toPos != fromPos)
+            addEdit (Patch::EditType::moveChild, static_cast<int> (fromPos),
+                     static_cast<int> (toPos));
+    }
+
+    // 3. insert copies of the new children; the matched children are now in
+    // order, so inserting in ascending order puts everything where it belongs.
+    for (int t { 0 }; t < numTo; ++t)
+    {
+        if (matches[static_cast<size_t> (t)] < 0)
+            addEdit (Patch::EditType::insertChild, t, -1)->child =
+                to.getChild (t).createCopy ();
+    }
+
+    // 4. patch the matched children in place.
+    for (int t { 0 }; t < numTo; ++t)
+    {
+        const auto f { matches[static_cast<size_t> (t)] };
+        if (f < 0)
+            continue;
+        path.push_back (t);
+        compareTrees (from.getChild (f), fromHash.children[static_cast<size_t> (f)],
+                      to.getChild (t), toHash.children[static_cast<size_t> (t)], path,
+                      patch);
+        path.pop_back ();
+    }
+}
+
+} // namespace cello
+
+#if RUN_UNIT_TESTS
+#include "test/test_cello_diff.inl"
+#endif
@@ -0,0 +1,163 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <juce_data_structures/juce_data_structures.h>
+
+namespace cello
+{
+struct HashNode;
+
+/**
+ * @class Patch
+ * @brief An edit script that transforms one ValueTree into another. Patches are
+ * created by comparing two trees with `cello::Diff`, and may be applied to a tree
+ * (or to an Object using `Object::apply()`).
+ *
+ * Edits are meant to be applied in sequence; the path and indices of each edit
+ * refer to the state of the tree after all of the edits before it were applied.
+ */
+class Patch
+{
+public:
+    enum class EditType
+    {
+        setProperty,    ///< set `property` to `value`
+        removeProperty, ///< remove `property`
+        insertChild,    ///< insert a copy of `child` at `index`
+        removeChild,    ///< remove the child at `index`
+        moveChild       ///< move the child at `index` to `newIndex`
+    };
+
+    struct Edit
+    {
+        EditType type { EditType::setProperty };
+        /// child indices leading from the root of the tree to the tree being edited
+        std::vector<int> path;
+        juce::Identifier property;
+        juce::var value;
+        juce::ValueTree child;
+        int index { -1 };
+        int newIndex { -1 };
+    };
+
+    using Iterator = std::vector<Edit>::const_iterator;
+    Iterator begin () const { return edits.begin (); }
+    Iterator end () const { return edits.end (); }
+
+    /**
+     * @return true if the two trees that were compared are equivalent.
+     */
+    bool isEmpty () const { return edits.empty (); }
+
+    /**
+     * @return number of edits in the script.
+     */
+    int size () const { return static_cast<int> (edits.size ()); }
+
+    /**
+     * @brief Perform each of the edits in the patch on `tree`. This does not begin
+     * a new undo transaction; see `Object::apply()` for that.
+     *
+     * @param tree tree that's equivalent to the `from` tree used to create the patch.
+     * @param undo optional undo manager.
+     * @return false if an edit didn't match the structure of the tree; edits
+     * before that one will already have been applied.
+     */
+    bool apply (juce::ValueTree tree, juce::UndoManager* undo = nullptr) const;
+
+private:
+    friend class Diff;
+    std::vector<Edit> edits;
+};
+
+/**
+ * @class Diff
+ * @brief Compare two ValueTrees and generate a minimal `Patch` that will
+ * transform the first into the second.
+ *
+ * Children of the two trees are matched either by their position (the default),
+ * or by the value of a key property, as is done in `Object::upsert()`. Matched
+ * children are patched in place (and moved if needed); unmatched ones are removed
+ * or inserted. Subtrees whose hashes (see `HashNode`) are identical are skipped
+ * without being compared.
+ */
+class Diff
+{
+public:
+    /**
+     * @brief Construct a new Diff object.
+     *
+     * @param key property used to match children between the trees. If invalid
+     * (the default), children are matched by position and type.
+     */
+    Diff (const juce::Identifier& key = {});
+
+    /**
+     * @brief Generate the edits needed to transform `from` into `to`. The two
+     * trees are expected to be of the same type.
+     *
+     * @param from
+     * @param to
+     * @return Patch
+     */
+    Patch compare (const juce::ValueTree& from, const juce::ValueTree& to) const;
+
+    /**
+     * @brief Generate the edits needed to transform `from` into `to`, using hashes
+     * that were already calculated for the two trees (e.g. by a `HashTracker`)
+     * instead of calculating them here.
+     *
+     * @param from
+     * @param fromHash hashes matching the current contents of `from`
+     * @param to
+     * @param toHash hashes matching the current contents of `to`
+     * @return Patch
+     */
+    Patch compare (const juce::ValueTree& from, const HashNode& fromHash,
+                   const juce::ValueTree& to, const HashNode& toHash) const;
+
+private:
+    void compareTrees (const juce::ValueTree& from, const HashNode& fromHash,
+                       const juce::ValueTree& to, const HashNode& toHash,
+                       std::vector<int>& path, Patch& patch) const;
+
+    void compareProperties (const juce::ValueTree& from, const juce::ValueTree& to,
+                            const std::vector<int>& path, Patch& patch) const;
+
+    void compareChildren (const juce::ValueTree& from, const HashNode& fromHash,
+                          const juce::ValueTree& to, const HashNode& toHash,
+                          std::vector<int>& path, Patch& patch) const;
+
+    /**
+     * @brief Decide which children of `from` correspond to which children of `to`.
+     *
+     * @return vector with an entry for each child of `to` holding the index of
+     * its match in `from`, or -1 if it has none.
+     */
+    std::vector<int> matchChildren (const juce::ValueTree& from,
+                                    const juce::ValueTree& to) const;
+
+    /// property used to match children, may be invalid.
+    juce::Identifier key;
+};
+
+} // namespace cello
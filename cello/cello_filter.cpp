@@ -0,0 +1,652 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "JuceHeader.h"
+
+#include "cello_filter.h"
+#include "cello_lazy.h"
+
+#include <atomic>
+#include <limits>
+
+#if (defined(__x86_64__) || defined(_M_X64)) && !defined(CELLO_FILTER_SCALAR)
+#define CELLO_FILTER_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define CELLO_TARGET_AVX2
+#else
+#define CELLO_TARGET_AVX2 __attribute__ ((target ("avx2")))
+#endif
+#elif defined(__aarch64__) && defined(__ARM_NEON) && !defined(CELLO_FILTER_SCALAR)
+#define CELLO_FILTER_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+using FilterOp = cello::ColumnFilter::Op;
+
+std::atomic<bool> filterScalarOnly { false };
+
+template <typename T> bool compareElement (T value, FilterOp op, T operand)
+{
+    switch (op)
+    {
+        case FilterOp::less: return value < operand;
+        case FilterOp::lessEqual: return value <= operand;
+        case FilterOp::greater: return value > operand;
+        case FilterOp::greaterEqual: return value >= operand;
+        case FilterOp::equal: return value == operand;
+        case FilterOp::notEqual: return value != operand;
+    }
+    return false;
+}
+
+template <typename T> bool inRange (T value, T low, T high)
+{
+    return low <= value && value <= high;
+}
+
+/**
+ * @brief A set of kernels for one element type, each of which evaluates 64
+ * consecutive elements into one word of a Selection.
+ */
+template <typename T> struct FilterKernels
+{
+    const char* name;
+    juce::uint64 (*compare[6]) (const T* values, T operand);
+    juce::uint64 (*range) (const T* values, T low, T high);
+};
+
+template <typename K, typename T> FilterKernels<T> makeKernels (const char* name)
+{
+    return { name,
+             { &K::template compare<FilterOp::less>, &K::template compare<FilterOp::lessEqual>,
+               &K::template compare<FilterOp::greater>,
+               &K::template compare<FilterOp::greaterEqual>,
+               &K::template compare<FilterOp::equal>, &K::template compare<FilterOp::notEqual> },
+             &K::range };
+}
+
+template <typename T> struct ScalarKernels
+{
+    template <FilterOp op> static juce::uint64 compare (const T* values, T operand)
+    {
+        juce::uint64 word { 0 };
+        for (int i { 0 }; i < 64; ++i)
+            word |= static_cast<juce::uint64> (compareElement (values[i], op, operand)) << i;
+        return word;
+    }
+
+    static juce::uint64 range (const T* values, T low, T high)
+    {
+        juce::uint64 word { 0 };
+        for (int i { 0 }; i < 64; ++i)
+            word |= static_cast<juce::uint64> (inRange (values[i], low, high)) << i;
+        return word;
+    }
+};
+
+/**
+ * @brief Kernels that evaluate `V::lanes` elements at a time. `V` supplies
+ * `load()`, `broadcast()`, and `less()`/`equal()` that return one bit per lane;
+ * the other comparisons are built from those two, with the same results for
+ * NaN as the scalar operators.
+ *
+ * This is defined once for each target so that the AVX2 copy can be compiled
+ * for AVX2 while the rest of the file isn't.
+ */
+#define CELLO_VECTOR_KERNELS(Name, target)                                           \
+    template <typename V> struct Name                                                \
+    {                                                                                \
+        using T = typename V::Scalar;                                                \
+                                                                                     \
+        template <FilterOp op> target static juce::uint64 compare (const T* values,  \
+                                                                   T operand)       \
+        {                                                                            \
+            const auto rhs { V::broadcast (operand) };                               \
+            juce::uint64 word { 0 };                                                 \
+            for (int i { 0 }; i < 64; i += V::lanes)                                 \
+            {                                                                        \
+                const auto lhs { V::load (values + i) };                             \
+                unsigned mask;                                                       \
+                if constexpr (op == FilterOp::less)                                  \
+                    mask = V::less (lhs, rhs);                                       \
+                else if constexpr (op == FilterOp::lessEqual)                        \
+                    mask = V::less (lhs, rhs) | V::equal (lhs, rhs);                 \
+                else if constexpr (op == FilterOp::greater)                          \
+                    mask = V::less (rhs, lhs);                                       \
+                else if constexpr (op == FilterOp::greaterEqual)                     \
+                    mask = V::less (rhs, lhs) | V::equal (lhs, rhs);                 \
+                else if constexpr (op == FilterOp::equal)                            \
+                    mask = V::equal (lhs, rhs);                                      \
+                else                                                                 \
+                    mask = ~V::equal (lhs, rhs) & V::allLanes;                       \
+                word |= static_cast<juce::uint64> (mask) << i;                       \
+            }                                                                        \
+            return word;                                                             \
+        }                                                                            \
+                                                                                     \
+        target static juce::uint64 range (const T* values, T low, T high)            \
+        {                                                                            \
+            const auto lo { V::broadcast (low) };                                    \
+            const auto hi { V::broadcast (high) };                                   \
+            juce::uint64 word { 0 };                                                 \
+            for (int i { 0 }; i < 64; i += V::lanes)                                 \
+            {                                                                        \
+                const auto v { V::load (values + i) };                               \
+                const auto mask { (V::less (lo, v) | V::equal (lo, v)) &             \
+                                  (V::less (v, hi) | V::equal (v, hi)) };            \
+                word |= static_cast<juce::uint64> (mask) << i;                       \
+            }                                                                        \
+            return word;                                                             \
+        }                                                                            \
+    };
+
+#if CELLO_FILTER_X86
+CELLO_VECTOR_KERNELS (Sse2Kernels, )
+CELLO_VECTOR_KERNELS (Avx2Kernels, CELLO_TARGET_AVX2)
+
+// SSE2 is part of the x86-64 baseline, so these need no special target.
+struct Sse2Float
+{
+    using Scalar = float;
+    using Vec    = __m128;
+    static constexpr int lanes { 4 };
+    static constexpr unsigned allLanes { 0xf };
+
+    static Vec load (const float* p) { return _mm_loadu_ps (p); }
+    static Vec broadcast (float value) { return _mm_set1_ps (value); }
+    static unsigned less (Vec a, Vec b)
+    {
+        return static_cast<unsigned> (_mm_movemask_ps (_mm_cmplt_ps (a, b)));
+    }
+    static unsigned equal (Vec a, Vec b)
+    {
+        return static_cast<unsigned> (_mm_movemask_ps (_mm_cmpeq_ps (a, b)));
+    }
+};
+
+struct Sse2Double
+{
+    using Scalar = double;
+    using Vec    = __m128d;
+    static constexpr int lanes { 2 };
+    static constexpr unsigned allLanes { 0x3 };
+
+    static Vec load (const double* p) { return _mm_loadu_pd (p); }
+    static Vec broadcast (double value) { return _mm_set1_pd (value); }
+    static unsigned less (Vec a, Vec b)
+    {
+        return static_cast<unsigned> (_mm_movemask_pd (_mm_cmplt_pd (a, b)));
+    }
+    static unsigned equal (Vec a, Vec b)
+    {
+        return static_cast<unsigned> (_mm_movemask_pd (_mm_cmpeq_pd (a, b)));
+    }
+};
+
+struct Sse2Int
+{
+    using Scalar = int;
+    using Vec    = __m128i;
+    static constexpr int lanes { 4 };
+    static constexpr unsigned allLanes { 0xf };
+
+    static Vec load (const int* p) { return _mm_loadu_si128 (reinterpret_cast<const Vec*> (p)); }
+    static Vec broadcast (int value) { return _mm_set1_epi32 (value); }
+    static unsigned less (Vec a, Vec b)
+    {
+        return static_cast<unsigned> (_mm_movemask_ps (_mm_castsi128_ps (_mm_cmplt_epi32 (a, b))));
+    }
+    static unsigned equal (Vec a, Vec b)
+    {
+        return static_cast<unsigned> (_mm_movemask_ps (_mm_castsi128_ps (_mm_cmpeq_epi32 (a, b))));
+    }
+};
+
+struct Avx2Float
+{
+    using Scalar = float;
+    using Vec    = __m256;
+    static constexpr int lanes { 8 };
+    static constexpr unsigned allLanes { 0xff };
+
+    CELLO_TARGET_AVX2 static Vec load (const float* p) { return _mm256_loadu_ps (p); }
+    CELLO_TARGET_AVX2 static Vec broadcast (float value) { return _mm256_set1_ps (value); }
+    CELLO_TARGET_AVX2 static unsigned less (Vec a, Vec b)
+    {
+        return static_cast<unsigned> (_mm256_movemask_ps (_mm256_cmp_ps (a, b, _CMP_LT_OQ)));
+    }
+    CELLO_TARGET_AVX2 static unsigned equal (Vec a, Vec b)
+    {
+        return static_cast<unsigned> (_mm256_movemask_ps (_mm256_cmp_ps (a, b, _CMP_EQ_OQ)));
+    }
+};
+
+struct Avx2Double
+{
+    using Scalar = double;
+    using Vec    = __m256d;
+    static constexpr int lanes { 4 };
+    static constexpr unsigned allLanes { 0xf };
+
+    CELLO_TARGET_AVX2 static Vec load (const double* p) { return _mm256_loadu_pd (p); }
+    CELLO_TARGET_AVX2 static Vec broadcast (double value) { return _mm256_set1_pd (value); }
+    CELLO_TARGET_AVX2 static unsigned less (Vec a, Vec b)
+    {
+        return static_cast<unsigned> (_mm256_movemask_pd (_mm256_cmp_pd (a, b, _CMP_LT_OQ)));
+    }
+    CELLO_TARGET_AVX2 static unsigned equal (Vec a, Vec b)
+    {
+        return static_cast<unsigned> (_mm256_movemask_pd (_mm256_cmp_pd (a, b, _CMP_EQ_OQ)));
+    }
+};
+
+struct Avx2Int
+{
+    using Scalar = int;
+    using Vec    = __m256i;
+    static constexpr int lanes { 8 };
+    static constexpr unsigned allLanes { 0xff };
+
+    CELLO_TARGET_AVX2 static Vec load (const int* p)
+    {
+        return _mm256_loadu_si256 (reinterpret_cast<const Vec*> (p));
+    }
+    CELLO_TARGET_AVX2 static Vec broadcast (int value) { return _mm256_set1_epi32 (value); }
+    CELLO_TARGET_AVX2 static unsigned less (Vec a, Vec b)
+    {
+        return movemask (_mm256_cmpgt_epi32 (b, a));
+    }
+    CELLO_TARGET_AVX2 static unsigned equal (Vec a, Vec b)
+    {
+        return movemask (_mm256_cmpeq_epi32 (a, b));
+    }
+    CELLO_TARGET_AVX2 static unsigned movemask (Vec mask)
+    {
+        return static_cast<unsigned> (_mm256_movemask_ps (_mm256_castsi256_ps (mask)));
+    }
+};
+
+bool cpuHasAvx2 ()
+{
+    static const bool supported = [] ()
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        int info[4] {};
+        __cpuid (info, 1);
+        // the OS must also save the AVX registers on a context switch.
+        const bool osSavesYmm { (info[2] & (1 << 27)) != 0 && (_xgetbv (0) & 6) == 6 };
+        if (!osSavesYmm)
+            return false;
+        __cpuidex (info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        __builtin_cpu_init ();
+        return __builtin_cpu_supports ("avx2") != 0;
+#endif
+    }();
+    return supported;
+}
+
+template <typename T> struct VectorTypes;
+template <> struct VectorTypes<float>
+{
+    using Sse2 = Sse2Float;
+    using Avx2 = Avx2Float;
+};
+template <> struct VectorTypes<double>
+{
+    using Sse2 = Sse2Double;
+    using Avx2 = Avx2Double;
+};
+template <> struct VectorTypes<int>
+{
+    using Sse2 = Sse2Int;
+    using Avx2 = Avx2Int;
+};
+#elif CELLO_FILTER_NEON
+CELLO_VECTOR_KERNELS (NeonKernels, )
+
+struct NeonFloat
+{
+    using Scalar = float;
+    using Vec    = float32x4_t;
+    static constexpr int lanes { 4 };
+    static constexpr unsigned allLanes { 0xf };
+
+    static Vec load (const float* p) { return vld1q_f32 (p); }
+    static Vec broadcast (float value) { return vdupq_n_f32 (value); }
+    static unsigned less (Vec a, Vec b) { return movemask (vcltq_f32 (a, b)); }
+    static unsigned equal (Vec a, Vec b) { return movemask (vceqq_f32 (a, b)); }
+    static unsigned movemask (uint32x4_t mask)
+    {
+        static const juce::uint32 weights[] { 1, 2, 4, 8 };
+        return vaddvq_u32 (vandq_u32 (mask, vld1q_u32 (weights)));
+    }
+};
+
+struct NeonDouble
+{
+    using Scalar = double;
+    using Vec    = float64x2_t;
+    static constexpr int lanes { 2 };
+    static constexpr unsigned allLanes { 0x3 };
+
+    static Vec load (const double* p) { return vld1q_f64 (p); }
+    static Vec broadcast (double value) { return vdupq_n_f64 (value); }
+    static unsigned less (Vec a, Vec b) { return movemask (vcltq_f64 (a, b)); }
+    static unsigned equal (Vec a, Vec b) { return movemask (vceqq_f64 (a, b)); }
+    static unsigned movemask (uint64x2_t mask)
+    {
+        static const juce::uint64 weights[] { 1, 2 };
+        return static_cast<unsigned> (vaddvq_u64 (vandq_u64 (mask, vld1q_u64 (weights))));
+    }
+};
+
+struct NeonInt
+{
+    using Scalar = int;
+    using Vec    = int32x4_t;
+    static constexpr int lanes { 4 };
+    static constexpr unsigned allLanes { 0xf };
+
+    static Vec load (const int* p) { return vld1q_s32 (p); }
+    static Vec broadcast (int value) { return vdupq_n_s32 (value); }
+    static unsigned less (Vec a, Vec b) { return NeonFloat::movemask (vcltq_s32 (a, b)); }
+    static unsigned equal (Vec a, Vec b) { return NeonFloat::movemask (vceqq_s32 (a, b)); }
+};
+
+template <typename T> struct VectorTypes;
+template <> struct VectorTypes<float>
+{
+    using Neon = NeonFloat;
+};
+template <> struct VectorTypes<double>
+{
+    using Neon = NeonDouble;
+};
+template <> struct VectorTypes<int>
+{
+    using Neon = NeonInt;
+};
+#endif
+
+template <typename T> const FilterKernels<T>& getKernels ()
+{
+    static const auto scalar { makeKernels<ScalarKernels<T>, T> ("scalar") };
+    if (filterScalarOnly.load (std::memory_order_relaxed))
+        return scalar;
+#if CELLO_FILTER_X86
+    static const auto sse2 { makeKernels<Sse2Kernels<typename VectorTypes<T>::Sse2>, T> ("sse2") };
+    static const auto avx2 { makeKernels<Avx2Kernels<typename VectorTypes<T>::Avx2>, T> ("avx2") };
+    return cpuHasAvx2 () ? avx2 : sse2;
+#elif CELLO_FILTER_NEON
+    static const auto neon { makeKernels<NeonKernels<typename VectorTypes<T>::Neon>, T> ("neon") };
+    return neon;
+#else
+    return scalar;
+#endif
+}
+
+/**
+ * @brief Run a kernel over each full word of the selection, then finish any
+ * remaining elements one at a time.
+ */
+template <typename T, typename Kernel, typename Element>
+cello::Selection runKernel (const T* values, size_t count, Kernel&& kernel, Element&& element)
+{
+    cello::Selection result { count };
+    auto* words { result.getWords () };
+    const auto fullWords { count / 64 };
+    for (size_t word { 0 }; word < fullWords; ++word)
+        words[word] = kernel (values + word * 64);
+    for (auto i { fullWords * 64 }; i < count; ++i)
+    {
+        if (element (values[i]))
+            result.set (i, true);
+    }
+    return result;
+}
+
+template <typename T>
+cello::Selection compareValues (const T* values, size_t count, FilterOp op, T operand)
+{
+    const auto kernel { getKernels<T> ().compare[static_cast<size_t> (op)] };
+    return runKernel (
+        values, count, [kernel, operand] (const T* block) { return kernel (block, operand); },
+        [op, operand] (T value) { return compareElement (value, op, operand); });
+}
+
+template <typename T>
+cello::Selection rangeOfValues (const T* values, size_t count, T low, T high)
+{
+    const auto kernel { getKernels<T> ().range };
+    return runKernel (
+        values, count, [kernel, low, high] (const T* block) { return kernel (block, low, high); },
+        [low, high] (T value) { return inRange (value, low, high); });
+}
+
+} // namespace
+
+namespace cello
+{
+
+Selection::Selection (size_t size, bool selected)
+: bits ((size + 63) / 64, selected ? ~juce::uint64 { 0 } : 0)
+, numBits { size }
+{
+    // keep the unused bits of the last word clear.
+    if (selected && (size % 64) != 0)
+        bits.back () = (juce::uint64 { 1 } << (size % 64)) - 1;
+}
+
+void Selection::set (size_t index, bool selected) noexcept
+{
+    jassert (index < numBits);
+    const auto mask { juce::uint64 { 1 } << (index % 64) };
+    if (selected)
+        bits[index / 64] |= mask;
+    else
+        bits[index / 64] &= ~mask;
+}
+
+size_t Selection::count () const noexcept
+{
+    size_t total { 0 };
+    for (auto word : bits)
+        total += static_cast<size_t> (juce::countNumberOfBits (word));
+    return total;
+}
+
+Selection& Selection::operator&= (const Selection& other) noexcept
+{
+    jassert (other.numBits == numBits);
+    for (size_t i { 0 }; i < bits.size (); ++i)
+        bits[i] &= other.bits[i];
+    return *this;
+}
+
+Selection& Selection::operator|= (const Selection& other) noexcept
+{
+    jassert (other.numBits == numBits);
+    for (size_t i { 0 }; i < bits.size (); ++i)
+        bits[i] |= other.bits[i];
+    return *this;
+}
+
+Selection ColumnFilter::compare (const float* values, size_t count, Op op, float operand)
+{
+    return compareValues (values, count, op, operand);
+}
+
+Selection ColumnFilter::compare (const double* values, size_t count, Op op, double operand)
+{
+    return compareValues (values, count, op, operand);
+}
+
+Selection ColumnFilter::compare (const int* values, size_t count, Op op, int operand)
+{
+    return compareValues (values, count, op, operand);
+}
+
+Selection ColumnFilter::range (const float* values, size_t count, float low, float high)
+{
+    return rangeOfValues (values, count, low, high);
+}
+
+Selection ColumnFilter::range (const double* values, size_t count, double low, double high)
+{
+    return rangeOfValues (values, count, low, high);
+}
+
+Selection ColumnFilter::range (const int* values, size_t count, int low, int high)
+{
+    return rangeOfValues (values, count, low, high);
+}
+
+juce::String ColumnFilter::getKernelName ()
+{
+    return getKernels<float> ().name;
+}
+
+void ColumnFilter::setScalarOnly (bool shouldUseScalar)
+{
+    filterScalarOnly.store (shouldUseScalar, std::memory_order_relaxed);
+}
+
+Condition::Condition (Kind kind_)
+: kind { kind_ }
+{
+}
+
+Condition Condition::compare (const juce::Identifier& property, ColumnFilter::Op op,
+                              double operand)
+{
+    Condition condition { Kind::compare };
+    condition.property = property;
+    condition.op       = op;
+    condition.low      = operand;
+    return condition;
+}
+
+Condition Condition::range (const juce::Identifier& property, double low, double high)
+{
+    Condition condition { Kind::range };
+    condition.property = property;
+    condition.low      = low;
+    condition.high     = high;
+    return condition;
+}
+
+Condition Condition::operator&& (const Condition& rhs) const
+{
+    return combine (Kind::allOf, *this, rhs);
+}
+
+Condition Condition::operator|| (const Condition& rhs) const
+{
+    return combine (Kind::anyOf, *this, rhs);
+}
+
+Condition Condition::combine (Kind combined, const Condition& lhs, const Condition& rhs)
+{
+    Condition result { combined };
+    for (const auto* term : { &lhs, &rhs })
+    {
+        if (term->kind == combined)
+            result.terms.insert (result.terms.end (), term->terms.begin (), term->terms.end ());
+        else
+            result.terms.push_back (*term);
+    }
+    return result;
+}
+
+void Condition::collectProperties (juce::Array<juce::Identifier>& properties) const
+{
+    if (kind == Kind::compare || kind == Kind::range)
+        properties.addIfNotAlreadyThere (property);
+    for (const auto& term : terms)
+        term.collectProperties (properties);
+}
+
+Selection Condition::evaluate (const juce::ValueTree& parent) const
+{
+    juce::Array<juce::Identifier> properties;
+    collectProperties (properties);
+
+    // export every property we need in a single pass over the children.
+    std::vector<Column<double>> columns;
+    columns.reserve (static_cast<size_t> (properties.size ()));
+    for (const auto& id : properties)
+        columns.emplace_back (id, std::numeric_limits<double>::quiet_NaN ());
+
+    const auto count { static_cast<size_t> (parent.getNumChildren ()) };
+    for (auto& column : columns)
+        column.reset (count);
+    for (int i { 0 }; i < parent.getNumChildren (); ++i)
+    {
+        const auto child { LazyTree::getContents (parent, i) };
+        for (auto& column : columns)
+            column.read (child);
+    }
+    return evaluate (properties, columns, count);
+}
+
+Selection Condition::evaluate (const juce::Array<juce::Identifier>& properties,
+                               const std::vector<Column<double>>& columns, size_t count) const
+{
+    switch (kind)
+    {
+        case Kind::compare:
+        {
+            const auto& column { columns[static_cast<size_t> (properties.indexOf (property))] };
+            return ColumnFilter::compare (column, op, low);
+        }
+        case Kind::range:
+        {
+            const auto& column { columns[static_cast<size_t> (properties.indexOf (property))] };
+            return ColumnFilter::range (column, low, high);
+        }
+        case Kind::allOf:
+        {
+            Selection result { count, true };
+            for (const auto& term : terms)
+                result &= term.evaluate (properties, columns, count);
+            return result;
+        }
+        case Kind::anyOf:
+        {
+            Selection result { count };
+            for (const auto& term : terms)
+                result |= term.evaluate (properties, columns, count);
+            return result;
+        }
+    }
+    jassertfalse;
+    return Selection { count };
+}
+
+} // namespace cello
+
+#if RUN_UNIT_TESTS
+#include "test/test_cello_filter.inl"
+#endif
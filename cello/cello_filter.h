@@ -0,0 +1,227 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include <vector>
+
+#include <juce_core/juce_core.h>
+#include <juce_data_structures/juce_data_structures.h>
+
+#include "cello_column.h"
+
+namespace cello
+{
+
+/**
+ * @class Selection
+ * @brief A bitmap with one bit per element of a column (or child of a tree),
+ * set for the elements that match a filter.
+ */
+class Selection
+{
+public:
+    /**
+     * @param size number of elements
+     * @param selected initial state of every element.
+     */
+    Selection (size_t size = 0, bool selected = false);
+
+    size_t size () const noexcept { return numBits; }
+
+    bool operator[] (size_t index) const noexcept
+    {
+        jassert (index < numBits);
+        return ((bits[index / 64] >> (index % 64)) & 1) != 0;
+    }
+
+    void set (size_t index, bool selected) noexcept;
+
+    /**
+     * @return the number of selected elements.
+     */
+    size_t count () const noexcept;
+
+    /**
+     * @brief Keep only the elements that are also selected in `other`, which
+     * must be the same size.
+     */
+    Selection& operator&= (const Selection& other) noexcept;
+
+    /**
+     * @brief Add the elements that are selected in `other`, which must be the
+     * same size.
+     */
+    Selection& operator|= (const Selection& other) noexcept;
+
+    /**
+     * @brief The bitmap itself: element `i` is bit `i % 64` of word `i / 64`, and
+     * bits past the end of the last word are always zero.
+     */
+    juce::uint64* getWords () noexcept { return bits.data (); }
+    const juce::uint64* getWords () const noexcept { return bits.data (); }
+    size_t getNumWords () const noexcept { return bits.size (); }
+
+private:
+    std::vector<juce::uint64> bits;
+    size_t numBits;
+};
+
+/**
+ * @class ColumnFilter
+ * @brief Filter kernels that compare every element of a contiguous array of
+ * numbers (e.g. a `cello::Column`) against a constant, producing a Selection.
+ *
+ * Elements are compared 64 at a time into each word of the Selection, using the
+ * widest vector instructions the CPU supports: AVX2 (chosen at runtime) or SSE2
+ * on x86-64, NEON on ARM64, and scalar code elsewhere (or when
+ * `CELLO_FILTER_SCALAR` is defined). Comparisons follow the rules of the scalar
+ * operators, so NaN values only match `notEqual`.
+ */
+struct ColumnFilter
+{
+    enum class Op
+    {
+        less,
+        lessEqual,
+        greater,
+        greaterEqual,
+        equal,
+        notEqual
+    };
+
+    /**
+     * @brief Select each element of `values` for which `value op operand` is true.
+     *
+     * @param values
+     * @param count
+     * @param op
+     * @param operand
+     * @return Selection of `count` elements.
+     */
+    static Selection compare (const float* values, size_t count, Op op, float operand);
+    static Selection compare (const double* values, size_t count, Op op, double operand);
+    static Selection compare (const int* values, size_t count, Op op, int operand);
+
+    /**
+     * @brief Select each element of `values` in the closed range `[low, high]`.
+     *
+     * @param values
+     * @param count
+     * @param low
+     * @param high
+     * @return Selection of `count` elements.
+     */
+    static Selection range (const float* values, size_t count, float low, float high);
+    static Selection range (const double* values, size_t count, double low, double high);
+    static Selection range (const int* values, size_t count, int low, int high);
+
+    template <typename T> static Selection compare (const Column<T>& column, Op op, T operand)
+    {
+        return compare (column.data (), column.size (), op, operand);
+    }
+
+    template <typename T> static Selection range (const Column<T>& column, T low, T high)
+    {
+        return range (column.data (), column.size (), low, high);
+    }
+
+    /**
+     * @return the name of the instruction set the kernels use: "avx2", "sse2",
+     * "neon", or "scalar".
+     */
+    static juce::String getKernelName ();
+
+    /**
+     * @brief Use the scalar kernels even if vector instructions are available, to
+     * compare the two in tests and benchmarks.
+     *
+     * @param shouldUseScalar
+     */
+    static void setScalarOnly (bool shouldUseScalar);
+};
+
+/**
+ * @class Condition
+ * @brief A numeric filter on the properties of a tree's children, combining
+ * comparisons and ranges with AND (`&&`) and OR (`||`):
+ *
+ * ```cpp
+ * using Op = cello::ColumnFilter::Op;
+ * const auto loud { cello::Condition::compare ("gain", Op::greater, 0.5) &&
+ *                   (cello::Condition::range ("note", 60, 72) ||
+ *                    cello::Condition::compare ("held", Op::equal, 1)) };
+ * ```
+ *
+ * Evaluating a Condition exports each property it uses into a `Column<double>`
+ * in a single pass over the children, runs the `ColumnFilter` kernels over the
+ * columns, and combines their Selections. Children that don't have a property
+ * are treated as having a NaN value, so they only match `notEqual`. See
+ * `Query::where()`.
+ */
+class Condition
+{
+public:
+    static Condition compare (const juce::Identifier& property, ColumnFilter::Op op,
+                              double operand);
+
+    static Condition range (const juce::Identifier& property, double low, double high);
+
+    Condition operator&& (const Condition& rhs) const;
+    Condition operator|| (const Condition& rhs) const;
+
+    /**
+     * @brief Find the children of `parent` that match this condition.
+     *
+     * @param parent
+     * @return Selection with one element per child.
+     */
+    Selection evaluate (const juce::ValueTree& parent) const;
+
+private:
+    enum class Kind
+    {
+        compare,
+        range,
+        allOf,
+        anyOf
+    };
+
+    explicit Condition (Kind kind_);
+
+    /**
+     * @brief Combine two conditions into one of `combined` kind, flattening
+     * nested terms of the same kind.
+     */
+    static Condition combine (Kind combined, const Condition& lhs, const Condition& rhs);
+
+    void collectProperties (juce::Array<juce::Identifier>& properties) const;
+
+    Selection evaluate (const juce::Array<juce::Identifier>& properties,
+                        const std::vector<Column<double>>& columns, size_t count) const;
+
+    Kind kind;
+    juce::Identifier property;
+    ColumnFilter::Op op { ColumnFilter::Op::equal };
+    double low { 0 };
+    double high { 0 };
+    std::vector<Condition> terms;
+};
+
+} // namespace cello
@@ -0,0 +1,372 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "JuceHeader.h"
+
+#include "cello_hash.h"
+#include "cello_lazy.h"
+#include "cello_object.h"
+
+namespace
+{
+juce::uint64 mix (juce::uint64 h)
+{
+    // finalizer from MurmurHash3
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+juce::uint64 combine (juce::uint64 seed, juce::uint64 value)
+{
+    return mix (seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2)));
+}
+
+juce::uint64 hashBytes (const void* data, size_t size)
+{
+    // 64-bit FNV-1a
+    juce::uint64 h { 0xcbf29ce484222325ULL };
+    const auto* bytes { static_cast<const juce::uint8*> (data) };
+    for (size_t i { 0 }; i < size; ++i)
+    {
+        h ^= bytes[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+juce::uint64 hashString (const juce::String& str)
+{
+    return hashBytes (str.toRawUTF8 (), str.getNumBytesAsUTF8 ());
+}
+
+/// multiplier for the position of each child in its parent's child hash (odd).
+constexpr juce::uint64 childMultiplier { 0xd6e8feb86659fd93ULL };
+
+/**
+ * @brief `childMultiplier` raised to the power of a child's position.
+ */
+juce::uint64 positionWeight (size_t index)
+{
+    juce::uint64 weight { 1 };
+    auto base { childMultiplier };
+    for (; index > 0; index >>= 1)
+    {
+        if ((index & 1) != 0)
+            weight *= base;
+        base *= base;
+    }
+    return weight;
+}
+
+/**
+ * @brief tags mixed into value hashes so that e.g. `1` and `"1"` differ.
+ */
+enum ValueTag : juce::uint64
+{
+    voidTag = 1,
+    undefinedTag,
+    boolTag,
+    intTag,
+    int64Tag,
+    doubleTag,
+    stringTag,
+    binaryTag,
+    arrayTag,
+    otherTag
+};
+
+} // namespace
+
+namespace cello
+{
+
+HashNode::HashNode (const juce::ValueTree& tree)
+: typeHash { hashString (tree.getType ().toString ()) }
+{
+    updateProperties (tree);
+    children.reserve (static_cast<size_t> (tree.getNumChildren ()));
+    // hash what a lazily loaded placeholder will contain, not the placeholder.
+    for (int i { 0 }; i < tree.getNumChildren (); ++i)
+        children.emplace_back (LazyTree::getContents (tree, i));
+    rehash ();
+}
+
+void HashNode::updateProperties (const juce::ValueTree& tree)
+{
+    // summed so that the order of the properties doesn't matter.
+    propertyHash = 0;
+    for (int i { 0 }; i < tree.getNumProperties (); ++i)
+    {
+        const auto name { tree.getPropertyName (i) };
+        propertyHash +=
+            combine (hashString (name.toString ()), hashValue (tree.getProperty (name)));
+    }
+}
+
+void HashNode::rehash ()
+{
+    // a polynomial in childMultiplier, so that the order of children matters.
+    childHash = 0;
+    juce::uint64 weight { 1 };
+    for (const auto& child : children)
+    {
+        childHash += mix (child.hash) * weight;
+        weight *= childMultiplier;
+    }
+    updateHash ();
+}
+
+void HashNode::childChanged (size_t index, juce::uint64 oldHash)
+{
+    jassert (index < children.size ());
+    childHash += (mix (children[index].hash) - mix (oldHash)) * positionWeight (index);
+    updateHash ();
+}
+
+void HashNode::updateHash ()
+{
+    hash = combine (combine (combine (typeHash, propertyHash), children.size ()), childHash);
+}
+
+juce::uint64 HashNode::hashValue (const juce::var& value)
+{
+    if (value.isVoid ())
+        return mix (voidTag);
+    if (value.isUndefined ())
+        return mix (undefinedTag);
+    if (value.isBool ())
+        return combine (boolTag, static_cast<bool> (value) ? 1 : 0);
+    if (value.isInt ())
+        return combine (intTag, static_cast<juce::uint64> (static_cast<int> (value)));
+    if (value.isInt64 ())
+        return combine (int64Tag,
+                        static_cast<juce::uint64> (static_cast<juce::int64> (value)));
+    if (value.isDouble ())
+    {
+        const auto d { static_cast<double> (value) };
+        juce::uint64 bits;
+        std::memcpy (&bits, &d, sizeof (bits));
+        return combine (doubleTag, bits);
+    }
+    if (value.isString ())
+        return combine (stringTag, hashString (value.toString ()));
+    if (const auto* block = value.getBinaryData ())
+        return combine (binaryTag, hashBytes (block->getData (), block->getSize ()));
+    if (const auto* array = value.getArray ())
+    {
+        juce::uint64 h { mix (arrayTag) };
+        for (const auto& element : *array)
+            h = combine (h, hashValue (element));
+        return h;
+    }
+    return combine (otherTag, hashString (value.toString ()));
+}
+
+class HashTracker::Watcher : public juce::ValueTree::Listener
+{
+public:
+    Watcher (HashTracker& owner, const juce::ValueTree& watched, Watcher* parentWatcher,
+             size_t position)
+    : tracker { owner }
+    , tree { watched }
+    , parent { parentWatcher }
+    , index { position }
+    {
+        children.reserve (static_cast<size_t> (tree.getNumChildren ()));
+        for (int i { 0 }; i < tree.getNumChildren (); ++i)
+        {
+            children.push_back (std::make_unique<Watcher> (tracker, tree.getChild (i), this,
+                                                           static_cast<size_t> (i)));
+        }
+        tree.addListener (this);
+    }
+
+    ~Watcher () override { tree.removeListener (this); }
+
+    // Our listener sees changes to our tree and all of its descendants; the
+    // watcher of the tree that changed is the one that updates the hashes.
+    // Filling in a lazily loaded placeholder doesn't change the contents (the
+    // placeholder was already hashed by them), but we still start watching the
+    // new children.
+
+    void valueTreePropertyChanged (juce::ValueTree& changedTree,
+                                   const juce::Identifier&) override
+    {
+        if (changedTree != tree || LazyTree::isMaterializing ())
+            return;
+
+        tracker.updateNode (*this,
+                            [this] (HashNode& node)
+                            {
+                                node.updateProperties (tree);
+                                node.updateHash ();
+                            });
+    }
+
+    void valueTreeChildAdded (juce::ValueTree& parentTree, juce::ValueTree& childTree) override
+    {
+        if (parentTree != tree)
+            return;
+
+        const auto position { static_cast<size_t> (tree.indexOf (childTree)) };
+        children.insert (children.begin () + static_cast<std::ptrdiff_t> (position),
+                         std::make_unique<Watcher> (tracker, childTree, this, position));
+        renumber (position + 1, children.size ());
+
+        if (LazyTree::isMaterializing ())
+            return;
+
+        tracker.updateNode (*this,
+                            [&childTree, position] (HashNode& node)
+                            {
+                                node.children.insert (
+                                    node.children.begin () + static_cast<std::ptrdiff_t> (position),
+                                    HashNode { childTree });
+                                node.rehash ();
+                            });
+    }
+
+    void valueTreeChildRemoved (juce::ValueTree& parentTree, juce::ValueTree&,
+                                int childIndex) override
+    {
+        if (parentTree != tree)
+            return;
+
+        children.erase (children.begin () + childIndex);
+        renumber (static_cast<size_t> (childIndex), children.size ());
+
+        tracker.updateNode (*this,
+                            [childIndex] (HashNode& node)
+                            {
+                                node.children.erase (node.children.begin () + childIndex);
+                                node.rehash ();
+                            });
+    }
+
+    void valueTreeChildOrderChanged (juce::ValueTree& parentTree, int oldIndex,
+                                     int newIndex) override
+    {
+        if (parentTree != tree)
+            return;
+
+        move (children, oldIndex, newIndex);
+        renumber (static_cast<size_t> (std::min (oldIndex, newIndex)),
+                  static_cast<size_t> (std::max (oldIndex, newIndex)) + 1);
+
+        tracker.updateNode (*this,
+                            [oldIndex, newIndex] (HashNode& node)
+                            {
+                                move (node.children, oldIndex, newIndex);
+                                node.rehash ();
+                            });
+    }
+
+    HashTracker& tracker;
+    juce::ValueTree tree;
+    /// watcher of our tree's parent (nullptr for the tracked tree).
+    Watcher* parent;
+    /// our tree's position in its parent.
+    size_t index;
+    std::vector<std::unique_ptr<Watcher>> children;
+
+private:
+    void renumber (size_t start, size_t end)
+    {
+        for (auto i { start }; i < end; ++i)
+            children[i]->index = i;
+    }
+
+    template <typename T> static void move (std::vector<T>& items, int oldIndex, int newIndex)
+    {
+        auto moved { std::move (items[static_cast<size_t> (oldIndex)]) };
+        items.erase (items.begin () + oldIndex);
+        items.insert (items.begin () + newIndex, std::move (moved));
+    }
+};
+
+HashTracker::HashTracker (const Object& object)
+: root { object }
+, cleanHash { root.hash }
+{
+    watcher = std::make_unique<Watcher> (*this, object, nullptr, 0);
+}
+
+HashTracker::~HashTracker () = default;
+
+juce::uint64 HashTracker::getHash (const juce::ValueTree& target) const
+{
+    std::vector<int> targetPath;
+    if (!findPath (target, targetPath))
+        return 0;
+
+    const auto* node { &root };
+    for (auto index : targetPath)
+        node = &node->children[static_cast<size_t> (index)];
+    return node->hash;
+}
+
+bool HashTracker::findPath (const juce::ValueTree& target, std::vector<int>& targetPath) const
+{
+    targetPath.clear ();
+    auto current { target };
+    while (current.isValid () && current != watcher->tree)
+    {
+        const auto parent { current.getParent () };
+        targetPath.push_back (parent.indexOf (current));
+        current = parent;
+    }
+    std::reverse (targetPath.begin (), targetPath.end ());
+    return current.isValid ();
+}
+
+template <typename Fn> void HashTracker::updateNode (const Watcher& target, Fn&& update)
+{
+    // the watchers know their positions, so we don't need to search for them.
+    path.clear ();
+    for (const auto* w { &target }; w->parent != nullptr; w = w->parent)
+        path.push_back (w->index);
+    std::reverse (path.begin (), path.end ());
+
+    nodes.clear ();
+    nodes.push_back (&root);
+    for (auto index : path)
+        nodes.push_back (&nodes.back ()->children[index]);
+
+    auto oldHash { nodes.back ()->hash };
+    update (*nodes.back ());
+
+    // each ancestor only needs to account for the one child that changed.
+    for (auto level { path.size () }; level > 0; --level)
+    {
+        auto& ancestor { *nodes[level - 1] };
+        const auto ancestorHash { ancestor.hash };
+        ancestor.childChanged (path[level - 1], oldHash);
+        oldHash = ancestorHash;
+    }
+}
+
+} // namespace cello
+
+#if RUN_UNIT_TESTS
+#include "test/test_cello_hash.inl"
+#endif
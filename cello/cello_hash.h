@@ -0,0 +1,172 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <juce_data_structures/juce_data_structures.h>
+
+namespace cello
+{
+class Object;
+
+/**
+ * @class HashNode
+ * @brief A hash of the contents of a ValueTree (its type, properties, and
+ * children), along with the hashes of each of its children, mirroring the
+ * structure of the tree.
+ *
+ * Properties are combined so that their order doesn't matter (as in
+ * `ValueTree::isEquivalentTo()`); the order of children does. Values of different
+ * types (e.g. `1` and `"1"`) hash differently.
+ *
+ * The child hashes are weighted by their position and summed, so when the hash
+ * of one child changes, its parent's hash can be updated without visiting the
+ * other children (see `childChanged()`).
+ */
+struct HashNode
+{
+    HashNode () = default;
+
+    /**
+     * @brief Calculate the hashes for `tree` and all its descendants.
+     */
+    explicit HashNode (const juce::ValueTree& tree);
+
+    /**
+     * @brief Recalculate the hash of the tree's properties.
+     */
+    void updateProperties (const juce::ValueTree& tree);
+
+    /**
+     * @brief Recalculate `hash` from the type, property and child hashes,
+     * visiting every child.
+     */
+    void rehash ();
+
+    /**
+     * @brief Update `hash` after the hash of a single child changed.
+     *
+     * @param index position of the child in `children`
+     * @param oldHash hash of the child before it changed.
+     */
+    void childChanged (size_t index, juce::uint64 oldHash);
+
+    /**
+     * @brief Recalculate `hash` after `typeHash` or `propertyHash` changed.
+     */
+    void updateHash ();
+
+    /**
+     * @brief Hash a single property value.
+     */
+    static juce::uint64 hashValue (const juce::var& value);
+
+    juce::uint64 typeHash { 0 };
+    juce::uint64 propertyHash { 0 };
+    /// sum of the child hashes, weighted by position.
+    juce::uint64 childHash { 0 };
+    /// hash of the entire subtree.
+    juce::uint64 hash { 0 };
+    std::vector<HashNode> children;
+};
+
+/**
+ * @class HashTracker
+ * @brief Maintain a content hash for every tree in an Object's subtree, updated
+ * incrementally (up the chain of ancestors) as properties and children change.
+ *
+ * Comparing hashes makes checking whether a subtree has changed (or whether two
+ * subtrees are the same) an O(1) operation; pass the tracked hashes to
+ * `Diff::compare()` to skip comparing the branches that haven't changed.
+ *
+ * The tracker listens to each tree in the subtree separately and keeps track of
+ * its position in its parent, so a property change updates one hash at each
+ * level of depth without searching for the tree that changed.
+ */
+class HashTracker
+{
+public:
+    explicit HashTracker (const Object& object);
+
+    ~HashTracker ();
+
+    /**
+     * @return hash of the entire tree being tracked.
+     */
+    juce::uint64 getHash () const { return root.hash; }
+
+    /**
+     * @brief Get the hash of a tree inside the tracked tree. This looks up the
+     * position of `tree` in each of its ancestors.
+     *
+     * @param tree
+     * @return juce::uint64, 0 if `tree` isn't part of the tracked tree.
+     */
+    juce::uint64 getHash (const juce::ValueTree& tree) const;
+
+    /**
+     * @return hashes of the tracked tree and all of its descendants.
+     */
+    const HashNode& getNode () const { return root; }
+
+    /**
+     * @brief Remember the current hash as the 'clean' state of the tree,
+     * e.g. after saving it.
+     */
+    void markClean () { cleanHash = getHash (); }
+
+    /**
+     * @return true if the tree's contents are different than they were
+     * when `markClean()` was last called (or when we were created).
+     */
+    bool isDirty () const { return getHash () != cleanHash; }
+
+private:
+    /// listens to one tree, keeping track of its position in its parent.
+    class Watcher;
+
+    /**
+     * @brief Find the child indices leading from our root to `target`.
+     *
+     * @return false if `target` isn't part of our tree.
+     */
+    bool findPath (const juce::ValueTree& target, std::vector<int>& path) const;
+
+    /**
+     * @brief Find the hash node for the tree that `watcher` listens to,
+     * change it using `update`, and then update the hashes of its ancestors.
+     */
+    template <typename Fn> void updateNode (const Watcher& watcher, Fn&& update);
+
+    /// hashes of the tree we're tracking.
+    HashNode root;
+
+    /// listeners mirroring the structure of the tree we're tracking.
+    std::unique_ptr<Watcher> watcher;
+
+    /// positions and nodes leading to the node being updated (reused between updates).
+    std::vector<size_t> path;
+    std::vector<HashNode*> nodes;
+
+    /// hash when we were last marked clean.
+    juce::uint64 cleanHash { 0 };
+};
+
+} // namespace cello
@@ -0,0 +1,73 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+namespace cello
+{
+
+/**
+ * @class StaticId
+ * @brief Stands for a property or type name that's known at compile time. Each
+ * distinct `StaticId` type creates its `juce::Identifier` once, the first time
+ * it's used, so later uses don't go through juce's global string pool (which
+ * needs a lock and a hash of the string every time an Identifier is created from
+ * text).
+ *
+ * Create these with the `CELLO_ID` macro. They convert implicitly to a
+ * `const juce::Identifier&`, so they can be passed to any function that accepts
+ * an Identifier; `cello::Object`'s constructors also accept them as the type of
+ * the Object.
+ *
+ * @tparam Tag a type with a static `text()` function returning the name.
+ */
+template <typename Tag> struct StaticId
+{
+    /**
+     * @return the Identifier, created on first use.
+     */
+    static const juce::Identifier& get ()
+    {
+        static const juce::Identifier id { Tag::text () };
+        return id;
+    }
+
+    operator const juce::Identifier& () const { return get (); }
+
+    const juce::String& toString () const { return get ().toString (); }
+};
+
+} // namespace cello
+
+/**
+ * @brief Create a `cello::StaticId` for a string literal, e.g.
+ * `CELLO_ID ("gain")`. Every use of the macro creates a distinct type, so store
+ * the result (e.g. in a `static constexpr auto`) if the same name is needed in
+ * several places.
+ */
+#define CELLO_ID(literal)                                                \
+    ([] {                                                                \
+        struct CelloIdTag                                                \
+        {                                                                \
+            static constexpr const char* text () { return literal; }    \
+        };                                                               \
+        return cello::StaticId<CelloIdTag> {};                           \
+    }())
@@ -0,0 +1,463 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "JuceHeader.h"
+
+#include "cello_journal.h"
+#include "cello_lazy.h"
+#include "cello_object.h"
+
+namespace
+{
+const char snapshotMagic[] { 'C', 'L', 'J', 'S' };
+const char journalMagic[] { 'C', 'L', 'J', 'J' };
+
+/**
+ * @brief Operations recorded in the journal.
+ */
+enum Op : juce::uint8
+{
+    setPropertyOp = 1,
+    removePropertyOp,
+    addChildOp,
+    removeChildOp,
+    moveChildOp
+};
+
+void writeHeader (juce::OutputStream& out, const char* magic, juce::int64 generation)
+{
+    out.write (magic, 4);
+    out.writeInt64 (generation);
+}
+
+bool readHeader (juce::InputStream& in, const char* magic, juce::int64& generation)
+{
+    char buffer[4];
+    if (in.read (buffer, 4) != 4 || std::memcmp (buffer, magic, 4) != 0 ||
+        in.getNumBytesRemaining () < 8)
+        return false;
+    generation = in.readInt64 ();
+    return true;
+}
+
+/**
+ * @return the generation stored in a snapshot/journal file, or -1 if
+ * the file can't be read.
+ */
+juce::int64 readGeneration (const juce::File& file, const char* magic)
+{
+    juce::FileInputStream in { file };
+    juce::int64 generation { -1 };
+    if (!in.openedOk () || !readHeader (in, magic, generation))
+        return -1;
+    return generation;
+}
+
+/**
+ * @brief Read the size of the next record in a journal.
+ * @return the record's size, or 0 at the end of the journal or at a partial
+ * record (which means we crashed while writing it).
+ */
+int readRecordSize (juce::InputStream& journal)
+{
+    if (journal.getNumBytesRemaining () < 4)
+        return 0;
+    const auto size { journal.readInt () };
+    return (size > 0 && journal.getNumBytesRemaining () >= size) ? size : 0;
+}
+
+/**
+ * @return the length of a journal up to the end of its last complete record,
+ * or -1 if it isn't a journal written against the snapshot `generation`.
+ */
+juce::int64 findJournalEnd (const juce::File& journalFile, juce::int64 generation)
+{
+    juce::FileInputStream in { journalFile };
+    juce::int64 journalGeneration;
+    if (!in.openedOk () || !readHeader (in, journalMagic, journalGeneration) ||
+        journalGeneration != generation)
+        return -1;
+
+    auto end { in.getPosition () };
+    for (auto size { readRecordSize (in) }; size > 0; size = readRecordSize (in))
+    {
+        in.setPosition (in.getPosition () + size);
+        end = in.getPosition ();
+    }
+    return end;
+}
+
+/**
+ * @brief Apply a single journal record to `tree`.
+ * @return false if the record doesn't fit the tree.
+ */
+bool applyRecord (juce::ValueTree& tree, juce::InputStream& record)
+{
+    const auto op { static_cast<juce::uint8> (record.readByte ()) };
+    auto target { tree };
+    const auto depth { record.readCompressedInt () };
+    for (int i { 0 }; i < depth && target.isValid (); ++i)
+        target = target.getChild (record.readCompressedInt ());
+
+    if (!target.isValid ())
+        return false;
+
+    switch (op)
+    {
+        case setPropertyOp:
+        {
+            const juce::Identifier name { record.readString () };
+            target.setProperty (name, juce::var::readFromStream (record), nullptr);
+            return true;
+        }
+        case removePropertyOp:
+            target.removeProperty (record.readString (), nullptr);
+            return true;
+
+        case addChildOp:
+        {
+            const auto index { record.readCompressedInt () };
+            auto child { juce::ValueTree::readFromStream (record) };
+            if (!child.isValid () || index > target.getNumChildren ())
+                return false;
+            target.addChild (child, index, nullptr);
+            return true;
+        }
+        case removeChildOp:
+        {
+            const auto index { record.readCompressedInt () };
+            if (!juce::isPositiveAndBelow (index, target.getNumChildren ()))
+                return false;
+            target.removeChild (index, nullptr);
+            return true;
+        }
+        case moveChildOp:
+        {
+            const auto oldIndex { record.readCompressedInt () };
+            const auto newIndex { record.readCompressedInt () };
+            if (!juce::isPositiveAndBelow (oldIndex, target.getNumChildren ()) ||
+                !juce::isPositiveAndBelow (newIndex, target.getNumChildren ()))
+                return false;
+            target.moveChild (oldIndex, newIndex, nullptr);
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+} // namespace
+
+namespace cello
+{
+
+class Journal::Watcher : public juce::ValueTree::Listener
+{
+public:
+    Watcher (Journal& owner, const juce::ValueTree& watched, Watcher* parentWatcher,
+             int position)
+    : journal { owner }
+    , tree { watched }
+    , parent { parentWatcher }
+    , index { position }
+    {
+        children.reserve (static_cast<size_t> (tree.getNumChildren ()));
+        for (int i { 0 }; i < tree.getNumChildren (); ++i)
+            children.push_back (std::make_unique<Watcher> (journal, tree.getChild (i), this, i));
+        tree.addListener (this);
+    }
+
+    ~Watcher () override { tree.removeListener (this); }
+
+    // Our listener sees changes to our tree and all of its descendants; the
+    // watcher of the tree that changed is the one that records them. Filling in
+    // a lazily loaded placeholder doesn't change the contents (the journal's
+    // snapshot already holds them), but we still start watching the new children.
+
+    void valueTreePropertyChanged (juce::ValueTree& changedTree,
+                                   const juce::Identifier& property) override
+    {
+        if (changedTree != tree || LazyTree::isMaterializing ())
+            return;
+
+        juce::MemoryOutputStream record;
+        const auto* value { tree.getPropertyPointer (property) };
+        journal.beginRecord (record, *this, value != nullptr ? setPropertyOp : removePropertyOp);
+        record.writeString (property.toString ());
+        if (value != nullptr)
+            value->writeToStream (record);
+        journal.endRecord (record);
+    }
+
+    void valueTreeChildAdded (juce::ValueTree& parentTree, juce::ValueTree& childTree) override
+    {
+        if (parentTree != tree)
+            return;
+
+        const auto position { tree.indexOf (childTree) };
+        children.insert (children.begin () + position,
+                         std::make_unique<Watcher> (journal, childTree, this, position));
+        renumber (position + 1, static_cast<int> (children.size ()));
+
+        if (LazyTree::isMaterializing ())
+            return;
+
+        juce::MemoryOutputStream record;
+        journal.beginRecord (record, *this, addChildOp);
+        record.writeCompressedInt (position);
+        LazyTree::withoutPlaceholders (childTree).writeToStream (record);
+        journal.endRecord (record);
+    }
+
+    void valueTreeChildRemoved (juce::ValueTree& parentTree, juce::ValueTree&,
+                                int childIndex) override
+    {
+        if (parentTree != tree)
+            return;
+
+        children.erase (children.begin () + childIndex);
+        renumber (childIndex, static_cast<int> (children.size ()));
+
+        juce::MemoryOutputStream record;
+        journal.beginRecord (record, *this, removeChildOp);
+        record.writeCompressedInt (childIndex);
+        journal.endRecord (record);
+    }
+
+    void valueTreeChildOrderChanged (juce::ValueTree& parentTree, int oldIndex,
+                                     int newIndex) override
+    {
+        if (parentTree != tree)
+            return;
+
+        auto moved { std::move (children[static_cast<size_t> (oldIndex)]) };
+        children.erase (children.begin () + oldIndex);
+        children.insert (children.begin () + newIndex, std::move (moved));
+        renumber (std::min (oldIndex, newIndex), std::max (oldIndex, newIndex) + 1);
+
+        juce::MemoryOutputStream record;
+        journal.beginRecord (record, *this, moveChildOp);
+        record.writeCompressedInt (oldIndex);
+        record.writeCompressedInt (newIndex);
+        journal.endRecord (record);
+    }
+
+    Journal& journal;
+    juce::ValueTree tree;
+    /// watcher of our tree's parent (nullptr for the journaled tree).
+    Watcher* parent;
+    /// our tree's position in its parent.
+    int index;
+    std::vector<std::unique_ptr<Watcher>> children;
+
+private:
+    void renumber (int start, int end)
+    {
+        for (auto i { start }; i < end; ++i)
+            children[static_cast<size_t> (i)]->index = i;
+    }
+};
+
+Journal::Journal (const Object& object, juce::File file_)
+: tree { object }
+, file { file_ }
+{
+    generation = readGeneration (file, snapshotMagic);
+    if (generation < 0)
+        compact ();
+    else
+    {
+        const auto journalFile { getJournalFile (file) };
+        const auto end { findJournalEnd (journalFile, generation) };
+        if (end < 0)
+        {
+            // a journal left over from an earlier snapshot can't be replayed on this one.
+            journalFile.deleteFile ();
+        }
+        else if (end < journalFile.getSize ())
+        {
+            // drop a partial record left by a crash; anything we append after it
+            // would never be replayed.
+            juce::FileOutputStream out { journalFile };
+            if (!out.openedOk () || !out.setPosition (end) || out.truncate ().failed ())
+                compact ();
+        }
+    }
+
+    watcher = std::make_unique<Watcher> (*this, tree, nullptr, 0);
+}
+
+Journal::~Journal ()
+{
+    watcher.reset ();
+    // nobody is left to report a failure to; call flush() yourself to check.
+    const auto result { flush () };
+    jassert (result.wasOk ());
+    juce::ignoreUnused (result);
+}
+
+juce::Result Journal::flush ()
+{
+    if (pending.getDataSize () == 0)
+        return juce::Result::ok ();
+
+    // if someone else wrote a new snapshot, our changes may already be in it.
+    if (readGeneration (file, snapshotMagic) != generation)
+        return compact ();
+
+    const auto journalFile { getJournalFile (file) };
+    {
+        const auto isNew { !journalFile.existsAsFile () };
+        juce::FileOutputStream out { journalFile };
+        if (!out.openedOk ())
+            return juce::Result::fail ("Unable to open " + journalFile.getFullPathName () +
+                                       " for writing");
+        // FileOutputStream appends to an existing file.
+        if (isNew)
+            writeHeader (out, journalMagic, generation);
+        out.write (pending.getData (), pending.getDataSize ());
+        out.flush ();
+        if (out.getStatus ().failed ())
+            return out.getStatus ();
+    }
+    pending.reset ();
+
+    const auto journalSize { journalFile.getSize () };
+    if (journalSize > compactMinBytes &&
+        static_cast<double> (journalSize) > compactRatio * static_cast<double> (file.getSize ()))
+        return compact ();
+
+    return juce::Result::ok ();
+}
+
+juce::Result Journal::compact ()
+{
+    const auto newGeneration { juce::jmax (generation + 1,
+                                           juce::Time::currentTimeMillis ()) };
+    auto result { writeSnapshot (tree, file, newGeneration, true) };
+    if (result.wasOk ())
+    {
+        generation = newGeneration;
+        pending.reset ();
+        getJournalFile (file).deleteFile ();
+    }
+    return result;
+}
+
+void Journal::setCompactionThreshold (juce::int64 minBytes, double ratio)
+{
+    compactMinBytes = minBytes;
+    compactRatio    = ratio;
+}
+
+juce::ValueTree Journal::load (juce::File file)
+{
+    juce::FileInputStream in { file };
+    juce::int64 generation;
+    if (!in.openedOk () || !readHeader (in, snapshotMagic, generation))
+        return {};
+
+    auto tree { juce::ValueTree::readFromStream (in) };
+    if (!tree.isValid ())
+        return {};
+
+    juce::FileInputStream journal { getJournalFile (file) };
+    juce::int64 journalGeneration;
+    if (journal.openedOk () && readHeader (journal, journalMagic, journalGeneration) &&
+        journalGeneration == generation)
+    {
+        // stop at a partial record left by a crash.
+        for (auto size { readRecordSize (journal) }; size > 0; size = readRecordSize (journal))
+        {
+            juce::MemoryBlock block;
+            journal.readIntoMemoryBlock (block, size);
+            juce::MemoryInputStream record { block, false };
+            if (!applyRecord (tree, record))
+            {
+                jassertfalse;
+                break;
+            }
+        }
+    }
+    return tree;
+}
+
+juce::Result Journal::save (const juce::ValueTree& tree, juce::File file,
+                           bool mayHavePlaceholders)
+{
+    const auto result { writeSnapshot (tree, file, juce::Time::currentTimeMillis (),
+                                       mayHavePlaceholders) };
+    if (result.wasOk ())
+        getJournalFile (file).deleteFile ();
+    return result;
+}
+
+juce::File Journal::getJournalFile (const juce::File& file)
+{
+    return file.getSiblingFile (file.getFileName () + ".journal");
+}
+
+juce::Result Journal::writeSnapshot (const juce::ValueTree& tree, const juce::File& file,
+                                     juce::int64 generation, bool mayHavePlaceholders)
+{
+    // write to a temporary file and swap it in, so a crash can't leave us with a
+    // partial snapshot.
+    juce::TemporaryFile temp { file };
+    {
+        juce::FileOutputStream out { temp.getFile () };
+        if (!out.openedOk ())
+            return juce::Result::fail ("Unable to open " +
+                                       temp.getFile ().getFullPathName () + " for writing");
+        writeHeader (out, snapshotMagic, generation);
+        // the contents of any lazily loaded placeholders, not the empty placeholders.
+        (mayHavePlaceholders ? LazyTree::withoutPlaceholders (tree) : tree).writeToStream (out);
+        out.flush ();
+        if (out.getStatus ().failed ())
+            return out.getStatus ();
+    }
+    if (!temp.overwriteTargetFileWithTemporary ())
+        return juce::Result::fail ("Error writing to " + file.getFullPathName ());
+    return juce::Result::ok ();
+}
+
+void Journal::beginRecord (juce::MemoryOutputStream& record, const Watcher& target,
+                           juce::uint8 op)
+{
+    // the watchers know their positions, so we don't need to search for them.
+    path.clear ();
+    for (const auto* w { &target }; w->parent != nullptr; w = w->parent)
+        path.push_back (w->index);
+
+    record.writeByte (static_cast<char> (op));
+    record.writeCompressedInt (static_cast<int> (path.size ()));
+    for (auto it { path.rbegin () }; it != path.rend (); ++it)
+        record.writeCompressedInt (*it);
+}
+
+void Journal::endRecord (const juce::MemoryOutputStream& record)
+{
+    pending.writeInt (static_cast<int> (record.getDataSize ()));
+    pending.write (record.getData (), record.getDataSize ());
+}
+
+} // namespace cello
+
+#if RUN_UNIT_TESTS
+#include "test/test_cello_journal.inl"
+#endif
@@ -0,0 +1,178 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <juce_core/juce_core.h>
+#include <juce_data_structures/juce_data_structures.h>
+
+namespace cello
+{
+class Object;
+
+/**
+ * @class Journal
+ * @brief Journaled persistence for an Object: a base snapshot of the tree, plus an
+ * append-only log of the property and child changes made to it since the snapshot
+ * was written. Saving only appends the changes made since the last save, so its cost
+ * scales with the size of the edits and not the size of the document.
+ *
+ * The snapshot is stored in the file passed to the constructor, and the journal in a
+ * sibling file with ".journal" appended to its name (see `getJournalFile()`). Load
+ * both with `Object::load (file, Object::FileFormat::journaled)` (or the static
+ * `Journal::load()`), which reads the snapshot and then replays the journal.
+ *
+ * When the journal grows past a threshold, the next `flush()` compacts it by
+ * writing a new snapshot and starting an empty journal.
+ *
+ * Changes are captured from the tree's listener callbacks on the thread that makes
+ * them; the Journal should only be used from that thread.
+ */
+class Journal
+{
+public:
+    /**
+     * @brief Start journaling changes made to `object`.
+     *
+     * If `file` doesn't exist yet, a snapshot of the object's current state is
+     * written to it immediately. If it does exist, the object is expected to have
+     * been loaded from it (and its journal), and new changes will be appended to
+     * that journal, after dropping any partial record at its end.
+     *
+     * @param object
+     * @param file file containing the base snapshot.
+     */
+    Journal (const Object& object, juce::File file);
+
+    /**
+     * @brief Flushes any changes that haven't been written yet. A failure
+     * here can't be reported (and asserts in debug builds), so call `flush()`
+     * yourself first if you need to handle errors.
+     */
+    ~Journal ();
+
+    /**
+     * @brief Append the changes made since the last flush to the journal,
+     * compacting it if it has grown too large.
+     *
+     * @return juce::Result
+     */
+    juce::Result flush ();
+
+    /**
+     * @brief Write a new snapshot of the tree's current state and start an
+     * empty journal.
+     *
+     * @return juce::Result
+     */
+    juce::Result compact ();
+
+    /**
+     * @brief Control when `flush()` will compact the journal: when it's larger than
+     * both `minBytes` and `ratio` times the size of the snapshot.
+     *
+     * @param minBytes
+     * @param ratio
+     */
+    void setCompactionThreshold (juce::int64 minBytes, double ratio);
+
+    /**
+     * @return number of bytes of changes waiting to be flushed.
+     */
+    size_t getPendingSize () const { return pending.getDataSize (); }
+
+    /**
+     * @brief Load a tree from its snapshot, replaying any changes found in the
+     * journal. A partial record at the end of the journal (e.g. from a crash
+     * while writing it) is ignored.
+     *
+     * @param file file containing the base snapshot.
+     * @return juce::ValueTree, invalid if the snapshot couldn't be read.
+     */
+    static juce::ValueTree load (juce::File file);
+
+    /**
+     * @brief Write `tree` as a new base snapshot and remove any journal that
+     * was written against the previous snapshot.
+     *
+     * @param tree
+     * @param file
+     * @param mayHavePlaceholders pass false if `tree` can't contain any lazily
+     * loaded placeholders, to save it without looking them up (see
+     * `LazyTree::save()`).
+     * @return juce::Result
+     */
+    static juce::Result save (const juce::ValueTree& tree, juce::File file,
+                              bool mayHavePlaceholders = true);
+
+    /**
+     * @return the journal file that accompanies a snapshot file.
+     */
+    static juce::File getJournalFile (const juce::File& file);
+
+private:
+    /// listens to one tree, keeping track of its position in its parent.
+    class Watcher;
+
+    /**
+     * @brief Write a snapshot tagged with a generation number; a journal is only
+     * replayed on top of a snapshot with the same generation.
+     */
+    static juce::Result writeSnapshot (const juce::ValueTree& tree, const juce::File& file,
+                                       juce::int64 generation, bool mayHavePlaceholders);
+
+    /**
+     * @brief Start a record for a change to the tree that `watcher` listens to,
+     * writing the path of child indices that leads to it from our tree.
+     */
+    void beginRecord (juce::MemoryOutputStream& record, const Watcher& watcher,
+                      juce::uint8 op);
+
+    /**
+     * @brief Append a finished record to the `pending` buffer.
+     */
+    void endRecord (const juce::MemoryOutputStream& record);
+
+private:
+    /// the tree being journaled.
+    juce::ValueTree tree;
+
+    /// the base snapshot file.
+    juce::File file;
+
+    /// generation of the current snapshot.
+    juce::int64 generation { 0 };
+
+    /// encoded changes that haven't been written yet.
+    juce::MemoryOutputStream pending;
+
+    /// listeners mirroring the structure of the tree being journaled.
+    std::unique_ptr<Watcher> watcher;
+
+    /// child indices leading to the tree being recorded (reused between records).
+    std::vector<int> path;
+
+    juce::int64 compactMinBytes { 1024 * 1024 };
+    double compactRatio { 0.5 };
+};
+
+} // namespace cello
@@ -0,0 +1,744 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "JuceHeader.h"
+
+#include "cello_json.h"
+#include "cello_lazy.h"
+
+namespace
+{
+constexpr size_t jsonBufferSize { 32 * 1024 };
+
+/// deeper nesting than this is treated as malformed input.
+constexpr int maxJsonDepth { 1000 };
+
+const juce::Identifier typeKey { "type" };
+const juce::Identifier propertiesKey { "properties" };
+const juce::Identifier childrenKey { "children" };
+const juce::Identifier base64Key { "base64" };
+
+/**
+ * @brief Writes JSON text to a stream through a buffer, so that building the
+ * text of a large tree doesn't involve any string concatenation.
+ */
+class JsonWriter
+{
+public:
+    JsonWriter (juce::OutputStream& outputStream, bool oneLine)
+    : stream { outputStream }
+    , allOnOneLine { oneLine }
+    {
+        buffer.reserve (jsonBufferSize + 64);
+    }
+
+    bool writeTree (const juce::ValueTree& tree, int depth)
+    {
+        put ('{');
+        newLine (depth + 1);
+        writeKey (typeKey);
+        writeString (tree.getType ().toString ().toRawUTF8 ());
+
+        if (tree.getNumProperties () > 0)
+        {
+            put (',');
+            newLine (depth + 1);
+            writeKey (propertiesKey);
+            put ('{');
+            for (int i { 0 }; i < tree.getNumProperties (); ++i)
+            {
+                const auto name { tree.getPropertyName (i) };
+                if (i > 0)
+                    put (',');
+                newLine (depth + 2);
+                writeKey (name);
+                writeValue (*tree.getPropertyPointer (name), depth + 2);
+            }
+            newLine (depth + 1);
+            put ('}');
+        }
+
+        if (tree.getNumChildren () > 0)
+        {
+            put (',');
+            newLine (depth + 1);
+            writeKey (childrenKey);
+            put ('[');
+            for (int i { 0 }; i < tree.getNumChildren (); ++i)
+            {
+                if (i > 0)
+                    put (',');
+                newLine (depth + 2);
+                writeTree (tree.getChild (i), depth + 2);
+            }
+            newLine (depth + 1);
+            put (']');
+        }
+
+        newLine (depth);
+        put ('}');
+        return ok;
+    }
+
+    bool finish ()
+    {
+        if (!allOnOneLine)
+            put ('\n');
+        flushBuffer ();
+        return ok;
+    }
+
+private:
+    void writeValue (const juce::var& value, int depth)
+    {
+        if (value.isVoid () || value.isUndefined ())
+            put ("null");
+        else if (value.isBool ())
+            put (static_cast<bool> (value) ? "true" : "false");
+        else if (value.isInt () || value.isInt64 ())
+        {
+            char text[32];
+            const auto length { std::snprintf (text, sizeof (text), "%lld",
+                                               static_cast<long long> (
+                                                   static_cast<juce::int64> (value))) };
+            put (text, static_cast<size_t> (length));
+        }
+        else if (value.isDouble ())
+            writeDouble (static_cast<double> (value));
+        else if (value.isString ())
+            writeString (value.toString ().toRawUTF8 ());
+        else if (auto* array { value.getArray () })
+        {
+            put ('[');
+            for (int i { 0 }; i < array->size (); ++i)
+            {
+                if (i > 0)
+                    put (',');
+                writeValue (array->getReference (i), depth);
+            }
+            put (']');
+        }
+        else if (auto* block { value.getBinaryData () })
+        {
+            put ('{');
+            writeKey (base64Key);
+            const auto encoded { juce::Base64::toBase64 (block->getData (), block->getSize ()) };
+            writeString (encoded.toRawUTF8 ());
+            put ('}');
+        }
+        else if (auto* object { value.getDynamicObject () })
+        {
+            put ('{');
+            const auto& properties { object->getProperties () };
+            for (int i { 0 }; i < properties.size (); ++i)
+            {
+                if (i > 0)
+                    put (',');
+                newLine (depth + 1);
+                writeKey (properties.getName (i));
+                writeValue (properties.getValueAt (i), depth + 1);
+            }
+            if (properties.size () > 0)
+                newLine (depth);
+            put ('}');
+        }
+        else
+        {
+            // anything else is written as text, like ValueTree::toXmlString() does.
+            writeString (value.toString ().toRawUTF8 ());
+        }
+    }
+
+    void writeDouble (double value)
+    {
+        if (!std::isfinite (value))
+        {
+            put ("null");
+            return;
+        }
+
+        // use the shortest text that reads back as the same value.
+        char text[40];
+        auto length { std::snprintf (text, sizeof (text), "%.15g", value) };
+        if (std::strtod (text, nullptr) != value)
+            length = std::snprintf (text, sizeof (text), "%.17g", value);
+
+        bool isIntegral { true };
+        for (int i { 0 }; i < length; ++i)
+        {
+            if (text[i] == ',')
+                text[i] = '.'; // in case of a locale with a decimal comma
+            if (text[i] == '.' || text[i] == 'e')
+                isIntegral = false;
+        }
+        put (text, static_cast<size_t> (length));
+        if (isIntegral)
+            put (".0");
+    }
+
+    void writeKey (const juce::Identifier& key)
+    {
+        writeString (key.toString ().toRawUTF8 ());
+        put (':');
+        if (!allOnOneLine)
+            put (' ');
+    }
+
+    void writeString (const char* text)
+    {
+        static const char hexDigits[] { "0123456789abcdef" };
+        put ('"');
+        const char* run { text };
+        for (; *text != 0; ++text)
+        {
+            const auto c { static_cast<unsigned char> (*text) };
+            if (c >= 0x20 && c != '"' && c != '\\')
+                continue;
+
+            put (run, static_cast<size_t> (text - run));
+            run = text + 1;
+            switch (c)
+            {
+                case '"': put ("\\\""); break;
+                case '\\': put ("\\\\"); break;
+                case '\n': put ("\\n"); break;
+                case '\r': put ("\\r"); break;
+                case '\t': put ("\\t"); break;
+                default:
+                {
+                    const char escaped[] { '\\', 'u', '0', '0', hexDigits[c >> 4],
+                                           hexDigits[c & 0xf] };
+                    put (escaped, sizeof (escaped));
+                }
+            }
+        }
+        put (run, static_cast<size_t> (text - run));
+        put ('"');
+    }
+
+    void newLine (int depth)
+    {
+        if (allOnOneLine)
+            return;
+        put ('\n');
+        for (int i { 0 }; i < depth; ++i)
+            put ("  ");
+    }
+
+    void put (char c)
+    {
+        buffer += c;
+        if (buffer.size () >= jsonBufferSize)
+            flushBuffer ();
+    }
+
+    void put (const char* text) { put (text, std::strlen (text)); }
+
+    void put (const char* text, size_t length)
+    {
+        buffer.append (text, length);
+        if (buffer.size () >= jsonBufferSize)
+            flushBuffer ();
+    }
+
+    void flushBuffer ()
+    {
+        if (!buffer.empty () && !stream.write (buffer.data (), buffer.size ()))
+            ok = false;
+        buffer.clear ();
+    }
+
+    juce::OutputStream& stream;
+    const bool allOnOneLine;
+    std::string buffer;
+    bool ok { true };
+};
+
+/**
+ * @brief Parses JSON text from a stream, building ValueTrees as it goes.
+ */
+class JsonReader
+{
+public:
+    explicit JsonReader (juce::InputStream& inputStream)
+    : stream { inputStream }
+    , buffer (jsonBufferSize)
+    {
+    }
+
+    /**
+     * @brief Move the stream back to the first character we haven't used, if
+     * it can change its position.
+     */
+    void returnUnread ()
+    {
+        if (position < end)
+            stream.setPosition (stream.getPosition () - (end - position));
+        position = end = 0;
+    }
+
+    juce::ValueTree readTree (int depth)
+    {
+        skipWhitespace ();
+        if (depth > maxJsonDepth || next () != '{')
+            return {};
+
+        juce::String type;
+        std::vector<std::pair<juce::Identifier, juce::var>> properties;
+        std::vector<juce::ValueTree> children;
+        std::string key;
+
+        skipWhitespace ();
+        if (peek () == '}')
+            return {}; // no type
+        for (;;)
+        {
+            skipWhitespace ();
+            if (!readString (key) || !readSeparator (':'))
+                return {};
+
+            if (key == "type")
+            {
+                std::string text;
+                if (!readString (text))
+                    return {};
+                type = toJuceString (text);
+            }
+            else if (key == "properties")
+            {
+                if (!readMembers (
+                        [this, &properties, depth] (const std::string& name)
+                        {
+                            juce::var value;
+                            if (name.empty () || !readValue (value, depth + 1))
+                                return false;
+                            properties.emplace_back (toJuceString (name), std::move (value));
+                            return true;
+                        }))
+                    return {};
+            }
+            else if (key == "children")
+            {
+                skipWhitespace ();
+                if (next () != '[')
+                    return {};
+                skipWhitespace ();
+                if (peek () == ']')
+                    next ();
+                else
+                {
+                    for (;;)
+                    {
+                        auto child { readTree (depth + 1) };
+                        if (!child.isValid ())
+                            return {};
+                        children.push_back (std::move (child));
+                        skipWhitespace ();
+                        const auto c { next () };
+                        if (c == ']')
+                            break;
+                        if (c != ',')
+                            return {};
+                    }
+                }
+            }
+            else
+            {
+                juce::var ignored;
+                if (!readValue (ignored, depth + 1))
+                    return {};
+            }
+
+            skipWhitespace ();
+            const auto c { next () };
+            if (c == '}')
+                break;
+            if (c != ',')
+                return {};
+        }
+
+        if (type.isEmpty ())
+            return {};
+
+        juce::ValueTree tree { juce::Identifier { type } };
+        for (auto& property : properties)
+            tree.setProperty (property.first, std::move (property.second), nullptr);
+        for (const auto& child : children)
+            tree.appendChild (child, nullptr);
+        return tree;
+    }
+
+private:
+    bool readValue (juce::var& value, int depth)
+    {
+        skipWhitespace ();
+        if (depth > maxJsonDepth)
+            return false;
+
+        const auto c { peek () };
+        if (c == '"')
+        {
+            std::string text;
+            if (!readString (text))
+                return false;
+            value = toJuceString (text);
+            return true;
+        }
+        if (c == '[')
+        {
+            next ();
+            juce::Array<juce::var> array;
+            skipWhitespace ();
+            if (peek () == ']')
+                next ();
+            else
+            {
+                for (;;)
+                {
+                    juce::var item;
+                    if (!readValue (item, depth + 1))
+                        return false;
+                    array.add (std::move (item));
+                    skipWhitespace ();
+                    const auto separator { next () };
+                    if (separator == ']')
+                        break;
+                    if (separator != ',')
+                        return false;
+                }
+            }
+            value = std::move (array);
+            return true;
+        }
+        if (c == '{')
+            return readObject (value, depth);
+        if (c == 't')
+            return readLiteral ("true", true, value);
+        if (c == 'f')
+            return readLiteral ("false", false, value);
+        if (c == 'n')
+            return readLiteral ("null", {}, value);
+        return readNumber (value);
+    }
+
+    bool readObject (juce::var& value, int depth)
+    {
+        juce::DynamicObject::Ptr object { new juce::DynamicObject };
+        const auto ok { readMembers (
+            [this, &object, depth] (const std::string& name)
+            {
+                juce::var member;
+                if (name.empty () || !readValue (member, depth + 1))
+                    return false;
+                object->setProperty (toJuceString (name), member);
+                return true;
+            }) };
+        if (!ok)
+            return false;
+
+        // binary data is written as {"base64": "..."}
+        const auto& properties { object->getProperties () };
+        if (properties.size () == 1 && properties.getName (0) == base64Key &&
+            properties.getValueAt (0).isString ())
+        {
+            juce::MemoryOutputStream decoded;
+            if (juce::Base64::convertFromBase64 (decoded, properties.getValueAt (0).toString ()))
+            {
+                value = decoded.getMemoryBlock ();
+                return true;
+            }
+        }
+        value = object.get ();
+        return true;
+    }
+
+    /**
+     * @brief Read the members of a JSON object, calling `readMember (name)` to
+     * read the value of each one.
+     */
+    template <typename ReadFn>
+    bool readMembers (ReadFn&& readMember)
+    {
+        skipWhitespace ();
+        if (next () != '{')
+            return false;
+        skipWhitespace ();
+        if (peek () == '}')
+        {
+            next ();
+            return true;
+        }
+
+        std::string name;
+        for (;;)
+        {
+            skipWhitespace ();
+            if (!readString (name) || !readSeparator (':') || !readMember (name))
+                return false;
+            skipWhitespace ();
+            const auto c { next () };
+            if (c == '}')
+                return true;
+            if (c != ',')
+                return false;
+        }
+    }
+
+    bool readString (std::string& text)
+    {
+        text.clear ();
+        if (next () != '"')
+            return false;
+
+        for (;;)
+        {
+            auto c { next () };
+            if (c < 0)
+                return false;
+            if (c == '"')
+                return true;
+            if (c != '\\')
+            {
+                text += static_cast<char> (c);
+                continue;
+            }
+
+            c = next ();
+            switch (c)
+            {
+                case '"':
+                case '\\':
+                case '/': text += static_cast<char> (c); break;
+                case 'b': text += '\b'; break;
+                case 'f': text += '\f'; break;
+                case 'n': text += '\n'; break;
+                case 'r': text += '\r'; break;
+                case 't': text += '\t'; break;
+                case 'u':
+                {
+                    auto codePoint { readHex4 () };
+                    if (codePoint >= 0xd800 && codePoint < 0xdc00)
+                    {
+                        // a surrogate pair
+                        if (next () != '\\' || next () != 'u')
+                            return false;
+                        const auto low { readHex4 () };
+                        if (low < 0xdc00 || low >= 0xe000)
+                            return false;
+                        codePoint = 0x10000 + ((codePoint - 0xd800) << 10) + (low - 0xdc00);
+                    }
+                    if (codePoint < 0)
+                        return false;
+                    appendCodePoint (text, static_cast<juce::uint32> (codePoint));
+                    break;
+                }
+                default: return false;
+            }
+        }
+    }
+
+    int readHex4 ()
+    {
+        int value { 0 };
+        for (int i { 0 }; i < 4; ++i)
+        {
+            const auto digit { juce::CharacterFunctions::getHexDigitValue (
+                static_cast<juce::juce_wchar> (next ())) };
+            if (digit < 0)
+                return -1;
+            value = (value << 4) | digit;
+        }
+        return value;
+    }
+
+    static void appendCodePoint (std::string& text, juce::uint32 c)
+    {
+        if (c < 0x80)
+            text += static_cast<char> (c);
+        else if (c < 0x800)
+        {
+            text += static_cast<char> (0xc0 | (c >> 6));
+            text += static_cast<char> (0x80 | (c & 0x3f));
+        }
+        else if (c < 0x10000)
+        {
+            text += static_cast<char> (0xe0 | (c >> 12));
+            text += static_cast<char> (0x80 | ((c >> 6) & 0x3f));
+            text += static_cast<char> (0x80 | (c & 0x3f));
+        }
+        else
+        {
+            text += static_cast<char> (0xf0 | (c >> 18));
+            text += static_cast<char> (0x80 | ((c >> 12) & 0x3f));
+            text += static_cast<char> (0x80 | ((c >> 6) & 0x3f));
+            text += static_cast<char> (0x80 | (c & 0x3f));
+        }
+    }
+
+    bool readNumber (juce::var& value)
+    {
+        char text[64];
+        size_t length { 0 };
+        bool isIntegral { true };
+        for (;;)
+        {
+            const auto c { peek () };
+            if (c == '.' || c == 'e' || c == 'E')
+                isIntegral = false;
+            else if (!(c == '-' || c == '+' || (c >= '0' && c <= '9')))
+                break;
+            if (length == sizeof (text) - 1)
+                return false;
+            text[length++] = static_cast<char> (next ());
+        }
+        text[length] = 0;
+        if (length == 0 || (length == 1 && text[0] == '-'))
+            return false;
+
+        if (isIntegral)
+        {
+            const auto isNegative { text[0] == '-' };
+            juce::uint64 magnitude { 0 };
+            bool overflow { false };
+            for (size_t i { isNegative ? 1u : 0u }; i < length; ++i)
+            {
+                if (text[i] < '0' || text[i] > '9')
+                    return false;
+                const auto digit { static_cast<juce::uint64> (text[i] - '0') };
+                if (magnitude > (std::numeric_limits<juce::uint64>::max () - digit) / 10)
+                    overflow = true;
+                magnitude = magnitude * 10 + digit;
+            }
+
+            const auto limit { static_cast<juce::uint64> (
+                                   std::numeric_limits<juce::int64>::max ()) +
+                               (isNegative ? 1u : 0u) };
+            if (!overflow && magnitude <= limit)
+            {
+                const auto number { isNegative ? static_cast<juce::int64> (0 - magnitude)
+                                               : static_cast<juce::int64> (magnitude) };
+                if (number >= std::numeric_limits<int>::min () &&
+                    number <= std::numeric_limits<int>::max ())
+                    value = static_cast<int> (number);
+                else
+                    value = number;
+                return true;
+            }
+            // too large for an int64; fall through to read it as a double.
+        }
+
+        juce::CharPointer_ASCII start { text };
+        value = juce::CharacterFunctions::readDoubleValue (start);
+        return true;
+    }
+
+    bool readLiteral (const char* literal, const juce::var& literalValue, juce::var& value)
+    {
+        for (; *literal != 0; ++literal)
+        {
+            if (next () != *literal)
+                return false;
+        }
+        value = literalValue;
+        return true;
+    }
+
+    bool readSeparator (char separator)
+    {
+        skipWhitespace ();
+        if (next () != separator)
+            return false;
+        skipWhitespace ();
+        return true;
+    }
+
+    void skipWhitespace ()
+    {
+        for (;;)
+        {
+            const auto c { peek () };
+            if (c != ' ' && c != '\t' && c != '\n' && c != '\r')
+                return;
+            next ();
+        }
+    }
+
+    static juce::String toJuceString (const std::string& text)
+    {
+        return juce::String::fromUTF8 (text.data (), static_cast<int> (text.size ()));
+    }
+
+    int peek ()
+    {
+        if (position == end)
+        {
+            end      = stream.read (buffer.data (), static_cast<int> (jsonBufferSize));
+            position = 0;
+            if (end <= 0)
+            {
+                end = 0;
+                return -1;
+            }
+        }
+        return static_cast<unsigned char> (buffer[static_cast<size_t> (position)]);
+    }
+
+    int next ()
+    {
+        const auto c { peek () };
+        if (c >= 0)
+            ++position;
+        return c;
+    }
+
+    juce::InputStream& stream;
+    std::vector<char> buffer;
+    int position { 0 };
+    int end { 0 };
+};
+} // namespace
+
+namespace cello
+{
+
+bool JsonFormat::write (const juce::ValueTree& tree, juce::OutputStream& stream,
+                        bool allOnOneLine)
+{
+    if (!tree.isValid ())
+        return false;
+
+    JsonWriter writer { stream, allOnOneLine };
+    writer.writeTree (LazyTree::withoutPlaceholders (tree), 0);
+    return writer.finish ();
+}
+
+juce::ValueTree JsonFormat::read (juce::InputStream& stream)
+{
+    JsonReader reader { stream };
+    auto tree { reader.readTree (0) };
+    if (tree.isValid ())
+        reader.returnUnread ();
+    return tree;
+}
+
+} // namespace cello
+
+#if RUN_UNIT_TESTS
+#include "test/test_cello_json.inl"
+#endif
@@ -0,0 +1,83 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <juce_data_structures/juce_data_structures.h>
+
+namespace cello
+{
+
+/**
+ * @class JsonFormat
+ * @brief Reads and writes trees as JSON text.
+ *
+ * Each tree is written as a JSON object:
+ * ```
+ * {"type": "track", "properties": {"name": "drums", "gain": 0.5}, "children": [...]}
+ * ```
+ * `properties` and `children` are left out when they're empty. Property values
+ * map to JSON as:
+ * - void: `null`
+ * - bool: `true` or `false`
+ * - int and int64: numbers without a fraction or exponent
+ * - double: numbers that always have a fraction or exponent (e.g. `1.0`), so
+ *   they're read back as doubles. NaN and infinity can't be represented, and
+ *   are written as `null`.
+ * - String: strings
+ * - arrays: arrays
+ * - MemoryBlock: `{"base64": "..."}`, using standard base64 encoding
+ * - DynamicObject: objects
+ *
+ * When reading, numbers without a fraction or exponent become ints (or int64s,
+ * if they're too large for an int), other JSON objects become DynamicObjects,
+ * and keys other than `type`, `properties`, and `children` are ignored.
+ *
+ * Neither direction builds an intermediate `juce::var` or string representation
+ * of the whole document: the writer streams text through a small buffer, and
+ * the reader builds ValueTrees directly as it parses.
+ */
+class JsonFormat
+{
+public:
+    /**
+     * @brief Write a tree and all its descendants to a stream.
+     *
+     * @param tree
+     * @param stream
+     * @param allOnOneLine if false, the text is indented for readability.
+     * @return false if writing to the stream failed.
+     */
+    static bool write (const juce::ValueTree& tree, juce::OutputStream& stream,
+                       bool allOnOneLine = true);
+
+    /**
+     * @brief Read a tree from JSON text in the format created by `write()`.
+     * The stream is read in blocks; once the tree has been read, the stream is
+     * moved back to the position just after its closing brace. If the stream
+     * can't change its position, text following the tree may have been consumed.
+     *
+     * @param stream
+     * @return ValueTree, invalid if the stream didn't contain a valid tree.
+     */
+    static juce::ValueTree read (juce::InputStream& stream);
+};
+
+} // namespace cello
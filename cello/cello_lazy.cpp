@@ -0,0 +1,534 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "JuceHeader.h"
+
+#include "cello_lazy.h"
+
+namespace
+{
+const char lazyMagic[] { 'C', 'L', 'L', 'Z' };
+
+/**
+ * @brief The contents of a lazy file, kept in memory (ideally mapped) while any
+ * placeholders that refer to it still exist.
+ */
+class Source : public juce::ReferenceCountedObject
+{
+public:
+    using Ptr = juce::ReferenceCountedObjectPtr<Source>;
+
+    explicit Source (const juce::File& file)
+    : mapped { file, juce::MemoryMappedFile::readOnly }
+    {
+        // mapping can fail (e.g. on some network volumes); read the file instead.
+        if (mapped.getData () == nullptr)
+            file.loadFileAsData (block);
+    }
+
+    const char* getData () const
+    {
+        return static_cast<const char*> (mapped.getData () != nullptr ? mapped.getData ()
+                                                                      : block.getData ());
+    }
+
+    size_t getSize () const
+    {
+        return mapped.getData () != nullptr ? mapped.getSize () : block.getSize ();
+    }
+
+private:
+    juce::MemoryMappedFile mapped;
+    juce::MemoryBlock block;
+};
+
+/**
+ * @brief The range of a Source that holds a placeholder's data.
+ */
+class Chunk : public juce::ReferenceCountedObject
+{
+public:
+    using Ptr = juce::ReferenceCountedObjectPtr<Chunk>;
+
+    Chunk (Source::Ptr chunkSource, size_t chunkOffset, size_t chunkLength)
+    : source { chunkSource }
+    , offset { chunkOffset }
+    , length { chunkLength }
+    {
+    }
+
+    const void* getData () const { return source->getData () + offset; }
+
+    const Source::Ptr source;
+    const size_t offset;
+    const size_t length;
+};
+
+/// depth of materialize() calls on this thread.
+thread_local int materializeDepth { 0 };
+
+juce::ValueTree parseChunk (const Chunk& chunk, const juce::Identifier& type)
+{
+    auto loaded { juce::ValueTree::readFromData (chunk.getData (), chunk.length) };
+    if (!loaded.isValid () || loaded.getType () != type)
+    {
+        jassertfalse;
+        return {};
+    }
+    return loaded;
+}
+
+/**
+ * @brief Fill in `tree` (a placeholder that we've forgotten about) with the
+ * parsed data of its chunk.
+ */
+void fillIn (juce::ValueTree tree, juce::ValueTree loaded)
+{
+    ++materializeDepth;
+    // move (rather than copy) the parsed children into the placeholder.
+    std::vector<juce::ValueTree> children;
+    children.reserve (static_cast<size_t> (loaded.getNumChildren ()));
+    for (auto child : loaded)
+        children.push_back (child);
+    loaded.removeAllChildren (nullptr);
+    tree.copyPropertiesFrom (loaded, nullptr);
+    for (auto& child : children)
+        tree.appendChild (child, nullptr);
+    --materializeDepth;
+}
+
+/**
+ * @brief The placeholders among the children of a tree loaded from a lazy file,
+ * stored by their position. We listen to the tree to keep the positions current
+ * as its children are added, removed, and moved.
+ */
+class LazyRoot : private juce::ValueTree::Listener
+{
+public:
+    LazyRoot (juce::ValueTree rootTree, std::vector<Chunk::Ptr> childChunks)
+    : root { rootTree }
+    , chunks { std::move (childChunks) }
+    , numPlaceholders { static_cast<int> (chunks.size ()) }
+    {
+        root.addListener (this);
+    }
+
+    ~LazyRoot () override { root.removeListener (this); }
+
+    bool isRootOf (const juce::ValueTree& tree) const { return tree == root; }
+
+    const juce::ValueTree& getRoot () const { return root; }
+
+    int getNumPlaceholders () const { return numPlaceholders; }
+
+    Chunk* getChunk (int index) const
+    {
+        if (index < 0 || index >= static_cast<int> (chunks.size ()))
+            return nullptr;
+        return chunks[static_cast<size_t> (index)].get ();
+    }
+
+    /**
+     * @brief Forget the placeholder at `index`, which is being materialized or
+     * removed. Called on the thread that uses the tree; once the last
+     * placeholder is gone, we stop listening to the tree and let go of it
+     * there, so the registry can delete us from any thread.
+     */
+    void release (int index)
+    {
+        if (auto& chunk { chunks[static_cast<size_t> (index)] }; chunk != nullptr)
+        {
+            chunk = nullptr;
+            if (--numPlaceholders == 0)
+            {
+                root.removeListener (this);
+                root = {};
+            }
+        }
+    }
+
+    /**
+     * @return true if all of our placeholders have been materialized or removed.
+     */
+    bool isReleased () const { return numPlaceholders == 0; }
+
+    /**
+     * @return true if nothing but us refers to the root tree any more.
+     */
+    bool isAbandoned () const { return root.getReferenceCount () <= 1; }
+
+private:
+    void valueTreeChildAdded (juce::ValueTree& parentTree, juce::ValueTree& childTree) override
+    {
+        if (parentTree == root)
+        {
+            const auto index { static_cast<size_t> (root.indexOf (childTree)) };
+            chunks.insert (chunks.begin () + static_cast<std::ptrdiff_t> (index), nullptr);
+        }
+    }
+
+    void valueTreeChildRemoved (juce::ValueTree& parentTree, juce::ValueTree& childTree,
+                                int index) override
+    {
+        if (parentTree == root)
+        {
+            const auto chunk { chunks[static_cast<size_t> (index)] };
+            release (index);
+            chunks.erase (chunks.begin () + index);
+            // a removed placeholder takes its data with it, so it's intact if
+            // it's added back (e.g. by undoing the removal).
+            if (chunk != nullptr)
+            {
+                if (auto loaded { parseChunk (*chunk, childTree.getType ()) }; loaded.isValid ())
+                    fillIn (childTree, loaded);
+            }
+        }
+    }
+
+    void valueTreeChildOrderChanged (juce::ValueTree& parentTree, int oldIndex,
+                                     int newIndex) override
+    {
+        if (parentTree == root)
+        {
+            auto moved { std::move (chunks[static_cast<size_t> (oldIndex)]) };
+            chunks.erase (chunks.begin () + oldIndex);
+            chunks.insert (chunks.begin () + newIndex, std::move (moved));
+        }
+    }
+
+    juce::ValueTree root;
+    /// the data of each child of the root, or nullptr if it's not a placeholder.
+    std::vector<Chunk::Ptr> chunks;
+    std::atomic<int> numPlaceholders;
+};
+
+/**
+ * @brief Every tree loaded from a lazy file that still has placeholders.
+ */
+class Registry
+{
+public:
+    static Registry& get ()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    void add (std::unique_ptr<LazyRoot> lazyRoot)
+    {
+        const juce::ScopedLock lock { mutex };
+        prune ();
+        roots.push_back (std::move (lazyRoot));
+    }
+
+    /**
+     * @return the LazyRoot for `tree`, or nullptr if it doesn't have any
+     * placeholders.
+     */
+    LazyRoot* find (const juce::ValueTree& tree)
+    {
+        const juce::ScopedLock lock { mutex };
+        prune ();
+        for (const auto& lazyRoot : roots)
+        {
+            if (lazyRoot->isRootOf (tree))
+                return lazyRoot.get ();
+        }
+        return nullptr;
+    }
+
+    /**
+     * @return true if `tree` is, or is an ancestor of, a tree with placeholders.
+     */
+    bool containsRootIn (const juce::ValueTree& tree)
+    {
+        const juce::ScopedLock lock { mutex };
+        prune ();
+        for (const auto& lazyRoot : roots)
+        {
+            const auto& root { lazyRoot->getRoot () };
+            if (root == tree || root.isAChildOf (tree))
+                return true;
+        }
+        return false;
+    }
+
+private:
+    void prune ()
+    {
+        // deleting a LazyRoot that's still listening to its tree changes the tree,
+        // so abandoned trees are only cleaned up on the message thread (or on
+        // any thread if there isn't one).
+        const auto* messageManager { juce::MessageManager::getInstanceWithoutCreating () };
+        const auto mayDeleteAbandoned { messageManager == nullptr ||
+                                        messageManager->isThisTheMessageThread () };
+        roots.erase (std::remove_if (roots.begin (), roots.end (),
+                                     [mayDeleteAbandoned] (const auto& lazyRoot)
+                                     {
+                                         return lazyRoot->isReleased () ||
+                                                (mayDeleteAbandoned && lazyRoot->isAbandoned ());
+                                     }),
+                     roots.end ());
+    }
+
+    juce::CriticalSection mutex;
+    std::vector<std::unique_ptr<LazyRoot>> roots;
+};
+
+/**
+ * @return true if `tree` has no properties or children, so might be a
+ * placeholder; this avoids looking anything up for all other trees.
+ */
+bool mayBePlaceholder (const juce::ValueTree& tree)
+{
+    return tree.isValid () && tree.getNumProperties () == 0 && tree.getNumChildren () == 0;
+}
+
+Chunk* findChunk (const juce::ValueTree& parent, int index)
+{
+    if (!mayBePlaceholder (parent.getChild (index)))
+        return nullptr;
+    auto* lazyRoot { Registry::get ().find (parent) };
+    return lazyRoot != nullptr ? lazyRoot->getChunk (index) : nullptr;
+}
+
+juce::ValueTree copyWithoutPlaceholders (const juce::ValueTree& tree)
+{
+    juce::ValueTree copy { tree.getType () };
+    copy.copyPropertiesFrom (tree, nullptr);
+    for (int i { 0 }; i < tree.getNumChildren (); ++i)
+    {
+        // the data of a placeholder never contains placeholders itself.
+        if (const auto* chunk { findChunk (tree, i) })
+            copy.appendChild (parseChunk (*chunk, tree.getChild (i).getType ()), nullptr);
+        else
+            copy.appendChild (copyWithoutPlaceholders (tree.getChild (i)), nullptr);
+    }
+    return copy;
+}
+} // namespace
+
+namespace cello
+{
+
+juce::ValueTree LazyTree::load (juce::File file)
+{
+    const Source::Ptr source { new Source { file } };
+    const auto size { static_cast<juce::int64> (source->getSize ()) };
+    const auto footerSize { static_cast<juce::int64> (sizeof (juce::int64)) };
+    if (size < static_cast<juce::int64> (sizeof (lazyMagic)) + footerSize ||
+        std::memcmp (source->getData (), lazyMagic, sizeof (lazyMagic)) != 0)
+        return {};
+
+    juce::MemoryInputStream in { source->getData (), source->getSize (), false };
+    in.setPosition (sizeof (lazyMagic));
+    auto root { juce::ValueTree::readFromStream (in) };
+    const auto dataStart { in.getPosition () };
+
+    in.setPosition (size - footerSize);
+    const auto tableOffset { in.readInt64 () };
+    if (!root.isValid () || tableOffset < dataStart || tableOffset > size - footerSize)
+        return {};
+
+    // create a placeholder for each entry in the offset table.
+    in.setPosition (tableOffset);
+    const auto childCount { in.readCompressedInt () };
+    std::vector<Chunk::Ptr> chunks;
+    chunks.reserve (static_cast<size_t> (juce::jmax (0, childCount)));
+    for (int i { 0 }; i < childCount; ++i)
+    {
+        const auto type { in.readString () };
+        const auto offset { in.readInt64 () };
+        const auto length { in.readInt64 () };
+        if (type.isEmpty () || offset < dataStart || length < 0 || offset + length > tableOffset)
+            return {};
+
+        root.appendChild (juce::ValueTree { type }, nullptr);
+        chunks.push_back (
+            new Chunk { source, static_cast<size_t> (offset), static_cast<size_t> (length) });
+    }
+
+    if (!chunks.empty ())
+        Registry::get ().add (std::make_unique<LazyRoot> (root, std::move (chunks)));
+    return root;
+}
+
+juce::Result LazyTree::save (const juce::ValueTree& tree, juce::File file,
+                            bool mayHavePlaceholders)
+{
+    auto res { file.getParentDirectory ().createDirectory () };
+    if (res.failed ())
+        return res;
+
+    const auto source { (mayHavePlaceholders && isPlaceholder (tree)) ? withoutPlaceholders (tree)
+                                                                      : tree };
+    juce::TemporaryFile temp { file };
+    {
+        juce::FileOutputStream out { temp.getFile () };
+        if (!out.openedOk ())
+            return juce::Result::fail ("Unable to open " + file.getFullPathName () +
+                                       " for writing");
+
+        out.write (lazyMagic, sizeof (lazyMagic));
+        juce::ValueTree root { source.getType () };
+        root.copyPropertiesFrom (source, nullptr);
+        root.writeToStream (out);
+
+        struct Entry
+        {
+            juce::String type;
+            juce::int64 offset;
+            juce::int64 length;
+        };
+        std::vector<Entry> table;
+        table.reserve (static_cast<size_t> (source.getNumChildren ()));
+
+        for (int i { 0 }; i < source.getNumChildren (); ++i)
+        {
+            const auto child { source.getChild (i) };
+            const auto offset { out.getPosition () };
+            // copy unparsed data straight across.
+            if (const auto* chunk { mayHavePlaceholders ? findChunk (source, i) : nullptr })
+                out.write (chunk->getData (), chunk->length);
+            else if (mayHavePlaceholders)
+                withoutPlaceholders (child).writeToStream (out);
+            else
+                child.writeToStream (out);
+            table.push_back ({ child.getType ().toString (), offset, out.getPosition () - offset });
+        }
+
+        const auto tableOffset { out.getPosition () };
+        out.writeCompressedInt (static_cast<int> (table.size ()));
+        for (const auto& entry : table)
+        {
+            out.writeString (entry.type);
+            out.writeInt64 (entry.offset);
+            out.writeInt64 (entry.length);
+        }
+        out.writeInt64 (tableOffset);
+
+        out.flush ();
+        if (out.getStatus ().failed ())
+            return out.getStatus ();
+    }
+
+    if (!temp.overwriteTargetFileWithTemporary ())
+        return juce::Result::fail ("Error writing to " + file.getFullPathName ());
+
+    return juce::Result::ok ();
+}
+
+bool LazyTree::isPlaceholder (const juce::ValueTree& tree)
+{
+    if (!mayBePlaceholder (tree))
+        return false;
+    const auto parent { tree.getParent () };
+    return isPlaceholder (parent, parent.indexOf (tree));
+}
+
+bool LazyTree::isPlaceholder (const juce::ValueTree& parent, int index)
+{
+    return findChunk (parent, index) != nullptr;
+}
+
+bool LazyTree::materialize (juce::ValueTree tree)
+{
+    if (!mayBePlaceholder (tree))
+        return true;
+    const auto parent { tree.getParent () };
+    return materialize (parent, parent.indexOf (tree));
+}
+
+bool LazyTree::materialize (juce::ValueTree parent, int index)
+{
+    if (!mayBePlaceholder (parent.getChild (index)))
+        return true;
+    auto* lazyRoot { Registry::get ().find (parent) };
+    // hold a reference; releasing the placeholder below drops the table's.
+    const Chunk::Ptr chunk { lazyRoot != nullptr ? lazyRoot->getChunk (index) : nullptr };
+    if (chunk == nullptr)
+        return true;
+
+    auto tree { parent.getChild (index) };
+    auto loaded { parseChunk (*chunk, tree.getType ()) };
+    if (!loaded.isValid ())
+        return false;
+
+    // it's no longer a placeholder once we start filling it in.
+    lazyRoot->release (index);
+    fillIn (tree, loaded);
+    return true;
+}
+
+void LazyTree::materializeAll (juce::ValueTree tree)
+{
+    if (!containsPlaceholders (tree))
+        return;
+    materialize (tree);
+    for (int i { 0 }; i < tree.getNumChildren (); ++i)
+    {
+        materialize (tree, i);
+        materializeAll (tree.getChild (i));
+    }
+}
+
+bool LazyTree::isMaterializing ()
+{
+    return materializeDepth > 0;
+}
+
+juce::ValueTree LazyTree::getContents (const juce::ValueTree& tree)
+{
+    if (!mayBePlaceholder (tree))
+        return tree;
+    const auto parent { tree.getParent () };
+    return getContents (parent, parent.indexOf (tree));
+}
+
+juce::ValueTree LazyTree::getContents (const juce::ValueTree& parent, int index)
+{
+    if (const auto* chunk { findChunk (parent, index) })
+    {
+        const auto type { parent.getChild (index).getType () };
+        if (auto loaded { parseChunk (*chunk, type) }; loaded.isValid ())
+            return loaded;
+        return juce::ValueTree { type };
+    }
+    return parent.getChild (index);
+}
+
+bool LazyTree::containsPlaceholders (const juce::ValueTree& tree)
+{
+    return isPlaceholder (tree) || Registry::get ().containsRootIn (tree);
+}
+
+juce::ValueTree LazyTree::withoutPlaceholders (const juce::ValueTree& tree)
+{
+    if (isPlaceholder (tree))
+        return getContents (tree);
+    if (!containsPlaceholders (tree))
+        return tree;
+    return copyWithoutPlaceholders (tree);
+}
+
+} // namespace cello
+
+#if RUN_UNIT_TESTS
+#include "test/test_cello_lazy.inl"
+#endif
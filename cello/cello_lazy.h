@@ -0,0 +1,162 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <juce_data_structures/juce_data_structures.h>
+
+namespace cello
+{
+
+/**
+ * @class LazyTree
+ * @brief Saves and loads trees in a container format that can be opened
+ * without parsing the entire file.
+ *
+ * Each child of the root tree is stored as a separate chunk in juce's binary
+ * format, and an offset table at the end of the file records the type and
+ * location of each chunk. Loading a file maps it into memory and only parses the
+ * root's properties and the offset table; each child of the root is initially a
+ * *placeholder* tree that has the correct type but no properties or children.
+ * The location of each placeholder's data is kept in a table outside the tree
+ * (keyed by the placeholder's position in its parent, which is kept current as
+ * children are added, removed, or moved), so placeholders have nothing that
+ * other code would mistake for data.
+ *
+ * A placeholder is parsed in place (*materialized*) when an Object is created
+ * that wraps it (directly or with a `Path`), when it's returned by
+ * `Object::operator[]`, and by `Object::upsert()`. Code that only searches or
+ * reads values (`Object::find()`, `Query`, `Condition`,
+ * `Object::exportColumns()`) parses a separate copy of a placeholder's data
+ * instead, leaving the tree unchanged. A placeholder that's removed from the
+ * tree is materialized as it's removed, so that it still has its data if it's
+ * added back (e.g. by undoing the removal) or added to another tree.
+ *
+ * Materializing a placeholder fills it in with the regular ValueTree calls, so
+ * listeners will receive the corresponding callbacks; these aren't edits of the
+ * document's contents, and the listeners in cello (`Journal`, `ChangeFeed`,
+ * `HashTracker`, and `ChunkedStore`) ignore them. Your own listeners can check
+ * `isMaterializing()` to do the same.
+ *
+ * Code that works directly with the ValueTrees (rather than through an Object)
+ * will see the empty placeholders, and should call `getContents()`,
+ * `materialize()`, or `materializeAll()` first. Saving in other formats writes
+ * the data of any placeholders without materializing them; saving in this
+ * format copies the bytes of placeholders that haven't been materialized
+ * directly from the file they were loaded from. A copy of a tree made with
+ * `ValueTree::createCopy()` has empty trees in place of the placeholders; use
+ * `withoutPlaceholders()` instead.
+ *
+ * The file remains memory-mapped until all of its placeholders have been
+ * materialized or deleted, or nothing else refers to the loaded root tree
+ * (which is noticed the next time any lazy tree is loaded or searched for
+ * placeholders on the message thread). On Windows, a mapped file can't be replaced.
+ */
+class LazyTree
+{
+public:
+    /**
+     * @brief Open a file saved in the lazy format.
+     *
+     * @param file
+     * @return ValueTree, invalid if the file couldn't be opened or read.
+     */
+    static juce::ValueTree load (juce::File file);
+
+    /**
+     * @brief Save a tree in the lazy format, writing to a temporary file that
+     * replaces `file` when complete.
+     *
+     * @param tree
+     * @param file
+     * @param mayHavePlaceholders pass false if `tree` can't contain any
+     * placeholders (e.g. it was parsed from a snapshot of a document) to save it
+     * without looking them up, which makes this safe to call from any thread
+     * as long as nothing else is using `tree`.
+     * @return juce::Result
+     */
+    static juce::Result save (const juce::ValueTree& tree, juce::File file,
+                              bool mayHavePlaceholders = true);
+
+    /**
+     * @return true if `tree` is a placeholder that hasn't been materialized yet.
+     */
+    static bool isPlaceholder (const juce::ValueTree& tree);
+
+    /**
+     * @return true if the child of `parent` at `index` is a placeholder. When
+     * looping over children, this is faster than finding each child's index.
+     */
+    static bool isPlaceholder (const juce::ValueTree& parent, int index);
+
+    /**
+     * @brief If `tree` is a placeholder, parse its data and replace the
+     * placeholder's (empty) properties and children with it.
+     *
+     * @param tree
+     * @return false if the placeholder's data couldn't be parsed.
+     */
+    static bool materialize (juce::ValueTree tree);
+
+    /**
+     * @brief Materialize the child of `parent` at `index`, if it's a placeholder.
+     *
+     * @return false if the placeholder's data couldn't be parsed.
+     */
+    static bool materialize (juce::ValueTree parent, int index);
+
+    /**
+     * @brief Materialize any placeholders in `tree` or its descendants.
+     */
+    static void materializeAll (juce::ValueTree tree);
+
+    /**
+     * @return true while a placeholder is being filled in on this thread, i.e.
+     * during the listener callbacks that materializing causes.
+     */
+    static bool isMaterializing ();
+
+    /**
+     * @brief Get the contents of a tree to read without changing the tree: if
+     * `tree` is a placeholder, a new tree parsed from its data (which isn't part
+     * of any document, so changing it doesn't change `tree`), otherwise `tree`
+     * itself.
+     */
+    static juce::ValueTree getContents (const juce::ValueTree& tree);
+
+    /**
+     * @brief As `getContents (parent.getChild (index))`, but faster.
+     */
+    static juce::ValueTree getContents (const juce::ValueTree& parent, int index);
+
+    /**
+     * @return true if `tree` or any of its descendants is a placeholder.
+     */
+    static bool containsPlaceholders (const juce::ValueTree& tree);
+
+    /**
+     * @brief Get a tree that's equivalent to `tree` but doesn't contain any
+     * placeholders: `tree` itself if it has none, otherwise a copy with the data
+     * of each placeholder parsed into it (`tree` isn't changed).
+     */
+    static juce::ValueTree withoutPlaceholders (const juce::ValueTree& tree);
+};
+
+} // namespace cello
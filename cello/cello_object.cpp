@@ -21,6 +21,11 @@
 
 #include "cello_object.h"
 
+#if JUCE_MAC || JUCE_LINUX || JUCE_BSD || JUCE_ANDROID
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 namespace cello
 {
 
@@ -51,6 +56,9 @@ Object::Object (const juce::String& type, juce::File file, Object::FileFormat fo
 Object::Object (const Object& rhs)
 : data { rhs.data }
 , undoManager { rhs.undoManager }
+, assignMode { rhs.assignMode }
+, assignKey { rhs.assignKey }
+, saveMode { rhs.saveMode }
 {
     // register to receive callbacks when the tree changes.
     data.addListener (this);
@@ -65,11 +73,31 @@ Object::CreationType Object::wrap (const Object& other)
 }
 
 Object& Object::operator= (const Object& rhs)
+{
+    assign (rhs, assignMode);
+    return *this;
+}
+
+void Object::assign (const Object& rhs, AssignMode mode)
 {
     // can't change this object's type by doing this.
     jassert (getType () == rhs.getType ());
-    data.copyPropertiesAndChildrenFrom (rhs.data, getUndoManager ());
-    return *this;
+    const auto source { LazyTree::withoutPlaceholders (rhs.data) };
+    if (mode == AssignMode::reconcile)
+    {
+        LazyTree::materializeAll (data);
+        const auto patch { Diff { assignKey }.compare (data, source) };
+        if (!patch.apply (data, getUndoManager ()))
+            jassertfalse;
+    }
+    else
+        data.copyPropertiesAndChildrenFrom (source, getUndoManager ());
+}
+
+void Object::setAssignMode (AssignMode mode, const juce::Identifier& key)
+{
+    assignMode = mode;
+    assignKey  = key;
 }
 
 Object::~Object ()
@@ -81,7 +109,7 @@ juce::ValueTree Object::clone (bool deep) const
 {
     auto cloneTree { juce::ValueTree { getType () } };
     if (deep)
-        cloneTree.copyPropertiesAndChildrenFrom (data, nullptr);
+        cloneTree.copyPropertiesAndChildrenFrom (LazyTree::withoutPlaceholders (data), nullptr);
     else
         cloneTree.copyPropertiesFrom (data, nullptr);
     return cloneTree;
@@ -99,6 +127,9 @@ bool Object::upsert (const Object* object, const juce::Identifier& key, bool dee
 
     const auto val { object->data[key] };
 
+    // lazily loaded children don't have any properties to match yet.
+    materializeChildren ();
+
     auto existingItem { data.getChildWithProperty (key, val) };
     if (existingItem.isValid ())
     {
@@ -127,6 +158,13 @@ void Object::upsertAll (const Object* parent, const juce::Identifier& key, bool
     }
 }
 
+bool Object::apply (const Patch& patch)
+{
+    if (auto* undoMgr = getUndoManager ())
+        undoMgr->beginNewTransaction ();
+    return patch.apply (data, getUndoManager ());
+}
+
 void Object::setUndoManager (juce::UndoManager* undo)
 {
     undoManager = undo;
@@ -171,11 +209,19 @@ int Object::getNumChildren () const
     return data.getNumChildren ();
 }
 
+void Object::materializeChildren ()
+{
+    for (int i { 0 }; i < data.getNumChildren (); ++i)
+        LazyTree::materialize (data, i);
+}
+
 juce::ValueTree Object::operator[] (int index) const
 {
     if (index < 0 || index >= data.getNumChildren ())
         return {};
 
+    // a placeholder would read as empty, and writes to it would hide its data.
+    LazyTree::materialize (data, index);
     return data.getChild (index);
 }
 
@@ -268,74 +314,388 @@ bool Object::hasattr (const juce::Identifier& attr) const
     return data.hasProperty (attr);
 }
 
+Object& Object::setattrs (std::initializer_list<std::pair<juce::Identifier, juce::var>> attrs)
+{
+    auto* undo { getUndoManager () };
+    auto* excluded { getExcludedListener () };
+
+    // set everything before calling any of our callbacks, so they all see the
+    // final state; our listener callback ignores the changes while we do.
+    juce::Array<const juce::Identifier*> changed;
+    changed.ensureStorageAllocated (static_cast<int> (attrs.size ()));
+    settingAttrs = true;
+    for (const auto& [attr, value] : attrs)
+    {
+        const auto* current { data.getPropertyPointer (attr) };
+        if (current != nullptr && current->equalsWithSameType (value))
+            continue;
+        if (excluded != nullptr)
+            data.setPropertyExcludingListener (excluded, attr, value, undo);
+        else
+            data.setProperty (attr, value, undo);
+        changed.add (&attr);
+    }
+    settingAttrs = false;
+
+    if (changed.isEmpty ())
+        return *this;
+
+    ++generation;
+    // as with setting a Value, no callbacks if we're the excluded listener.
+    if (excluded == this)
+        return *this;
+
+    bool needsCatchAll { false };
+    for (const auto* attr : changed)
+    {
+        if (!callPropertyUpdater (*attr))
+            needsCatchAll = true;
+    }
+    if (needsCatchAll)
+        callPropertyUpdater (getType ());
+    return *this;
+}
+
 void Object::delattr (const juce::Identifier& attr)
 {
     data.removeProperty (attr, getUndoManager ());
 }
 
-juce::ValueTree Object::load (juce::File file, FileFormat format)
+namespace
+{
+/**
+ * @brief Parse a file directly from a memory mapping of it if possible, to
+ * avoid copying all of it onto the heap first.
+ */
+template <typename ReadFn>
+juce::ValueTree readMapped (const juce::File& file, ReadFn&& read)
 {
-    if (format == Object::FileFormat::xml)
     {
-        const auto xmlText { file.loadFileAsString () };
-        return juce::ValueTree::fromXml (xmlText);
+        const juce::MemoryMappedFile mapped { file, juce::MemoryMappedFile::readOnly };
+        if (mapped.getData () != nullptr)
+            return read (mapped.getData (), mapped.getSize ());
     }
 
-    // one of the binary formats
+    // mapping can fail (e.g. on an empty file or some network volumes); fall
+    // back to reading the file into memory.
     juce::MemoryBlock mb;
     if (!file.loadFileAsData (mb))
     {
         jassertfalse;
         return {};
     }
+    return read (mb.getData (), mb.getSize ());
+}
+
+juce::ValueTree decompressTree (const void* data, size_t size, const Codec& codec)
+{
+    juce::MemoryBlock mb;
+    if (!codec.decompress (data, size, mb))
+        return {};
+    return juce::ValueTree::readFromData (mb.getData (), mb.getSize ());
+}
+
+/**
+ * @brief Parse a tree from a block of memory in any format that doesn't need a
+ * file of its own.
+ */
+juce::ValueTree parseTree (const void* data, size_t size, Object::FileFormat format)
+{
+    if (format == Object::FileFormat::xml || format == Object::FileFormat::compact ||
+        format == Object::FileFormat::json)
+    {
+        juce::MemoryInputStream in { data, size, false };
+        return Object::load (in, format);
+    }
     if (format == Object::FileFormat::binary)
-        return juce::ValueTree::readFromData (mb.getData (), mb.getSize ());
-    else if (format == Object::FileFormat::zipped)
-        return juce::ValueTree::readFromGZIPData (mb.getData (), mb.getSize ());
+        return juce::ValueTree::readFromData (data, size);
+    if (format == Object::FileFormat::zipped)
+        return juce::ValueTree::readFromGZIPData (data, size);
+    if (format == Object::FileFormat::lz)
+        return decompressTree (data, size, LzCodec {});
 
     // unknown format
     jassertfalse;
     return {};
 }
 
-juce::Result Object::save (juce::File file, FileFormat format) const
+/**
+ * @brief Parse a file, verifying its checksum if it was saved with
+ * `SaveMode::safe`. If the file is missing, corrupt, or can't be parsed, we
+ * fall back to the backup copy of it (if there is one).
+ *
+ * Only safe saves leave a backup (other saves remove it), so if there is one,
+ * the file must have a checksum footer, and one without a footer is
+ * incomplete. The backup itself may be a file that was saved without one.
+ */
+template <typename ParseFn>
+juce::ValueTree readChecked (const juce::File& file, ParseFn&& parse)
 {
-    if (format == FileFormat::xml)
+    const auto read = [&parse] (const juce::File& source, bool footerExpected)
     {
-        auto res { file.create () };
-        if (res.wasOk ())
-        {
-            if (file.replaceWithText (data.toXmlString ()))
-                return juce::Result::ok ();
-            res = juce::Result::fail ("Error writing to " + file.getFullPathName ());
-        }
-        return res;
+        return readMapped (
+            source,
+            [&parse, footerExpected] (const void* data, size_t size) -> juce::ValueTree
+            {
+                const auto dataSize { ChecksumOutputStream::verify (data, size, footerExpected) };
+                if (dataSize < 0)
+                    return {};
+                return parse (data, static_cast<size_t> (dataSize));
+            });
+    };
+
+    const auto backup { Object::getBackupFile (file) };
+    if (file.existsAsFile ())
+    {
+        if (auto tree { read (file, backup.existsAsFile ()) }; tree.isValid ())
+            return tree;
     }
+    if (backup.existsAsFile ())
+        return read (backup, false);
+    return {};
+}
 
-    juce::FileOutputStream fos { file };
-    if (!fos.openedOk ())
+/**
+ * @brief Make a rename in `directory` durable. `FileOutputStream::flush()`
+ * already syncs a file's contents to storage, but on POSIX systems the
+ * directory entry that points at it needs to be synced separately.
+ */
+void syncDirectory (const juce::File& directory)
+{
+#if JUCE_MAC || JUCE_LINUX || JUCE_BSD || JUCE_ANDROID
+    const auto fd { ::open (directory.getFullPathName ().toRawUTF8 (), O_RDONLY) };
+    if (fd != -1)
     {
-        jassertfalse;
-        return juce::Result::fail ("Unable to open " + file.getFullPathName () +
-                                   " for writing");
+        ::fsync (fd);
+        ::close (fd);
+    }
+#else
+    juce::ignoreUnused (directory);
+#endif
+}
+
+juce::Result compressTree (const juce::ValueTree& tree, const Codec& codec, int level,
+                           juce::OutputStream& out)
+{
+    juce::MemoryOutputStream binary;
+    tree.writeToStream (binary);
+    if (!codec.compress (binary.getData (), binary.getDataSize (), out, level))
+        return juce::Result::fail ("Error compressing data");
+    return juce::Result::ok ();
+}
+
+/**
+ * @brief Write a file using `write (juce::OutputStream&)`, which returns a
+ * juce::Result. The data is written and synced to a temporary file that then
+ * replaces `file`, so readers never see a partially written file. With
+ * `SaveMode::safe`, a checksum footer is appended to the data and the previous
+ * version of the file is kept as its backup.
+ */
+template <typename WriteFn>
+juce::Result writeViaTemporaryFile (const juce::File& file, Object::SaveMode mode,
+                                    WriteFn&& write)
+{
+    auto res { file.getParentDirectory ().createDirectory () };
+    if (res.failed ())
+        return res;
+
+    juce::TemporaryFile temp { file };
+    {
+        juce::FileOutputStream fos { temp.getFile () };
+        if (!fos.openedOk ())
+        {
+            jassertfalse;
+            return juce::Result::fail ("Unable to open " + file.getFullPathName () +
+                                       " for writing");
+        }
+
+        if (mode == Object::SaveMode::safe)
+        {
+            ChecksumOutputStream checked { fos };
+            res = write (checked);
+            if (res.wasOk () && !checked.writeFooter ())
+                res = juce::Result::fail ("Error writing to " + file.getFullPathName ());
+        }
+        else
+            res = write (fos);
+        if (res.failed ())
+            return res;
+
+        // on all of juce's platforms, this also syncs the file to storage.
+        fos.flush ();
+        if (fos.getStatus ().failed ())
+            return fos.getStatus ();
     }
 
+    // if we crash between these two steps, load() finds the backup.
+    const auto backup { Object::getBackupFile (file) };
+    if (mode == Object::SaveMode::safe && file.existsAsFile () && !file.moveFileTo (backup))
+        return juce::Result::fail ("Unable to back up " + file.getFullPathName ());
+
+    // a backup left by an earlier safe save is older than the file we're
+    // writing, and would make load() expect a checksum in it; remove it first,
+    // so a crash can't leave the new file with that backup.
+    if (mode == Object::SaveMode::standard && backup.existsAsFile () && !backup.deleteFile ())
+        return juce::Result::fail ("Unable to remove " + backup.getFullPathName ());
+
+    if (!temp.overwriteTargetFileWithTemporary ())
+        return juce::Result::fail ("Error writing to " + file.getFullPathName ());
+
+    syncDirectory (file.getParentDirectory ());
+    return juce::Result::ok ();
+}
+
+/**
+ * @brief Write a tree to a file in any of our formats.
+ *
+ * @param isSnapshot true if `source` was parsed from a snapshot of a document,
+ * so doesn't contain any lazily loaded placeholders; we don't look them up, and
+ * it's safe to call this from any thread as long as nothing else is using `source`.
+ */
+juce::Result writeTree (const juce::ValueTree& source, const juce::File& file,
+                        Object::FileFormat format, Object::SaveMode mode, bool isSnapshot)
+{
+    if (format == Object::FileFormat::lazy)
+        return LazyTree::save (source, file, !isSnapshot);
+
+    // other formats need the data of any lazily loaded children.
+    const auto tree { isSnapshot ? source : LazyTree::withoutPlaceholders (source) };
+    if (format == Object::FileFormat::journaled)
+        return Journal::save (tree, file, false);
+
+    return writeViaTemporaryFile (
+        file, mode,
+        [&tree, format] (juce::OutputStream& out)
+        {
+            if (format == Object::FileFormat::xml)
+            {
+                if (!out.writeText (tree.toXmlString (), false, false, "\r\n"))
+                    return juce::Result::fail ("Error writing XML");
+            }
+            else if (format == Object::FileFormat::binary)
+                tree.writeToStream (out);
+            else if (format == Object::FileFormat::zipped)
+            {
+                juce::GZIPCompressorOutputStream zipper { out };
+                tree.writeToStream (zipper);
+            }
+            else if (format == Object::FileFormat::compact)
+            {
+                if (!CompactFormat::write (tree, out))
+                    return juce::Result::fail ("Error writing compact data");
+            }
+            else if (format == Object::FileFormat::lz)
+                return compressTree (tree, LzCodec {}, Codec::defaultLevel, out);
+            else if (format == Object::FileFormat::json)
+            {
+                if (!JsonFormat::write (tree, out))
+                    return juce::Result::fail ("Error writing JSON");
+            }
+            else
+            {
+                // unknown format
+                jassertfalse;
+                return juce::Result::fail ("Unknown file format");
+            }
+            return juce::Result::ok ();
+        });
+}
+} // namespace
+
+juce::ValueTree Object::load (juce::File file, FileFormat format)
+{
+    if (format == Object::FileFormat::journaled)
+        return Journal::load (file);
+
+    if (format == Object::FileFormat::lazy)
+        return LazyTree::load (file);
+
+    return readChecked (file, [format] (const void* data, size_t size)
+                        { return parseTree (data, size, format); });
+}
+
+juce::ValueTree Object::load (juce::File file, const Codec& codec)
+{
+    return readChecked (file, [&codec] (const void* data, size_t size)
+                        { return decompressTree (data, size, codec); });
+}
+
+juce::ValueTree Object::load (juce::InputStream& stream, FileFormat format)
+{
+    if (format == FileFormat::xml)
+        return XmlTreeReader::read (stream);
+
     if (format == FileFormat::binary)
+        return juce::ValueTree::readFromStream (stream);
+
+    if (format == FileFormat::compact)
+        return CompactFormat::read (stream);
+
+    if (format == FileFormat::json)
+        return JsonFormat::read (stream);
+
+    if (format == FileFormat::zipped)
     {
-        data.writeToStream (fos);
-        return juce::Result::ok ();
+        juce::GZIPDecompressorInputStream unzipper { stream };
+        return juce::ValueTree::readFromStream (unzipper);
     }
 
-    else if (format == FileFormat::zipped)
+    if (format == FileFormat::lz)
     {
-        juce::GZIPCompressorOutputStream zipper { fos };
-        data.writeToStream (zipper);
-        return juce::Result::ok ();
+        juce::MemoryBlock mb;
+        stream.readIntoMemoryBlock (mb);
+        return decompressTree (mb.getData (), mb.getSize (), LzCodec {});
     }
 
-    // unknown format
+    // unknown format, or one that needs a file
     jassertfalse;
-    return juce::Result::fail ("Unknown file format");
+    return {};
+}
+
+juce::Result Object::save (juce::File file, FileFormat format) const
+{
+    return writeTree (data, file, format, saveMode, false);
+}
+
+juce::Result Object::save (juce::File file, const Codec& codec, int level) const
+{
+    const auto tree { LazyTree::withoutPlaceholders (data) };
+    return writeViaTemporaryFile (file, saveMode, [&] (juce::OutputStream& out)
+                                  { return compressTree (tree, codec, level, out); });
+}
+
+void Object::setSaveMode (SaveMode mode)
+{
+    saveMode = mode;
+}
+
+juce::File Object::getBackupFile (juce::File file)
+{
+    return file.getSiblingFile (file.getFileName () + ".bak");
+}
+
+void Object::saveAsync (juce::File file, FileFormat format, SaveCompleteFn onComplete) const
+{
+    // ValueTrees aren't thread-safe, so the background thread gets a snapshot of
+    // the tree in binary form, which is much cheaper to take than a deep copy of
+    // the tree; it shares no mutable state with our tree.
+    juce::MemoryOutputStream snapshot;
+    LazyTree::withoutPlaceholders (data).writeToStream (snapshot);
+    auto job = [block = snapshot.getMemoryBlock (), file, format, mode = saveMode,
+                onComplete] ()
+    {
+        const auto tree { juce::ValueTree::readFromData (block.getData (), block.getSize ()) };
+        const auto result { writeTree (tree, file, format, mode, true) };
+        if (onComplete != nullptr)
+            onComplete (result);
+    };
+
+    if (!juce::Thread::launch (job))
+    {
+        jassertfalse;
+        if (onComplete != nullptr)
+            onComplete (juce::Result::fail ("Unable to start background save"));
+    }
 }
 
 Object::CreationType Object::wrap (const juce::String& type, juce::ValueTree tree)
@@ -384,34 +744,87 @@ Object::CreationType Object::wrap (const juce::String& type, juce::ValueTree tre
 
     // register to receive callbacks when the tree changes.
     data.addListener (this);
+    ++generation;
+    return creationType;
+}
+
+Object::CreationType Object::wrapType (const juce::Identifier& type, juce::ValueTree tree)
+{
+    // the same search that Path performs for a single segment, without parsing
+    // a path string or creating Identifiers from text.
+    creationType = CreationType::wrapped;
+    if (!tree.isValid ())
+    {
+        data         = juce::ValueTree (type);
+        creationType = CreationType::initialized;
+    }
+    else if (tree.hasType (type))
+        data = tree;
+    else
+    {
+        LazyTree::materialize (tree);
+        data = tree.getChildWithName (type);
+        if (!data.isValid ())
+        {
+            data         = juce::ValueTree (type);
+            creationType = CreationType::initialized;
+            tree.appendChild (data, nullptr);
+        }
+    }
+    LazyTree::materialize (data);
+
+    // register to receive callbacks when the tree changes.
+    data.addListener (this);
+    ++generation;
     return creationType;
 }
 
 void Object::valueTreePropertyChanged (juce::ValueTree& treeWhosePropertyHasChanged,
                                        const juce::Identifier& property)
 {
+    // filling in a lazily loaded placeholder doesn't change the contents.
+    if (LazyTree::isMaterializing ())
+        return;
+
+    // setattrs() counts its changes and calls our callbacks itself.
+    if (settingAttrs && treeWhosePropertyHasChanged == data)
+        return;
+
     if (treeWhosePropertyHasChanged == data)
     {
+        ++generation;
+
         // first, try to find a callback for that exact property.
-        for (const auto& updater : propertyUpdaters)
-        {
-            if (updater.id == property)
-            {
-                if (updater.fn != nullptr)
-                    updater.fn (property);
-                return;
-            }
-        }
+        if (callPropertyUpdater (property))
+            return;
+
         // a cello extension: register a callback on the name of the tree's
         // type, and you'll get a callback there for any property change that
         // didn't have its own callback registered.
         if (property != getType ())
-            valueTreePropertyChanged (data, getType ());
+            callPropertyUpdater (getType ());
     }
 }
 
+bool Object::callPropertyUpdater (const juce::Identifier& property)
+{
+    for (const auto& updater : propertyUpdaters)
+    {
+        if (updater.id == property)
+        {
+            if (updater.fn != nullptr)
+                updater.fn (property);
+            return true;
+        }
+    }
+    return false;
+}
+
 void Object::valueTreeChildAdded (juce::ValueTree& parentTree, juce::ValueTree& childTree)
 {
+    if (LazyTree::isMaterializing ())
+        return;
+
     if (parentTree == data && onChildAdded != nullptr)
         onChildAdded (childTree, -1, data.indexOf (childTree));
 }
@@ -441,8 +854,12 @@ void Object::valueTreeParentChanged (juce::ValueTree& tree)
 
 void Object::valueTreeRedirected (juce::ValueTree& tree)
 {
-    if (tree == data && onTreeRedirected != nullptr)
-        onTreeRedirected ();
+    if (tree == data)
+    {
+        ++generation;
+        if (onTreeRedirected != nullptr)
+            onTreeRedirected ();
+    }
 }
 
 } // namespace cello
@@ -19,15 +19,25 @@
 
 #pragma once
 
+#include <algorithm>
+#include <initializer_list>
+#include <tuple>
+#include <utility>
+
 #include <juce_core/juce_core.h>
 #include <juce_data_structures/juce_data_structures.h>
 
+#include "cello_column.h"
+#include "cello_id.h"
+#include "cello_lazy.h"
 #include "cello_update_source.h"
 
 namespace cello
 {
 class ValueBase;
 class Query;
+class Codec;
+class Patch;
 
 class Object : public UpdateSource,
                public juce::ValueTree::Listener
@@ -35,9 +45,14 @@ class Object : public UpdateSource,
 public:
     enum class FileFormat
     {
-        xml,    // load/store as XML text.
-        binary, // load/store in juce's binary format.
-        zipped  // GZIPped juce binary.
+        xml,       // load/store as XML text.
+        binary,    // load/store in juce's binary format.
+        zipped,    // GZIPped juce binary.
+        journaled, // binary snapshot plus a journal of changes (see cello::Journal)
+        lazy,      // chunked binary, loaded on demand (see cello::LazyTree)
+        compact,   // binary with interned identifiers (see cello::CompactFormat)
+        lz,        // juce binary compressed with cello::LzCodec
+        json       // JSON text (see cello::JsonFormat)
     };
 
     enum class CreationType
@@ -46,6 +61,18 @@ public:
         wrapped      // this object wrapped an existing tree.
     };
 
+    enum class AssignMode
+    {
+        replace,  // remove and re-add all properties and children.
+        reconcile // only change the properties and children that differ.
+    };
+
+    enum class SaveMode
+    {
+        standard, // replace the file with the new data.
+        safe      // add a checksum to the data and keep the previous file as a backup.
+    };
+
     /**
      * @brief Construct a new cello::Object object, which will attempt to
      * initialize from the 'state' parameter. If 'state' contains a ValueTree of the
@@ -100,6 +127,43 @@ public:
     Object (const juce::String& type, juce::File file,
             FileFormat format = FileFormat::xml);
 
+    /**
+     * @brief Construct a new Object whose type is a compile-time identifier
+     * (see `CELLO_ID`), following the same logic as the ctors that accept the type
+     * as a string. The type is used directly instead of being parsed as a path,
+     * so no Identifiers are created from strings.
+     *
+     * @param type
+     * @param state pointer to a cello::Object; pass nullptr to default initialize.
+     */
+    template <typename Tag>
+    Object (StaticId<Tag> type, const Object* state)
+    : Object { type, (state != nullptr ? static_cast<juce::ValueTree> (*state)
+                                       : juce::ValueTree ()) }
+    {
+        if (state != nullptr)
+            undoManager = state->getUndoManager ();
+    }
+
+    /**
+     * @param type
+     * @param state
+     */
+    template <typename Tag>
+    Object (StaticId<Tag> type, const Object& state)
+    : Object (type, &state)
+    {
+    }
+
+    /**
+     * @param type
+     * @param tree
+     */
+    template <typename Tag> Object (StaticId<Tag> type, juce::ValueTree tree)
+    {
+        wrapType (StaticId<Tag>::get (), tree);
+    }
+
     /**
      * @brief Construct a new Object object as a copy of an existing one.
      * We register as a listener, but this new copy does not have any callbacks
@@ -119,14 +183,66 @@ public:
     CreationType wrap (const Object& other);
 
     /**
-     * @brief set this object to use a different Object's value tree, which we will
-     * begin listening to. Our `valueTreeRedirected` callback should be executed.
+     * @brief Copy the properties and children of another Object of the same type
+     * into this one, using this object's assignment mode (see `setAssignMode()`).
      *
      * @param rhs
      * @return Object&
      */
     Object& operator= (const Object& rhs);
 
+    /**
+     * @brief Copy the properties and children of another Object of the same type
+     * into this one.
+     *
+     * With `AssignMode::replace`, all of our properties and children are replaced,
+     * so every one of them generates a notification and an undoable action. With
+     * `AssignMode::reconcile`, the two trees are compared (see `cello::Diff`) and
+     * only the properties and children that differ are changed; matching children
+     * are patched in place.
+     *
+     * @param rhs
+     * @param mode
+     */
+    void assign (const Object& rhs, AssignMode mode);
+
+    /**
+     * @brief Set how `operator=` copies data from another Object.
+     *
+     * @param mode
+     * @param key when reconciling, property used to match children between the two
+     *        trees; if invalid, children are matched by position.
+     */
+    void setAssignMode (AssignMode mode, const juce::Identifier& key = {});
+
+    /**
+     * @return the mode used by `operator=`.
+     */
+    AssignMode getAssignMode () const { return assignMode; }
+
+    /**
+     * @brief Set how `save()` and `saveAsync()` write files.
+     *
+     * Every save writes to a temporary file that's synced to storage before it
+     * replaces the target file. With `SaveMode::safe`, a CRC-32C checksum of the
+     * data is appended to the file, and the file being replaced is kept as its
+     * backup (see `getBackupFile()`). `load()` verifies the checksum of files
+     * that have one, and loads the backup if the file is missing or corrupt
+     * (including a file that has a backup but no checksum). A save in
+     * `SaveMode::standard` removes any backup left by an earlier safe save.
+     *
+     * The journaled and lazy formats manage their own files, and ignore this.
+     * Files saved in XML with `SaveMode::safe` can only be read by `load()`.
+     *
+     * @param mode
+     */
+    void setSaveMode (SaveMode mode);
+
+    /**
+     * @return the mode used by `save()` and `saveAsync()`.
+     */
+    SaveMode getSaveMode () const { return saveMode; }
+
     /**
      * @brief Destroy the Object object
      * The important thing done here is to remove ourselves as a listener to the
@@ -223,6 +339,16 @@ public:
      * @param deep  copy subtrees as well?
      */
     void upsertAll (const Object* parent, const juce::Identifier& key, bool deep = false);
+
+    /**
+     * @brief Apply a set of changes generated by comparing two trees with
+     * `cello::Diff` to this object. If we have an undo manager, all of the
+     * edits are performed as a single undoable transaction.
+     *
+     * @param patch
+     * @return false if the patch didn't match the structure of this tree.
+     */
+    bool apply (const Patch& patch);
     ///@}
 
     /**
@@ -300,7 +426,8 @@ public:
      * NOTE that it does not return an object; to work with this data in
      * its cello::Object form, you'll need to use this tree to create a new
      * one, probably testing its type to make sure you're creating the correct
-     * Object type from it.
+     * Object type from it. A lazily loaded child is materialized, so the tree
+     * returned always has its data.
      *
      * @param index
      * @return juce::ValueTree; will be invalid if the index is out of range.
@@ -369,6 +496,70 @@ public:
      */
     template <typename Comparator> void sort (Comparator& comp, bool stableSort);
 
+    /**
+     * @brief Copy properties of all of this object's children into columns, one
+     * contiguous array per property, in a single pass over the children:
+     *
+     * ```cpp
+     * cello::Column<float> gains { gainId, 1.f };
+     * cello::Column<int> notes { noteId };
+     * voices.exportColumns (gains, notes);
+     * // gains[i] and notes[i] now hold the properties of voices[i]
+     * ```
+     *
+     * @param columns each is cleared, then filled with one value per child.
+     */
+    template <typename... Ts> void exportColumns (Column<Ts>&... columns) const
+    {
+        const auto count { static_cast<size_t> (data.getNumChildren ()) };
+        (columns.reset (count), ...);
+        // lazily loaded children are read from a parsed copy, without loading
+        // them into our tree.
+        for (int i { 0 }; i < data.getNumChildren (); ++i)
+        {
+            const auto child { LazyTree::getContents (data, i) };
+            (columns.read (child), ...);
+        }
+    }
+
+    /**
+     * @brief Write columns (typically ones filled by `exportColumns()` and then
+     * modified) back into this object's children, in a single pass. Only the
+     * properties whose values differ from what `exportColumns()` would read now
+     * are set, and a lazily loaded child is only materialized if one of its
+     * values changes. This doesn't start a new undo transaction; call
+     * `beginNewTransaction()` on the UndoManager first if the changes should be
+     * undone separately from earlier ones.
+     *
+     * @param columns each must have one value per child.
+     * @return int the number of properties that were changed.
+     */
+    template <typename... Ts> int importColumns (const Column<Ts>&... columns)
+    {
+        const auto count { static_cast<size_t> (data.getNumChildren ()) };
+        jassert (((columns.size () == count) && ...));
+        const auto rows { std::min ({ count, columns.size ()... }) };
+
+        auto* undo { getUndoManager () };
+        int changed { 0 };
+        for (size_t row { 0 }; row < rows; ++row)
+        {
+            const auto index { static_cast<int> (row) };
+            // a lazily loaded child is only loaded into our tree if one of its
+            // values changes; writing to the placeholder would lose its data.
+            if (LazyTree::isPlaceholder (data, index))
+            {
+                const auto contents { LazyTree::getContents (data, index) };
+                if (!(columns.differs (contents, row) || ...))
+                    continue;
+                LazyTree::materialize (data, index);
+            }
+            auto child { data.getChild (index) };
+            ((changed += columns.write (child, row, undo) ? 1 : 0), ...);
+        }
+        return changed;
+    }
+
     ///@}
 
     /**
@@ -388,6 +579,15 @@ public:
      */
     juce::ValueTree::Listener* getExcludedListener () const { return excludedListener; }
 
+    /**
+     * @brief Get a counter that changes every time a property of this Object's
+     * tree changes, or this Object starts using a different tree. `Value`s use
+     * this to tell whether their cached values are still current.
+     *
+     * @return juce::uint64
+     */
+    juce::uint64 getGeneration () const { return generation; }
+
     /**
      * @name Callbacks
      */
@@ -478,6 +678,51 @@ public:
         return (*this);
     }
 
+    /**
+     * @brief Get several property values at once, as a tuple; a missing property
+     * is converted from a void var. To fill the members of a struct, assign the
+     * result to `std::tie (...)`:
+     *
+     * ```cpp
+     * std::tie (pt.x, pt.y) = obj.getattrs<float, float> (xId, yId);
+     * ```
+     *
+     * @tparam Ts the type of each value
+     * @param attrs an Identifier (or something convertible to one, like a
+     * `StaticId`) for each value
+     * @return std::tuple<Ts...>
+     */
+    template <typename... Ts, typename... Ids>
+    std::tuple<Ts...> getattrs (const Ids&... attrs) const
+    {
+        static_assert (sizeof...(Ts) == sizeof...(Ids),
+                       "getattrs needs one type for each attribute");
+        return std::tuple<Ts...> { getattrOrVoid<Ts> (attrs)... };
+    }
+
+    /**
+     * @brief Set several properties at once:
+     *
+     * ```cpp
+     * obj.setattrs ({ { xId, 1.f }, { yId, 2.f }, { nameId, "origin" } });
+     * ```
+     *
+     * Properties whose values don't change are skipped. This Object's own
+     * callbacks are called once per changed property that has a callback
+     * registered, plus a single call to the catch-all (type name) callback for
+     * all of the others, instead of once per property. Other listeners to the
+     * tree are notified of each change as usual, except for the one passed to
+     * `excludeListener()`.
+     *
+     * Like setting a Value, this doesn't start a new undo transaction; call
+     * `beginNewTransaction()` on the UndoManager first if the changes should be
+     * undone separately from earlier ones.
+     *
+     * @param attrs
+     * @return Object& so that calls may be chained.
+     */
+    Object& setattrs (std::initializer_list<std::pair<juce::Identifier, juce::var>> attrs);
+
     /**
      * @brief Remove the specified property from this object.
      * @param attr
@@ -493,23 +738,93 @@ public:
     ///@{
     /**
      * @brief Reload data from disk. Used in the ctor that accepts file name and
-     * format.
+     * format. If the file was saved with `SaveMode::safe`, its checksum is
+     * verified, and its backup is loaded instead if it's missing or corrupt.
      *
      * @param file
-     * @param format one of (xml, binary, zipped)
+     * @param format one of (xml, binary, zipped, journaled, lazy, compact, lz, json)
      * @return ValueTree, invalid if the attempt to load failed.
      */
     static juce::ValueTree load (juce::File file, FileFormat format = FileFormat::xml);
 
+    /**
+     * @brief Load data from a stream, parsing it as it's read: XML is converted
+     * directly into ValueTree nodes (see `cello::XmlTreeReader`) and zipped data
+     * is decompressed incrementally, so the entire file never needs to be held in
+     * memory.
+     *
+     * @param stream
+     * @param format one of (xml, binary, zipped, compact, lz, json); journaled and lazy
+     * data need to be loaded from a file.
+     * @return ValueTree, invalid if the attempt to load failed.
+     */
+    static juce::ValueTree load (juce::InputStream& stream, FileFormat format = FileFormat::xml);
+
+    /**
+     * @brief Load data that was saved using `save (file, codec, level)`.
+     *
+     * @param file
+     * @param codec the codec that the data was compressed with.
+     * @return ValueTree, invalid if the attempt to load failed.
+     */
+    static juce::ValueTree load (juce::File file, const Codec& codec);
+
+    /**
+     * @brief Get the file where the previous version of `file` is kept when
+     * saving with `SaveMode::safe`.
+     *
+     * @param file
+     * @return juce::File
+     */
+    static juce::File getBackupFile (juce::File file);
+
     /**
      * @brief Save the object tree to disk.
      *
      * @param file
-     * @param format one of (xml, binary, zipped)
+     * @param format one of (xml, binary, zipped, journaled, lazy, compact, lz, json)
      * @return Result of the save operation.
      */
     juce::Result save (juce::File file, FileFormat format = FileFormat::xml) const;
 
+    /**
+     * @brief Save the object tree to disk in juce's binary format, compressed
+     * with a specific codec and compression level.
+     *
+     * @param file
+     * @param codec e.g. `cello::LzCodec` for speed, or `cello::GzipCodec` for a
+     * smaller file.
+     * @param level 1 (fastest) through 9 (smallest), or `Codec::defaultLevel`.
+     * @return Result of the save operation.
+     */
+    juce::Result save (juce::File file, const Codec& codec, int level = -1) const;
+
+    using SaveCompleteFn = std::function<void (juce::Result result)>;
+
+    /**
+     * @brief Save the object tree to disk without blocking the calling thread.
+     * A snapshot of the tree is taken before returning, so changes made after
+     * this call are not included in the saved file. The snapshot is the tree in
+     * JUCE's binary format, written on the calling thread (this costs about as
+     * much as `FileFormat::binary` without the file I/O, and also parses any
+     * lazily loaded children that are still placeholders); converting it to
+     * `format`, compressing, and writing the file happen on a background
+     * thread. The file is written to a
+     * temporary file that replaces the target file when complete, so a failed
+     * save leaves the previous version of the file intact.
+     *
+     * If several saves to the same file are in flight at once, they may finish
+     * in any order; wait for one to complete before starting the next.
+     *
+     * @param file
+     * @param format one of (xml, binary, zipped, journaled, lazy, compact, lz, json)
+     * @param onComplete called **from the background thread** with the Result of
+     * the save operation. Use `juce::MessageManager::callAsync()` if you need to
+     * update your UI from it.
+     */
+    void saveAsync (juce::File file, FileFormat format = FileFormat::xml,
+                    SaveCompleteFn onComplete = nullptr) const;
+
     ///@}
 private:
     /**
@@ -523,6 +838,39 @@ private:
      */
     CreationType wrap (const juce::String& type, juce::ValueTree tree);
 
+    /**
+     * @brief As above, for a type that's a single Identifier instead of a path.
+     *
+     * @param type
+     * @param tree
+     * @return CreationType
+     */
+    CreationType wrapType (const juce::Identifier& type, juce::ValueTree tree);
+
+    /**
+     * @brief Make sure that any lazily loaded children have been loaded (see
+     * `cello::LazyTree`).
+     */
+    void materializeChildren ();
+
+    /**
+     * @brief Convert a property for `getattrs()`.
+     */
+    template <typename T> T getattrOrVoid (const juce::Identifier& attr) const
+    {
+        const auto* value { data.getPropertyPointer (attr) };
+        return juce::VariantConverter<T>::fromVar (value != nullptr ? *value : juce::var ());
+    }
+
+    /**
+     * @brief Call the callback registered for exactly this property, if there is
+     * one.
+     *
+     * @param property
+     * @return true if a callback was registered (even if it was cleared).
+     */
+    bool callPropertyUpdater (const juce::Identifier& property);
+
     /**
      * @brief Handle property changes in this tree by calling a registered
      * callback function for the property that changed (if one was registered).
@@ -592,6 +940,15 @@ protected:
     /// Remember how this Object was created.
     CreationType creationType { CreationType::wrapped };
 
+    /// how `operator=` copies data from another Object.
+    AssignMode assignMode { AssignMode::replace };
+
+    /// property used to match children when reconciling.
+    juce::Identifier assignKey;
+
+    /// how `save()` writes files.
+    SaveMode saveMode { SaveMode::standard };
+
     /// a listener to *not* update when properties change.
     juce::ValueTree::Listener* excludedListener { nullptr };
 
@@ -599,6 +956,12 @@ protected:
     /// change?
     bool doForceUpdates { false };
 
+    /// incremented when our tree's properties change; see `getGeneration()`.
+    juce::uint64 generation { 1 };
+
+    /// true while `setattrs()` is changing properties; it calls our callbacks itself.
+    bool settingAttrs { false };
+
 private:
     /**
      * @brief key/value mapping between a property ID and the callback
@@ -0,0 +1,173 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include <juce_core/juce_core.h>
+
+namespace cello
+{
+
+/**
+ * @brief True for the element types that cello can store as packed binary data:
+ * any arithmetic type except `bool`, since `std::vector<bool>` packs its
+ * elements into bits and has no contiguous array of them to copy.
+ */
+template <typename E>
+constexpr bool isPackableElement { std::is_arithmetic_v<E> && !std::is_same_v<E, bool> };
+
+/**
+ * @brief True for the `std::vector` types that cello stores as packed binary
+ * data: vectors of any arithmetic type except `bool`.
+ */
+template <typename T> struct IsPackedArray : std::false_type
+{
+};
+
+template <typename E>
+struct IsPackedArray<std::vector<E>> : std::bool_constant<isPackableElement<E>>
+{
+};
+
+/**
+ * @class ArrayView
+ * @brief A read-only view of an array of arithmetic values that's stored as
+ * binary data (a `juce::MemoryBlock`) in a `juce::var`, without copying it.
+ *
+ * The view points into the var's storage, so it's only valid until that var
+ * changes or is destroyed -- for a property in a ValueTree, until the next time
+ * that property is set.
+ *
+ * @tparam T element type
+ */
+template <typename T> class ArrayView
+{
+public:
+    static_assert (cello::isPackableElement<T>,
+                   "ArrayView elements must be arithmetic, and can't be bool");
+
+    ArrayView () = default;
+
+    ArrayView (const T* data, size_t size)
+    : elements { data }
+    , count { size }
+    {
+    }
+
+    /**
+     * @brief View the binary data in a var; an empty view if the var is missing
+     * or doesn't hold binary data.
+     *
+     * @param value
+     * @return ArrayView
+     */
+    static ArrayView fromVar (const juce::var* value)
+    {
+        if (value == nullptr)
+            return {};
+        if (const auto* block { value->getBinaryData () })
+            return { static_cast<const T*> (block->getData ()), block->getSize () / sizeof (T) };
+        return {};
+    }
+
+    const T* data () const noexcept { return elements; }
+    size_t size () const noexcept { return count; }
+    bool empty () const noexcept { return count == 0; }
+
+    const T* begin () const noexcept { return elements; }
+    const T* end () const noexcept { return elements + count; }
+
+    const T& operator[] (size_t index) const noexcept
+    {
+        jassert (index < count);
+        return elements[index];
+    }
+
+    /**
+     * @return true if this view holds exactly the same elements as `other`.
+     */
+    bool equals (const T* other, size_t otherSize) const noexcept
+    {
+        return count == otherSize &&
+               (count == 0 || std::memcmp (elements, other, count * sizeof (T)) == 0);
+    }
+
+    /**
+     * @return a copy of the elements.
+     */
+    std::vector<T> toVector () const { return { begin (), end () }; }
+
+private:
+    const T* elements { nullptr };
+    size_t count { 0 };
+};
+
+} // namespace cello
+
+namespace juce
+{
+/**
+ * @brief Vectors of arithmetic values are stored as a single block of binary data
+ * in the platform's native byte order (little-endian on every platform JUCE
+ * supports), so converting in either direction is one `memcpy` instead of
+ * creating a var for each element. This is supported by all of cello's file
+ * formats.
+ *
+ * For compatibility with trees that store the values as an array of vars (e.g.
+ * created by other code), those are converted element by element when read.
+ */
+template <typename E> struct VariantConverter<std::vector<E>>
+{
+    static_assert (!std::is_same_v<E, bool>,
+                   "std::vector<bool> stores its elements as bits and can't be packed; "
+                   "use std::vector<juce::uint8> instead");
+    static_assert (std::is_arithmetic_v<E>,
+                   "only vectors of arithmetic types have a built-in VariantConverter");
+
+    static std::vector<E> fromVar (const var& v)
+    {
+        if (v.isBinaryData ())
+            return cello::ArrayView<E>::fromVar (&v).toVector ();
+
+        std::vector<E> result;
+        if (const auto* array { v.getArray () })
+        {
+            result.reserve (static_cast<size_t> (array->size ()));
+            for (const auto& element : *array)
+            {
+                if constexpr (std::is_integral_v<E>)
+                    result.push_back (static_cast<E> (static_cast<int64> (element)));
+                else
+                    result.push_back (static_cast<E> (static_cast<double> (element)));
+            }
+        }
+        return result;
+    }
+
+    static var toVar (const std::vector<E>& values)
+    {
+        return var { static_cast<const void*> (values.data ()), values.size () * sizeof (E) };
+    }
+};
+
+} // namespace juce
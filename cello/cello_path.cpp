@@ -87,7 +87,11 @@ juce::ValueTree Path::findValueTree (juce::ValueTree& origin, Path::SearchType s
     // tree of the requested type.
     if (pathSegments.size () == 1 &&
         (pathSegments[0] == currentTree.getType ().toString ()))
+    {
+        if (searchType != SearchType::query)
+            LazyTree::materialize (currentTree);
         return currentTree;
+    }
 
     for (int i { 0 }; i < pathSegments.size () && currentTree.isValid (); ++i)
     {
@@ -112,7 +116,10 @@ juce::ValueTree Path::findValueTree (juce::ValueTree& origin, Path::SearchType s
         }
         else
         {
-            // next segment is a child of the current tree
+            // next segment is a child of the current tree. A query doesn't
+            // change the tree, so won't find children of a placeholder.
+            if (searchType != SearchType::query)
+                LazyTree::materialize (currentTree);
             auto childTree { currentTree.getChildWithName (segment) };
             if (searchType == SearchType::query)
             {
@@ -138,6 +145,8 @@ juce::ValueTree Path::findValueTree (juce::ValueTree& origin, Path::SearchType s
         searchResult =
             currentTree.isValid () ? SearchResult::found : SearchResult::notFound;
 
+    if (searchType != SearchType::query)
+        LazyTree::materialize (currentTree);
     return currentTree;
 }
 
@@ -38,17 +38,33 @@ Query& Query::addFilter (Predicate filter)
     return *this;
 }
 
+Query& Query::where (const Condition& newCondition)
+{
+    condition = condition.has_value () ? (*condition && newCondition) : newCondition;
+    return *this;
+}
+
 juce::ValueTree Query::search (juce::ValueTree tree, bool deep) const
 {
     // error for now; return an empty tree.
     juce::ValueTree result { type };
-    for (auto child : tree)
+    const auto selection { condition.has_value () ? condition->evaluate (tree) : Selection {} };
+    for (int i { 0 }; i < tree.getNumChildren (); ++i)
     {
+        // check the conditions first, so children they rule out are never
+        // parsed (if lazily loaded) or passed to the predicates.
+        if (condition.has_value () && !selection[static_cast<size_t> (i)])
+            continue;
+
+        // lazily loaded children are searched in a parsed copy, leaving the
+        // tree unchanged.
+        const auto child { LazyTree::getContents (tree, i) };
         if (filter (child))
         {
             auto childCopy { juce::ValueTree { child.getType () } };
             if (deep)
-                childCopy.copyPropertiesAndChildrenFrom (child, nullptr);
+                childCopy.copyPropertiesAndChildrenFrom (LazyTree::withoutPlaceholders (child),
+                                                         nullptr);
             else
                 childCopy.copyPropertiesFrom (child, nullptr);
             result.appendChild (childCopy, nullptr);
@@ -18,9 +18,13 @@
 */
 
 #pragma once
+#include <optional>
+
 #include <juce_core/juce_core.h>
 #include <juce_data_structures/juce_data_structures.h>
 
+#include "cello_filter.h"
+
 namespace cello
 {
 
@@ -74,6 +78,18 @@ public:
      */
     Query& addFilter (Predicate filter);
 
+    /**
+     * @brief Add a numeric Condition on the children's properties (logically
+     * ANDed with any earlier conditions). Conditions are evaluated before the
+     * filter predicates, over columns of the properties they use, with the
+     * vectorized kernels of `cello::ColumnFilter`, and the predicates are only
+     * run on the children they select.
+     *
+     * @param condition
+     * @return Query& reference to this so we can use the builder pattern.
+     */
+    Query& where (const Condition& condition);
+
     /**
      * @brief Execute the query we're programmed for -- iterate through the children
      * of `tree`, returning a new tree of type `resultType` that contains a copy
@@ -136,6 +152,8 @@ private:
     juce::Identifier type;
     /// @brief List of predicates to execute as a query.
     std::vector<Predicate> filters;
+    /// @brief Numeric conditions (all ANDed together), if any.
+    std::optional<Condition> condition;
     /// @brief List of comparisons to use when sorting.
     std::vector<Comparison> sorters;
 };
@@ -0,0 +1,182 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include <tuple>
+
+#include "cello_value.h"
+
+namespace cello
+{
+
+/**
+ * @class Field
+ * @brief Pairs a `cello::Value` member of an Object type with the member of a
+ * plain struct that holds a copy of it; see `Reflection`. Create these with
+ * `cello::field()` or the `CELLO_FIELD` macro.
+ *
+ * @tparam Obj the Object type declaring the Value
+ * @tparam Struct the struct type
+ * @tparam T the type of the Value and the struct member
+ * @tparam V the Value's validator policy
+ */
+template <typename Obj, typename Struct, typename T, typename V> struct Field
+{
+    Value<T, V> Obj::*value;
+    T Struct::*member;
+
+    template <typename O> void read (const O& object, Struct& data) const
+    {
+        data.*member = static_cast<T> (object.*value);
+    }
+
+    template <typename O> void write (O& object, const Struct& data) const
+    {
+        (object.*value).set (data.*member);
+    }
+
+    template <typename O>
+    bool writeIfChanged (O& object, const Struct& updated, const Struct& original) const
+    {
+        if (!(updated.*member != original.*member))
+            return false;
+        write (object, updated);
+        return true;
+    }
+};
+
+/**
+ * @brief Create a Field from a pointer to a Value member and a pointer to the
+ * struct member that mirrors it.
+ */
+template <typename Obj, typename Struct, typename T, typename V>
+constexpr Field<Obj, Struct, T, V> field (Value<T, V> Obj::*value, T Struct::*member)
+{
+    return { value, member };
+}
+
+/**
+ * @class Reflection
+ * @brief A list of Fields that describes how the Value members of an Object
+ * type map onto the members of a plain struct, so code that works on a
+ * snapshot of an Object (e.g. a processing loop) can copy all of the values
+ * out into plain memory in one call, operate on the struct, and write the
+ * results back:
+ *
+ * ```cpp
+ * struct VoiceData { float gain; float pan; int note; };
+ *
+ * const auto voiceFields { cello::reflect<VoiceData> (CELLO_FIELD (Voice, VoiceData, gain),
+ *                                                     CELLO_FIELD (Voice, VoiceData, pan),
+ *                                                     CELLO_FIELD (Voice, VoiceData, note)) };
+ *
+ * const auto before { voiceFields.toStruct (voice) };
+ * auto after { before };
+ * process (after);
+ * voiceFields.writeChanges (voice, after, before);
+ * ```
+ *
+ * Values are read and written through their `cello::Value` members, so
+ * validation, caching, and change callbacks all work as usual.
+ *
+ * @tparam Struct
+ * @tparam Fields
+ */
+template <typename Struct, typename... Fields> class Reflection
+{
+public:
+    constexpr Reflection (Fields... fieldList)
+    : fields { fieldList... }
+    {
+    }
+
+    /**
+     * @return a struct holding the current value of each field of `object`.
+     */
+    template <typename O> Struct toStruct (const O& object) const
+    {
+        Struct data {};
+        read (object, data);
+        return data;
+    }
+
+    /**
+     * @brief Copy the current value of each field of `object` into an existing
+     * struct.
+     */
+    template <typename O> void read (const O& object, Struct& data) const
+    {
+        std::apply ([&] (const auto&... field) { (field.read (object, data), ...); }, fields);
+    }
+
+    /**
+     * @brief Set every field of `object` from the struct. As with any assignment
+     * to a Value, fields whose values don't change don't generate callbacks.
+     */
+    template <typename O> void fromStruct (O& object, const Struct& data) const
+    {
+        std::apply ([&] (const auto&... field) { (field.write (object, data), ...); }, fields);
+    }
+
+    /**
+     * @brief Write back only the fields of `updated` that differ from `original`
+     * (typically the struct returned by `toStruct()` before `updated` was
+     * modified). The comparison is done on the structs, so unchanged fields
+     * aren't looked up in the tree at all.
+     *
+     * @return the number of fields written.
+     */
+    template <typename O>
+    int writeChanges (O& object, const Struct& updated, const Struct& original) const
+    {
+        int written { 0 };
+        std::apply (
+            [&] (const auto&... field)
+            { ((written += field.writeIfChanged (object, updated, original) ? 1 : 0), ...); },
+            fields);
+        return written;
+    }
+
+    /**
+     * @return the number of fields.
+     */
+    static constexpr size_t size () { return sizeof...(Fields); }
+
+private:
+    std::tuple<Fields...> fields;
+};
+
+/**
+ * @brief Create a Reflection for `Struct` from a list of Fields.
+ */
+template <typename Struct, typename... Fields>
+constexpr Reflection<Struct, Fields...> reflect (Fields... fieldList)
+{
+    return Reflection<Struct, Fields...> { fieldList... };
+}
+
+} // namespace cello
+
+/**
+ * @brief Create a cello::Field for a Value member and a struct member with the
+ * same name.
+ */
+#define CELLO_FIELD(objectType, structType, name) \
+    cello::field (&objectType::name, &structType::name)
@@ -0,0 +1,97 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include <algorithm>
+
+namespace cello
+{
+
+/**
+ * @brief Validator policies for `cello::Value<T, Validator>`. A policy is a type
+ * with two static function templates:
+ *
+ * - `T onSet (const T&)`, called with each value before it's stored
+ * - `T onGet (const T&)`, called with each value that's read from the tree
+ *
+ * Unlike the runtime `Value::onSet` and `Value::onGet` functions, a policy has no
+ * per-Value state and is resolved at compile time, so its calls inline into
+ * `Value::set()` and `Value::operator T()`. A Value applies its policy after
+ * any runtime validator, so the policy's guarantees always hold.
+ *
+ * Derive from `PassThrough` to only override one of the two.
+ */
+struct PassThrough
+{
+    template <typename T> static constexpr T onSet (const T& val) { return val; }
+
+    template <typename T> static constexpr T onGet (const T& val) { return val; }
+};
+
+/**
+ * @brief Limit a Value to the closed range `[Lo, Hi]` whenever it's set or read,
+ * e.g. `cello::Value<float, cello::Clamp<0, 1>>`. Reads are clamped as well so
+ * that values written into the tree by other means (or loaded from a file)
+ * still obey the limits.
+ *
+ * Template arguments must be integral constants (C++17 doesn't allow floating
+ * point template parameters); use `Range` for other limits.
+ *
+ * @tparam Lo lower limit
+ * @tparam Hi upper limit
+ */
+template <auto Lo, auto Hi> struct Clamp
+{
+    static_assert (Lo <= Hi, "Clamp limits are reversed");
+
+    template <typename T> static constexpr T onSet (const T& val)
+    {
+        return std::clamp (val, static_cast<T> (Lo), static_cast<T> (Hi));
+    }
+
+    template <typename T> static constexpr T onGet (const T& val) { return onSet (val); }
+};
+
+/**
+ * @brief Limit a Value to the closed range given by the static constexpr
+ * members `minimum` and `maximum` of `Limits`, which may be of any type that's
+ * convertible to the Value's type:
+ *
+ * ```cpp
+ * struct Gain { static constexpr float minimum { -96.f }, maximum { 6.f }; };
+ * cello::Value<float, cello::Range<Gain>> gain { *this, CELLO_ID ("gain"), 0.f };
+ * ```
+ *
+ * @tparam Limits
+ */
+template <typename Limits> struct Range
+{
+    static_assert (Limits::minimum <= Limits::maximum, "Range limits are reversed");
+
+    template <typename T> static constexpr T onSet (const T& val)
+    {
+        return std::clamp (val, static_cast<T> (Limits::minimum),
+                           static_cast<T> (Limits::maximum));
+    }
+
+    template <typename T> static constexpr T onGet (const T& val) { return onSet (val); }
+};
+
+} // namespace cello
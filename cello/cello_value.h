@@ -19,7 +19,14 @@
 
 #pragma once
 
+#include <optional>
+#include <utility>
+
+#include "cello_change_detection.h"
+#include "cello_id.h"
+#include "cello_packed_array.h"
 #include "cello_update_source.h"
+#include "cello_validator.h"
 
 namespace cello
 {
@@ -62,9 +69,19 @@ protected:
  * - be supported by the `juce::var` type, or define a
  *   `juce::VariantConverter` structure to round-trip through a `juce::var`
  *
+ * Each Value decides for itself whether a value it's set to is a change (see
+ * `setChangeDetection()`), comparing against the value it last wrote when
+ * nothing has changed the tree since, so redundant sets don't read the tree.
+ *
+ * Values may also be validated by a policy type given as the second template
+ * argument (see `cello_validator.h`), e.g. `Value<float, Clamp<0, 1>>`. Policies
+ * are inlined, so they cost nothing when unused and much less than the runtime
+ * `onSet`/`onGet` functions when they are.
+ *
  * @tparam T Data type handled by this Value.
+ * @tparam Validator policy applied to each value that's set or read.
  */
-template <typename T> class Value : public ValueBase
+template <typename T, typename Validator = PassThrough> class Value : public ValueBase
 {
 public:
     /**
@@ -83,7 +100,7 @@ public:
         // new Object, but may also happen if new values are added to an existing
         // type.
         if (!object.hasattr (id))
-            object.setattr<T> (id, initVal);
+            object.setattr<T> (id, Validator::onSet (initVal));
     }
 
     /**
@@ -103,30 +120,132 @@ public:
     /**
      * @brief Set property value in the tree. If the `onSet` validator function
      * has been configured, the `val` argument will be passed through that function
-     * (and possibly modified) before being stored into the tree.
+     * (and possibly modified), then through the `Validator` policy, before being
+     * stored into the tree.
      *
      * @param val
      */
     void set (const T& val)
     {
-        if (onSet != nullptr)
-            doSet (onSet (val));
+        if constexpr (IsPackedArray<T>::value)
+        {
+            // compare against the stored bytes instead of copying them into a T.
+            const auto validated { validateSet (val) };
+            store (validated, !view ().equals (validated.data (), validated.size ()));
+        }
         else
-            doSet (val);
+            doSet (validateSet (val), storedValue ());
     }
 
     /**
-     * @brief Get the current value of this property from the tree.
+     * @brief Read-modify-write this value with a single lookup of the property:
+     * `fn` is called with the current value (after `onGet` validation), and its
+     * result is set (after `onSet` validation), exactly as if it had been passed to
+     * `set()`. The compound assignment and increment/decrement operators all use
+     * this.
+     *
+     * @param fn a callable that accepts a `const T&` and returns the new `T`.
+     * @return T the value before the update, like `std::atomic<T>::fetch_add()`.
+     */
+    template <typename UpdateFn> T update (UpdateFn&& fn)
+    {
+        return exchange (std::forward<UpdateFn> (fn)).first;
+    }
+
+    /**
+     * @brief As `update()`, but returns the new value as it would now be read
+     * (i.e., after validation), like the pre-increment operators.
+     *
+     * @param fn a callable that accepts a `const T&` and returns the new `T`.
+     * @return T the value after the update.
+     */
+    template <typename UpdateFn> T updateAndGet (UpdateFn&& fn)
+    {
+        return exchange (std::forward<UpdateFn> (fn)).second;
+    }
+
+    /**
+     * @brief Get the current value of this property from the tree (or from our
+     * cache; see `setCached()`).
      *
      * @return T
      */
     operator T () const
     {
-        if (onGet != nullptr)
-            return onGet (doGet ());
-        return doGet ();
+        if (!cached)
+            return fetch ();
+
+        // the owning Object's generation changes whenever any property of its
+        // tree changes, which invalidates our copy.
+        const auto generation { object.getGeneration () };
+        if (!cachedValue.has_value () || cachedGeneration != generation)
+        {
+            cachedValue      = fetch ();
+            cachedGeneration = generation;
+        }
+        return *cachedValue;
+    }
+
+    /**
+     * @brief For a Value holding a `std::vector` of an arithmetic type (which is
+     * stored in the tree as a single block of binary data), get a view of the
+     * stored elements without copying them. The view is only valid until this
+     * property is next changed, and bypasses any validation and caching.
+     *
+     * @return ArrayView of the vector's element type.
+     */
+    auto view () const
+    {
+        static_assert (IsPackedArray<T>::value,
+                       "view() is only available for vectors of arithmetic types");
+        const juce::ValueTree tree { object };
+        return ArrayView<typename T::value_type>::fromVar (tree.getPropertyPointer (id));
     }
 
+    /**
+     * @brief Turn read-through caching of this value on or off. When on, the
+     * value that's read from the tree (after any `onGet` validation) is kept, and
+     * later reads return it directly until the owning Object sees a change to
+     * one of its properties, so a repeated read only costs a comparison.
+     *
+     * Changes made while the owning Object is excluded from listener callbacks
+     * (other than through this Value) aren't seen, and neither is a change to
+     * the `onGet` function; turn caching off and on again to discard the cached
+     * value.
+     *
+     * @param shouldCache
+     */
+    void setCached (bool shouldCache)
+    {
+        cached = shouldCache;
+        cachedValue.reset ();
+    }
+
+    /**
+     * @return true if reads of this value are cached.
+     */
+    bool isCached () const { return cached; }
+
+    /**
+     * @brief Choose how this Value decides whether a value that it's set to is a
+     * change that should be written to the tree (see `cello::ChangeDetection`).
+     * Floating point Values start out ignoring changes of 0.001 or less; all
+     * others start out detecting any change.
+     *
+     * ```cpp
+     * cutoff.setChangeDetection (cello::ChangeDetection::ulps (4));
+     * gain.setChangeDetection (cello::ChangeDetection::absolute (1e-6));
+     * ```
+     *
+     * @param detection
+     */
+    void setChangeDetection (ChangeDetection detection) { changeDetection = detection; }
+
+    /**
+     * @return how this Value detects changes.
+     */
+    ChangeDetection getChangeDetection () const { return changeDetection; }
+
     /**
      * @class Cached
      * @brief A utility class to maintain the last known value of a cello::Value
@@ -145,7 +264,7 @@ public:
     class Cached
     {
     public:
-        Cached (Value<T>& val)
+        Cached (Value& val)
         : value { val }
         , cachedValue { static_cast<T> (value) }
         {
@@ -160,7 +279,7 @@ public:
         operator T () const { return cachedValue; }
 
     private:
-        Value<T>& value;
+        Value& value;
         T cachedValue;
     };
 
@@ -170,6 +289,68 @@ public:
      */
     Cached getCached () { return Cached (*this); }
 
+    /**
+     * @class Realtime
+     * @brief A mirror of a Value that can be read wait-free from a realtime thread
+     * (e.g. an audio callback). Reading a Value directly goes through the ValueTree
+     * and a `VariantConverter`, neither of which is thread-safe or lock-free.
+     *
+     * A Realtime object listens to the tree that holds the Value, and each time the
+     * property changes (on the writer thread), stores the new value (after `onGet`
+     * validation) into a `std::atomic<T>`. Unlike `Cached`, this does not use the
+     * Value's property change callback, so you may still register one of those.
+     *
+     * Only usable with trivially copyable types that `std::atomic` can handle
+     * without a lock (e.g. `float`, `int`, `bool`).
+     *
+     * As with `Cached`, be careful that the lifetime of this object is not longer
+     * than that of the Object owning the Value it mirrors.
+     */
+    class Realtime : private juce::ValueTree::Listener
+    {
+    public:
+        static_assert (std::is_trivially_copyable_v<T>,
+                       "Realtime values must be trivially copyable");
+        static_assert (std::atomic<T>::is_always_lock_free,
+                       "Realtime values must be lock-free when atomic");
+
+        Realtime (Value& val)
+        : value { val }
+        , tree { val.object }
+        , mirror { static_cast<T> (val) }
+        {
+            tree.addListener (this);
+        }
+
+        ~Realtime () override { tree.removeListener (this); }
+
+        /**
+         * @return the most recent value; safe to call from any thread.
+         */
+        T load () const noexcept { return mirror.load (std::memory_order_acquire); }
+
+        operator T () const noexcept { return load (); }
+
+    private:
+        void valueTreePropertyChanged (juce::ValueTree& changedTree,
+                                       const juce::Identifier& property) override
+        {
+            if (changedTree == tree && property == value.getId ())
+                mirror.store (static_cast<T> (value), std::memory_order_release);
+        }
+
+        Value& value;
+        /// our own handle to the tree so we can listen to it.
+        juce::ValueTree tree;
+        std::atomic<T> mirror;
+    };
+
+    /**
+     * @return an initialized `Realtime` object that will always contain the current
+     * state of this `Value`.
+     */
+    Realtime getRealtime () { return Realtime (*this); }
+
     /**
      * @brief We define the signature of a 'validator' function that
      * can validate/modify/replace values as your application requires.
@@ -212,33 +393,112 @@ public:
     }
 
 private:
-    void doSet (const T& val)
+    T fetch () const { return validateGet (doGet ()); }
+
+    /**
+     * @brief The implementation of `update()` and `updateAndGet()`.
+     *
+     * @return the value before and after the update.
+     */
+    template <typename UpdateFn> std::pair<T, T> exchange (UpdateFn&& fn)
     {
-        juce::ValueTree tree { object };
+        const auto raw { storedValue () };
+        const auto before { validateGet (raw) };
+        const auto updated { validateSet (fn (before)) };
+        return { before, validateGet (doSet (updated, raw)) };
+    }
+
+    /**
+     * @brief Apply the runtime `onSet` function (if any), then the policy.
+     */
+    T validateSet (const T& val) const
+    {
+        if (onSet != nullptr)
+            return Validator::onSet (onSet (val));
+        return Validator::onSet (val);
+    }
 
-        // check if this call should change the current value.
-        if (notEqualTo (val))
+    /**
+     * @brief Apply the runtime `onGet` function (if any), then the policy.
+     */
+    T validateGet (const T& val) const
+    {
+        if (onGet != nullptr)
+            return Validator::onGet (onGet (val));
+        return Validator::onGet (val);
+    }
+
+    /**
+     * @brief Store a (validated) value.
+     *
+     * @param val
+     * @param current the value currently in the tree, which the caller has
+     * already fetched.
+     * @return the value that's in the tree afterwards.
+     */
+    const T& doSet (const T& val, const T& current)
+    {
+        const auto changed { changeDetection.isChange (val, current) };
+        store (changed ? val : current, changed);
+        return changed ? val : current;
+    }
+
+    /**
+     * @brief Store a (validated) value if it's changed, or send a forced update
+     * if it hasn't.
+     *
+     * @param val the new value if it's changed, or else the value already in the
+     * tree.
+     * @param changed true if `val` differs from the value in the tree.
+     * @return changed
+     */
+    bool store (const T& val, bool changed)
+    {
+        // in case the change doesn't reach our Object as a callback.
+        cachedValue.reset ();
+        juce::ValueTree tree { object };
+        // check if this value or our parent object have a listener to exclude
+        // from updates.
+        auto* excluded =
+            (excludedListener != nullptr) ? excludedListener : object.getExcludedListener ();
+        const auto generationBefore { object.getGeneration () };
+        bool notified { false };
+
+        if (changed)
         {
-            // check if this value or our parent object have a listener to exclude
-            // from updates.
-            auto* excluded = (excludedListener != nullptr)
-                                 ? excludedListener
-                                 : object.getExcludedListener ();
             const auto asVar { juce::VariantConverter<T>::toVar (val) };
             if (excluded)
                 tree.setPropertyExcludingListener (excluded, id, asVar,
                                                    object.getUndoManager ());
             else
                 tree.setProperty (id, asVar, object.getUndoManager ());
+            notified = (excluded != &object);
         }
         else
         {
             // check if we or our parent object want us to always send
             // a property change callback for this value.
-            const auto forceUpdate = shouldForceUpdate () || object.shouldForceUpdate ();
+            const auto forceUpdate = changeDetection.forcesUpdate () || shouldForceUpdate () ||
+                                     object.shouldForceUpdate ();
             if (forceUpdate)
+            {
                 tree.sendPropertyChangeMessage (id);
+                notified = true;
+            }
+        }
+
+        // remember what's now in the tree, unless a callback made some other
+        // change to it while we were storing (which the Object counted).
+        lastStored.reset ();
+        if constexpr (!IsPackedArray<T>::value)
+        {
+            if (object.getGeneration () == generationBefore + (notified ? 1u : 0u))
+            {
+                lastStored           = val;
+                lastStoredGeneration = object.getGeneration ();
+            }
         }
+        return changed;
     }
 
     T doGet () const
@@ -248,67 +508,74 @@ private:
     }
 
     /**
-     * @brief Compare some value to our current value; for floating point types, we
-     * check against an epsilon value (that is static for all cello::Value objects)
-     *
-     * @param newValue
-     * @return true if the two values are sufficiently unequal.
+     * @brief Get the value that's in the tree (before `onGet` validation) to
+     * compare against when setting: the value we last stored if the owning
+     * Object hasn't seen any change since, or else from the tree.
      */
-    bool notEqualTo (const T& newValue)
+    T storedValue () const
     {
-        if constexpr (std::is_floating_point_v<T>)
-            return std::fabs (newValue - doGet ()) > epsilon;
-        else
-            return (newValue != doGet ());
+        if (lastStored.has_value () && lastStoredGeneration == object.getGeneration ())
+            return *lastStored;
+        return doGet ();
     }
 
-public:
-    /// when setting, delta must be larger than this to cause a property
-    /// change callback.
-    static inline float epsilon { 0.001f };
-
-private:
     /// cello::Object containing the tree for this property.
     Object& object;
 
     /// pointer to a listener to exclude from property change callbacks.
     juce::ValueTree::Listener* excludedListener { nullptr };
+
+    /// are reads cached?
+    bool cached { false };
+
+    /// the last value read while caching, and the owning Object's generation at
+    /// that time.
+    mutable std::optional<T> cachedValue;
+    mutable juce::uint64 cachedGeneration { 0 };
+
+    /// how we decide whether a new value is a change.
+    ChangeDetection changeDetection { ChangeDetection::defaultFor<T> () };
+
+    /// the last value we wrote to the tree, and the owning Object's generation
+    /// just afterwards.
+    std::optional<T> lastStored;
+    juce::uint64 lastStoredGeneration { 0 };
 };
 
 template <typename T, // the actual type
+          typename V, // validator policy
           typename = typename std::enable_if<std::is_arithmetic<T>::value, T>::type>
-Value<T>& operator+= (Value<T>& val, const T& rhs)
+Value<T, V>& operator+= (Value<T, V>& val, const T& rhs)
 {
-    const auto current { static_cast<T> (val) };
-    val = current + rhs;
+    val.update ([&rhs] (const T& current) { return static_cast<T> (current + rhs); });
     return val;
 }
 
 template <typename T, // the actual type
+          typename V, // validator policy
           typename = typename std::enable_if<std::is_arithmetic<T>::value, T>::type>
-Value<T>& operator-= (Value<T>& val, const T& rhs)
+Value<T, V>& operator-= (Value<T, V>& val, const T& rhs)
 {
-    const auto current { static_cast<T> (val) };
-    val = current - rhs;
+    val.update ([&rhs] (const T& current) { return static_cast<T> (current - rhs); });
     return val;
 }
 
 template <typename T, // the actual type
+          typename V, // validator policy
           typename = typename std::enable_if<std::is_arithmetic<T>::value, T>::type>
-Value<T>& operator*= (Value<T>& val, const T& rhs)
+Value<T, V>& operator*= (Value<T, V>& val, const T& rhs)
 {
-    const auto current { static_cast<T> (val) };
-    val = current * rhs;
+    val.update ([&rhs] (const T& current) { return static_cast<T> (current * rhs); });
     return val;
 }
 
 template <typename T, // the actual type
+          typename V, // validator policy
           typename = typename std::enable_if<std::is_arithmetic<T>::value, T>::type>
-Value<T>& operator/= (Value<T>& val, const T& rhs)
+Value<T, V>& operator/= (Value<T, V>& val, const T& rhs)
 {
     jassert (rhs != 0);
-    const auto current { static_cast<T> (val) };
-    val = current / rhs;
+    val.update ([&rhs] (const T& current) { return static_cast<T> (current / rhs); });
     return val;
 }
 
@@ -321,12 +588,11 @@ Value<T>& operator/= (Value<T>& val, const T& rhs)
  * @return Value<T>&
  */
 template <typename T, // the actual type
+          typename V, // validator policy
           typename = typename std::enable_if<std::is_arithmetic<T>::value, T>::type>
-T operator++ (Value<T>& val)
+T operator++ (Value<T, V>& val)
 {
-    const auto newVal { static_cast<T> (val) + static_cast<int> (1) };
-    val.set (newVal);
-    return newVal;
+    return val.updateAndGet ([] (const T& current) { return static_cast<T> (current + 1); });
 }
 
 /**
@@ -342,12 +608,11 @@ T operator++ (Value<T>& val)
  * @return Value<T>&
  */
 template <typename T, // the actual type
+          typename V, // validator policy
           typename = typename std::enable_if<std::is_arithmetic<T>::value, T>::type>
-T operator++ (Value<T>& val, int)
+T operator++ (Value<T, V>& val, int)
 {
-    const auto original { static_cast<T> (val) };
-    val.set (original + static_cast<T> (1));
-    return original;
+    return val.update ([] (const T& current) { return static_cast<T> (current + 1); });
 }
 
 /**
@@ -359,12 +624,11 @@ T operator++ (Value<T>& val, int)
  * @return T
  */
 template <typename T, // the actual type
+          typename V, // validator policy
           typename = typename std::enable_if<std::is_arithmetic<T>::value, T>::type>
-T operator-- (Value<T>& val)
+T operator-- (Value<T, V>& val)
 {
-    const auto newVal { static_cast<T> (val) - static_cast<T> (1) };
-    val.set (newVal);
-    return newVal;
+    return val.updateAndGet ([] (const T& current) { return static_cast<T> (current - 1); });
 }
 
 /**
@@ -376,12 +640,11 @@ T operator-- (Value<T>& val)
  * @return T
  */
 template <typename T, // the actual type
+          typename V, // validator policy
           typename = typename std::enable_if<std::is_arithmetic<T>::value, T>::type>
-T operator-- (Value<T>& val, int)
+T operator-- (Value<T, V>& val, int)
 {
-    const auto original { static_cast<T> (val) };
-    val.set (original - static_cast<T> (1));
-    return original;
+    return val.update ([] (const T& current) { return static_cast<T> (current - 1); });
 }
 
 } // namespace cello
@@ -389,10 +652,12 @@ T operator-- (Value<T>& val, int)
 /**
  * @brief a useful macro to create and default initialize a cello::Value
  * as a member of a cello::Object, using the same name for the variable
- * as the identifier used for the property in its ValueTree.
+ * as the identifier used for the property in its ValueTree. The
+ * identifier is created once per member declaration (see `CELLO_ID`), not
+ * each time an Object is constructed.
  */
 #define MAKE_VALUE_MEMBER(type, name, init) \
     cello::Value<type> name                 \
     {                                       \
-        *this, #name, init                  \
+        *this, CELLO_ID (#name), init       \
     }
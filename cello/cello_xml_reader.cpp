@@ -0,0 +1,361 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "JuceHeader.h"
+
+#include "cello_xml_reader.h"
+
+namespace
+{
+constexpr int bufferSize { 32 * 1024 };
+
+bool isWhitespace (int c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+bool isNameChar (int c)
+{
+    return c >= 0 && !isWhitespace (c) && c != '=' && c != '>' && c != '/' && c != '<' &&
+           c != '"' && c != '\'';
+}
+
+void appendUtf8 (std::string& out, juce::uint32 c)
+{
+    if (c < 0x80)
+        out += static_cast<char> (c);
+    else if (c < 0x800)
+    {
+        out += static_cast<char> (0xc0 | (c >> 6));
+        out += static_cast<char> (0x80 | (c & 0x3f));
+    }
+    else if (c < 0x10000)
+    {
+        out += static_cast<char> (0xe0 | (c >> 12));
+        out += static_cast<char> (0x80 | ((c >> 6) & 0x3f));
+        out += static_cast<char> (0x80 | (c & 0x3f));
+    }
+    else
+    {
+        out += static_cast<char> (0xf0 | (c >> 18));
+        out += static_cast<char> (0x80 | ((c >> 12) & 0x3f));
+        out += static_cast<char> (0x80 | ((c >> 6) & 0x3f));
+        out += static_cast<char> (0x80 | (c & 0x3f));
+    }
+}
+
+juce::String toString (const std::string& text)
+{
+    return juce::String::fromUTF8 (text.data (), static_cast<int> (text.size ()));
+}
+} // namespace
+
+namespace cello
+{
+
+juce::ValueTree XmlTreeReader::read (juce::InputStream& stream)
+{
+    XmlTreeReader reader { stream };
+    return reader.readDocument ();
+}
+
+XmlTreeReader::XmlTreeReader (juce::InputStream& inputStream)
+: stream { inputStream }
+, buffer (bufferSize)
+{
+}
+
+juce::ValueTree XmlTreeReader::readDocument ()
+{
+    struct OpenElement
+    {
+        juce::ValueTree tree;
+        std::string name;
+    };
+    std::vector<OpenElement> open;
+    juce::ValueTree root;
+    std::string name;
+
+    for (;;)
+    {
+        // skip any text up to the next tag.
+        int c;
+        while ((c = next ()) != '<')
+        {
+            if (c < 0)
+                return {};
+        }
+
+        c = peek ();
+        if (c == '?')
+        {
+            // XML declaration or processing instruction
+            if (!skipPast ("?>"))
+                return {};
+        }
+        else if (c == '!')
+        {
+            next ();
+            if (peek () == '-')
+            {
+                if (!expect ("--") || !skipPast ("-->"))
+                    return {};
+            }
+            else if (peek () == '[')
+            {
+                if (!expect ("[CDATA[") || !skipPast ("]]>"))
+                    return {};
+            }
+            else if (!skipDeclaration ())
+                return {};
+        }
+        else if (c == '/')
+        {
+            next ();
+            if (!readName (name) || open.empty () || name != open.back ().name)
+                return {};
+            skipWhitespace ();
+            if (next () != '>')
+                return {};
+            open.pop_back ();
+            if (open.empty ())
+                return root;
+        }
+        else
+        {
+            if (!readName (name))
+                return {};
+            juce::ValueTree tree { juce::Identifier { toString (name) } };
+            bool isEmptyElement { false };
+            if (!readAttributes (tree, isEmptyElement))
+                return {};
+
+            if (open.empty ())
+                root = tree;
+            else
+                open.back ().tree.appendChild (tree, nullptr);
+
+            if (isEmptyElement)
+            {
+                if (open.empty ())
+                    return root;
+            }
+            else
+                open.push_back ({ tree, name });
+        }
+    }
+}
+
+bool XmlTreeReader::readAttributes (juce::ValueTree& tree, bool& isEmptyElement)
+{
+    std::string name;
+    std::string value;
+    for (;;)
+    {
+        skipWhitespace ();
+        const auto c { peek () };
+        if (c == '>')
+        {
+            next ();
+            return true;
+        }
+        if (c == '/')
+        {
+            next ();
+            isEmptyElement = true;
+            return next () == '>';
+        }
+        if (!readName (name))
+            return false;
+        skipWhitespace ();
+        if (next () != '=')
+            return false;
+        skipWhitespace ();
+        if (!readQuotedValue (value))
+            return false;
+
+        // match ValueTree::fromXml(), which stores binary data in attributes
+        // whose names are prefixed with "base64:"
+        const auto attributeName { toString (name) };
+        if (attributeName.startsWith ("base64:"))
+        {
+            juce::MemoryBlock mb;
+            if (mb.fromBase64Encoding (toString (value)))
+            {
+                tree.setProperty (attributeName.substring (7), juce::var { mb }, nullptr);
+                continue;
+            }
+        }
+        tree.setProperty (attributeName, toString (value), nullptr);
+    }
+}
+
+bool XmlTreeReader::readName (std::string& name)
+{
+    name.clear ();
+    while (isNameChar (peek ()))
+        name += static_cast<char> (next ());
+    return !name.empty ();
+}
+
+bool XmlTreeReader::readQuotedValue (std::string& value)
+{
+    value.clear ();
+    const auto quote { next () };
+    if (quote != '"' && quote != '\'')
+        return false;
+
+    for (;;)
+    {
+        const auto c { next () };
+        if (c < 0)
+            return false;
+        if (c == quote)
+            return true;
+        if (c == '&')
+            readEntity (value);
+        else
+            value += static_cast<char> (c);
+    }
+}
+
+void XmlTreeReader::readEntity (std::string& out)
+{
+    std::string entity;
+    for (;;)
+    {
+        const auto c { peek () };
+        if (c == ';')
+        {
+            next ();
+            break;
+        }
+        if (!juce::CharacterFunctions::isLetterOrDigit (static_cast<char> (c)) && c != '#')
+        {
+            // not an entity, so keep the text as it was.
+            out += '&';
+            out += entity;
+            return;
+        }
+        entity += static_cast<char> (next ());
+    }
+
+    if (entity == "lt")
+        out += '<';
+    else if (entity == "gt")
+        out += '>';
+    else if (entity == "amp")
+        out += '&';
+    else if (entity == "quot")
+        out += '"';
+    else if (entity == "apos")
+        out += '\'';
+    else if (entity.size () > 1 && entity[0] == '#')
+    {
+        const auto isHex { entity[1] == 'x' || entity[1] == 'X' };
+        const auto digits { juce::String (entity.substr (isHex ? 2 : 1)) };
+        appendUtf8 (out, static_cast<juce::uint32> (isHex ? digits.getHexValue32 ()
+                                                          : digits.getIntValue ()));
+    }
+    else
+    {
+        out += '&';
+        out += entity;
+        out += ';';
+    }
+}
+
+bool XmlTreeReader::skipPast (const char* terminator)
+{
+    const auto length { std::strlen (terminator) };
+    std::string recent;
+    while (recent != terminator)
+    {
+        const auto c { next () };
+        if (c < 0)
+            return false;
+        recent += static_cast<char> (c);
+        if (recent.size () > length)
+            recent.erase (0, 1);
+    }
+    return true;
+}
+
+bool XmlTreeReader::skipDeclaration ()
+{
+    // e.g. <!DOCTYPE ...>, which may contain a bracketed internal subset.
+    int depth { 0 };
+    for (;;)
+    {
+        const auto c { next () };
+        if (c < 0)
+            return false;
+        if (c == '[')
+            ++depth;
+        else if (c == ']')
+            --depth;
+        else if (c == '>' && depth <= 0)
+            return true;
+    }
+}
+
+bool XmlTreeReader::expect (const char* text)
+{
+    for (; *text != 0; ++text)
+    {
+        if (next () != static_cast<unsigned char> (*text))
+            return false;
+    }
+    return true;
+}
+
+void XmlTreeReader::skipWhitespace ()
+{
+    while (isWhitespace (peek ()))
+        next ();
+}
+
+int XmlTreeReader::peek ()
+{
+    if (position == end)
+    {
+        end      = stream.read (buffer.data (), bufferSize);
+        position = 0;
+        if (end <= 0)
+        {
+            end = 0;
+            return -1;
+        }
+    }
+    return static_cast<unsigned char> (buffer[static_cast<size_t> (position)]);
+}
+
+int XmlTreeReader::next ()
+{
+    const auto c { peek () };
+    if (c >= 0)
+        ++position;
+    return c;
+}
+
+} // namespace cello
+
+#if RUN_UNIT_TESTS
+#include "test/test_cello_xml_reader.inl"
+#endif
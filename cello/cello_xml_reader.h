@@ -0,0 +1,79 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <juce_data_structures/juce_data_structures.h>
+
+namespace cello
+{
+/**
+ * @class XmlTreeReader
+ * @brief Builds a ValueTree directly from XML text as it's read from a stream,
+ * without first loading the text into memory or creating an `XmlElement`
+ * document from it.
+ *
+ * The result is the same as `juce::ValueTree::fromXml()`: each element becomes a
+ * tree whose type is the element's tag name, attributes become String properties
+ * (or MemoryBlocks, for attributes written with the `base64:` prefix that
+ * `ValueTree::toXmlString()` uses for binary data), and text content is ignored.
+ */
+class XmlTreeReader
+{
+public:
+    /**
+     * @brief Read the first element found in `stream` and everything inside it.
+     *
+     * @param stream
+     * @return ValueTree, invalid if the stream didn't contain well-formed XML.
+     */
+    static juce::ValueTree read (juce::InputStream& stream);
+
+private:
+    explicit XmlTreeReader (juce::InputStream& stream);
+
+    juce::ValueTree readDocument ();
+
+    /**
+     * @brief Read the attributes of a start tag into `tree`, up to and including
+     * the closing `>` or `/>`.
+     *
+     * @return false on malformed input.
+     */
+    bool readAttributes (juce::ValueTree& tree, bool& isEmptyElement);
+
+    bool readName (std::string& name);
+    bool readQuotedValue (std::string& value);
+    void readEntity (std::string& out);
+    bool skipPast (const char* terminator);
+    bool skipDeclaration ();
+    bool expect (const char* text);
+    void skipWhitespace ();
+
+    int peek ();
+    int next ();
+
+    juce::InputStream& stream;
+    std::vector<char> buffer;
+    int position { 0 };
+    int end { 0 };
+};
+
+} // namespace cello
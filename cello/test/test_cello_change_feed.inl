@@ -0,0 +1,237 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <juce_core/juce_core.h>
+#include <thread>
+
+#include "../cello_object.h"
+
+namespace
+{
+class Voice : public cello::Object
+{
+public:
+    Voice ()
+    : cello::Object ("voice", nullptr)
+    {
+    }
+
+    MAKE_VALUE_MEMBER (float, gain, 1.f);
+    MAKE_VALUE_MEMBER (int, note, 60);
+    MAKE_VALUE_MEMBER (juce::String, name, {});
+};
+} // namespace
+
+class Test_cello_change_feed : public TestSuite
+{
+public:
+    Test_cello_change_feed ()
+    : TestSuite ("cello_change_feed", "cello")
+    {
+    }
+
+    void runTest () override
+    {
+        using Record = cello::ChangeFeed::Record;
+        using Scalar = cello::ChangeFeed::Scalar;
+
+        test ("property changes",
+              [this] ()
+              {
+                  Voice voice;
+                  cello::ChangeFeed feed { voice, 16 };
+                  expectEquals (feed.getNumReady (), 0);
+
+                  voice.gain = 0.5f;
+                  voice.note = 64;
+                  voice.name = "lead";
+                  voice.delattr ("note");
+                  expectEquals (feed.getNumReady (), 4);
+
+                  Record r;
+                  expect (feed.pop (r));
+                  expect (r.type == Record::Type::propertyChanged);
+                  expect (r.node == cello::ChangeFeed::rootNode);
+                  expect (r.property == feed.getPropertyIndex ("gain"));
+                  expect (feed.getPropertyName (r.property) == juce::Identifier ("gain"));
+                  expect (r.value.type == Scalar::Type::floating);
+                  expectWithinAbsoluteError (r.value.get<float> (), 0.5f, 0.001f);
+
+                  expect (feed.pop (r));
+                  expect (r.value.type == Scalar::Type::integer);
+                  expectEquals (r.value.get<int> (), 64);
+
+                  expect (feed.pop (r));
+                  expect (feed.getPropertyName (r.property) == juce::Identifier ("name"));
+                  expect (r.value.type == Scalar::Type::other);
+
+                  expect (feed.pop (r));
+                  expect (r.type == Record::Type::propertyRemoved);
+                  expect (r.value.type == Scalar::Type::none);
+
+                  expect (!feed.pop (r));
+              });
+
+        test ("child changes",
+              [this] ()
+              {
+                  cello::Object voices { "voices", nullptr };
+                  cello::ChangeFeed feed { voices };
+
+                  Voice v1;
+                  Voice v2;
+                  voices.append (&v1);
+                  voices.append (&v2);
+                  voices.move (0, 1);
+                  // changes to descendants are also captured.
+                  v1.gain = 0.25f;
+                  voices.remove (&v2);
+
+                  std::vector<Record> received;
+                  expectEquals (feed.drain ([&] (const Record& r)
+                                            { received.push_back (r); }),
+                                5);
+
+                  const auto v1Handle { feed.getHandle (v1) };
+                  const auto v2Handle { received[1].child };
+                  expect (feed.getTree (v1Handle) == v1);
+                  expect (v1Handle != v2Handle);
+                  // v2 was removed, so its handle was released.
+                  expect (feed.getHandle (v2) == cello::ChangeFeed::invalidNode);
+                  expect (!feed.getTree (v2Handle).isValid ());
+
+                  expect (received[0].type == Record::Type::childAdded);
+                  expect (received[0].child == v1Handle);
+                  expectEquals (received[0].newIndex, 0);
+                  expect (received[1].child == v2Handle);
+                  expectEquals (received[1].newIndex, 1);
+
+                  expect (received[2].type == Record::Type::childMoved);
+                  expect (received[2].child == v1Handle);
+                  expectEquals (received[2].oldIndex, 0);
+                  expectEquals (received[2].newIndex, 1);
+
+                  expect (received[3].type == Record::Type::propertyChanged);
+                  expect (received[3].node == v1Handle);
+
+                  expect (received[4].type == Record::Type::childRemoved);
+                  expect (received[4].child == v2Handle);
+                  expectEquals (received[4].oldIndex, 0);
+              });
+
+        test ("handles",
+              [this] ()
+              {
+                  cello::Object voices { "voices", nullptr };
+                  Voice existing;
+                  voices.append (&existing);
+                  cello::ChangeFeed feed { voices };
+
+                  // trees that were already there have handles.
+                  const auto existingHandle { feed.getHandle (existing) };
+                  expect (existingHandle != cello::ChangeFeed::invalidNode);
+                  expect (existingHandle != cello::ChangeFeed::rootNode);
+                  expect (feed.getTree (cello::ChangeFeed::rootNode) == voices);
+                  // ...trees outside of the watched one don't.
+                  Voice outside;
+                  expect (feed.getHandle (outside) == cello::ChangeFeed::invalidNode);
+
+                  // adding and removing trees doesn't keep using up handles.
+                  for (int i { 0 }; i < 100; ++i)
+                  {
+                      Voice voice;
+                      voices.append (&voice);
+                      voices.remove (&voice);
+                  }
+                  Voice last;
+                  voices.append (&last);
+                  expect (feed.getHandle (last) <= 2);
+
+                  // changes deeper in the tree, including to moved children.
+                  cello::Object group { "group", nullptr };
+                  Voice nested;
+                  group.append (&nested);
+                  voices.append (&group);
+                  voices.move (2, 0);
+                  nested.note = 72;
+
+                  Record r;
+                  while (feed.pop (r))
+                  {
+                      if (r.type == Record::Type::propertyChanged)
+                          break;
+                  }
+                  expect (r.type == Record::Type::propertyChanged);
+                  expect (r.node == feed.getHandle (nested));
+                  expect (feed.getTree (r.node) == nested);
+                  expectEquals (r.value.get<int> (), 72);
+              });
+
+        test ("overflow",
+              [this] ()
+              {
+                  Voice voice;
+                  cello::ChangeFeed feed { voice, 4 };
+                  for (int i { 0 }; i < 10; ++i)
+                      voice.note = i;
+
+                  expectEquals (feed.getNumReady (), 4);
+                  expect (feed.checkAndClearOverflow ());
+                  expect (!feed.checkAndClearOverflow ());
+                  // we keep the oldest records, not the newest.
+                  Record r;
+                  expect (feed.pop (r));
+                  expectEquals (r.value.get<int> (), 0);
+              });
+
+        test ("consume on another thread",
+              [this] ()
+              {
+                  Voice voice;
+                  voice.note = 0;
+                  constexpr int changeCount { 1000 };
+                  cello::ChangeFeed feed { voice, changeCount };
+
+                  std::atomic<int> consumed { 0 };
+                  std::atomic<int> lastNote { -1 };
+                  std::thread consumer (
+                      [&] ()
+                      {
+                          const auto timeout { juce::Time::getMillisecondCounter () +
+                                               5000 };
+                          while (consumed < changeCount &&
+                                 juce::Time::getMillisecondCounter () < timeout)
+                          {
+                              consumed += feed.drain ([&] (const Record& r)
+                                                      { lastNote = r.value.get<int> (); });
+                          }
+                      });
+
+                  for (int i { 1 }; i <= changeCount; ++i)
+                      voice.note = i;
+
+                  consumer.join ();
+                  expectEquals (consumed.load (), changeCount);
+                  expectEquals (lastNote.load (), changeCount);
+                  expect (!feed.checkAndClearOverflow ());
+              });
+    }
+};
+
+static Test_cello_change_feed testcello_change_feed;
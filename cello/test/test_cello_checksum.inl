@@ -0,0 +1,115 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <juce_core/juce_core.h>
+
+#include "../cello_checksum.h"
+
+class Test_cello_checksum : public TestSuite
+{
+public:
+    Test_cello_checksum ()
+    : TestSuite ("cello_checksum", "cello")
+    {
+    }
+
+    void runTest () override
+    {
+        test ("crc32c",
+              [this] ()
+              {
+                  // standard check value for CRC-32C
+                  expectEquals (cello::Crc32c::calculate ("123456789", 9), 0xe3069283u);
+                  expectEquals (cello::Crc32c::calculate (nullptr, 0), 0u);
+
+                  juce::MemoryBlock data { 10000 };
+                  juce::Random ().fillBitsRandomly (data.getData (), data.getSize ());
+                  const auto crc { cello::Crc32c::calculate (data.getData (), data.getSize ()) };
+                  // calculating in pieces gives the same result.
+                  for (size_t split : { 1, 7, 8, 4097 })
+                  {
+                      const auto first { cello::Crc32c::calculate (data.getData (), split) };
+                      expectEquals (cello::Crc32c::calculate (data.begin () + split,
+                                                              data.getSize () - split, first),
+                                    crc);
+                  }
+                  logMessage (cello::Crc32c::isHardwareAccelerated () ? "hardware CRC"
+                                                                      : "software CRC");
+              });
+
+        test ("verify",
+              [this] ()
+              {
+                  juce::MemoryBlock payload { 1000 };
+                  juce::Random ().fillBitsRandomly (payload.getData (), payload.getSize ());
+
+                  juce::MemoryOutputStream out;
+                  {
+                      cello::ChecksumOutputStream checked { out };
+                      expect (checked.write (payload.getData (), payload.getSize ()));
+                      expect (checked.writeFooter ());
+                  }
+                  auto block { out.getMemoryBlock () };
+                  expectEquals (block.getSize (),
+                                payload.getSize () + cello::ChecksumOutputStream::footerSize);
+                  expectEquals (cello::ChecksumOutputStream::verify (block.getData (),
+                                                                     block.getSize (), true),
+                                static_cast<juce::int64> (payload.getSize ()));
+
+                  // data without a footer is only accepted as-is if we don't expect one.
+                  expectEquals (cello::ChecksumOutputStream::verify (payload.getData (),
+                                                                     payload.getSize (), false),
+                                static_cast<juce::int64> (payload.getSize ()));
+                  expectEquals (cello::ChecksumOutputStream::verify (payload.getData (),
+                                                                     payload.getSize (), true),
+                                static_cast<juce::int64> (-1));
+
+                  // any change to the data is caught...
+                  block[500] ^= 1;
+                  expectEquals (cello::ChecksumOutputStream::verify (block.getData (),
+                                                                     block.getSize (), false),
+                                static_cast<juce::int64> (-1));
+                  block[500] ^= 1;
+                  // ...as is truncation.
+                  expectEquals (cello::ChecksumOutputStream::verify (
+                                    block.begin () + 1, block.getSize () - 1, false),
+                                static_cast<juce::int64> (-1));
+                  expectEquals (cello::ChecksumOutputStream::verify (
+                                    block.getData (), block.getSize () - 1, true),
+                                static_cast<juce::int64> (-1));
+              });
+
+#if CELLO_RUN_BENCHMARKS
+        test ("benchmark: crc32c",
+              [this] ()
+              {
+                  juce::MemoryBlock data { 64 * 1024 * 1024 };
+                  juce::Random ().fillBitsRandomly (data.getData (), data.getSize ());
+                  const auto start { juce::Time::getMillisecondCounterHiRes () };
+                  const auto crc { cello::Crc32c::calculate (data.getData (), data.getSize ()) };
+                  const auto elapsed { juce::Time::getMillisecondCounterHiRes () - start };
+                  expect (crc != 0);
+                  logMessage ("64 MB: " + juce::String (elapsed, 1) + " ms (" +
+                              juce::String (64 * 1000.0 / elapsed, 0) + " MB/s)");
+              });
+#endif
+    }
+};
+
+static Test_cello_checksum testcello_checksum;
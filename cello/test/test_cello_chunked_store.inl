@@ -0,0 +1,247 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <juce_core/juce_core.h>
+#include <juce_data_structures/juce_data_structures.h>
+
+#include "../cello_chunked_store.h"
+#include "../cello_object.h"
+
+namespace
+{
+class ChunkedTrack : public cello::Object
+{
+public:
+    ChunkedTrack (juce::ValueTree tree)
+    : cello::Object ("track", tree)
+    {
+    }
+
+    MAKE_VALUE_MEMBER (juce::String, name, {});
+    MAKE_VALUE_MEMBER (float, gain, 1.f);
+};
+
+juce::ValueTree makeProject (int numTracks)
+{
+    juce::ValueTree project { "project" };
+    project.setProperty ("title", "chunked", nullptr);
+    for (int i { 0 }; i < numTracks; ++i)
+    {
+        juce::ValueTree track { "track" };
+        track.setProperty ("name", "track " + juce::String (i), nullptr);
+        for (int j { 0 }; j < 5; ++j)
+            track.appendChild (juce::ValueTree { "clip" }.setProperty ("start", j, nullptr),
+                               nullptr);
+        project.appendChild (track, nullptr);
+    }
+    return project;
+}
+
+juce::StringArray getChunkFiles (const juce::File& directory)
+{
+    juce::StringArray names;
+    for (const auto& file : directory.findChildFiles (juce::File::findFiles, false, "*.chunk"))
+        names.add (file.getFileName ());
+    names.sort (false);
+    return names;
+}
+
+int countChanges (const juce::StringArray& before, const juce::StringArray& after)
+{
+    int count { 0 };
+    for (const auto& name : after)
+        count += before.contains (name) ? 0 : 1;
+    return count;
+}
+} // namespace
+
+class Test_cello_chunked_store : public TestSuite
+{
+public:
+    Test_cello_chunked_store ()
+    : TestSuite ("cello_chunked_store", "cello")
+    {
+    }
+
+    void runTest () override
+    {
+        setup (
+            [this] ()
+            {
+                directory = juce::File::getSpecialLocation (juce::File::tempDirectory)
+                                .getNonexistentChildFile ("cello_chunks", "", false);
+            });
+
+        tearDown ([this] () { directory.deleteRecursively (); });
+
+        test ("save changed chunks",
+              [this] ()
+              {
+                  cello::Object project { "project", makeProject (50) };
+                  cello::ChunkedStore store { project, directory };
+                  expect (store.isDirty ());
+                  expect (store.save ());
+                  expect (!store.isDirty ());
+                  auto files { getChunkFiles (directory) };
+                  expectEquals (files.size (), 50);
+                  expect (cello::ChunkedStore::load (directory).isEquivalentTo (project));
+
+                  // change a single track
+                  ChunkedTrack track { project[7] };
+                  track.gain = 0.5f;
+                  cello::Object clip { "clip", juce::ValueTree { track }.getChild (2) };
+                  clip.setattr ("start", 100);
+                  expectEquals (store.getNumDirtyChunks (), 1);
+                  expect (store.save ());
+                  auto updated { getChunkFiles (directory) };
+                  expectEquals (updated.size (), 50);
+                  expectEquals (countChanges (files, updated), 1);
+                  expect (cello::ChunkedStore::load (directory).isEquivalentTo (project));
+
+                  // properties of the root are in the manifest.
+                  project.setattr ("title", juce::String ("renamed"));
+                  expectEquals (store.getNumDirtyChunks (), 0);
+                  expect (store.isDirty ());
+                  expect (store.save ());
+                  expectEquals (countChanges (updated, getChunkFiles (directory)), 0);
+                  expect (cello::ChunkedStore::load (directory).isEquivalentTo (project));
+              });
+
+        test ("add, remove, and move chunks",
+              [this] ()
+              {
+                  cello::Object project { "project", makeProject (10) };
+                  cello::ChunkedStore store { project, directory };
+                  expect (store.save ());
+                  const auto files { getChunkFiles (directory) };
+
+                  project.remove (3);
+                  project.move (0, 5);
+                  cello::Object added { "track", nullptr };
+                  added.setattr ("name", juce::String ("new track"));
+                  project.insert (&added, 2);
+                  expectEquals (store.getNumDirtyChunks (), 1);
+                  expect (store.save ());
+
+                  const auto updated { getChunkFiles (directory) };
+                  expectEquals (updated.size (), 10);
+                  expectEquals (countChanges (files, updated), 1);
+                  expect (cello::ChunkedStore::load (directory).isEquivalentTo (project));
+              });
+
+        test ("reopen",
+              [this] ()
+              {
+                  {
+                      cello::Object project { "project", makeProject (10) };
+                      cello::ChunkedStore store { project, directory, 1,
+                                                  cello::Object::FileFormat::xml };
+                      expect (store.save ());
+                  }
+                  const auto files { getChunkFiles (directory) };
+
+                  // a store created for an Object loaded from the directory starts clean.
+                  cello::Object project { "project", cello::ChunkedStore::load (directory) };
+                  expect (project.getCreationType () == cello::Object::CreationType::wrapped);
+                  cello::ChunkedStore store { project, directory, 1,
+                                              cello::Object::FileFormat::xml };
+                  expect (!store.isDirty ());
+                  ChunkedTrack { project[4] }.name = "changed";
+                  expect (store.save ());
+                  expectEquals (countChanges (files, getChunkFiles (directory)), 1);
+
+                  // ...but one for a different Object rewrites everything.
+                  cello::Object other { "project", makeProject (5) };
+                  cello::ChunkedStore otherStore { other, directory, 1,
+                                                   cello::Object::FileFormat::xml };
+                  expectEquals (otherStore.getNumDirtyChunks (), 5);
+                  expect (otherStore.save ());
+                  expectEquals (getChunkFiles (directory).size (), 5);
+                  expect (cello::ChunkedStore::load (directory).isEquivalentTo (other));
+              });
+
+        test ("reopen with different contents",
+              [this] ()
+              {
+                  {
+                      cello::Object project { "project", makeProject (10) };
+                      cello::ChunkedStore store { project, directory };
+                      expect (store.save ());
+                  }
+                  const auto files { getChunkFiles (directory) };
+
+                  // the same structure with different contents only keeps the
+                  // chunk files that match.
+                  auto edited { makeProject (10) };
+                  edited.getChild (6).setProperty ("name", "edited", nullptr);
+                  edited.getChild (8).getChild (1).setProperty ("start", -1, nullptr);
+                  cello::Object project { "project", edited };
+                  cello::ChunkedStore store { project, directory };
+                  expectEquals (store.getNumDirtyChunks (), 2);
+                  expect (store.save ());
+                  expectEquals (getChunkFiles (directory).size (), 10);
+                  expectEquals (countChanges (files, getChunkFiles (directory)), 2);
+                  expect (cello::ChunkedStore::load (directory).isEquivalentTo (edited));
+              });
+
+        test ("chunk depth",
+              [this] ()
+              {
+                  cello::Object project { "project", makeProject (4) };
+                  cello::ChunkedStore store { project, directory, 2 };
+                  expectEquals (store.getNumDirtyChunks (), 20);
+                  expect (store.save ());
+                  expect (cello::ChunkedStore::load (directory).isEquivalentTo (project));
+
+                  // a change to a track's properties is in the manifest...
+                  ChunkedTrack track { project[1] };
+                  track.name = "renamed";
+                  expectEquals (store.getNumDirtyChunks (), 0);
+                  // ...and a change to a clip only affects its own chunk.
+                  juce::ValueTree { track }.getChild (3).setProperty ("start", -1, nullptr);
+                  expectEquals (store.getNumDirtyChunks (), 1);
+
+                  juce::ValueTree newTrack { "track" };
+                  newTrack.appendChild (juce::ValueTree { "clip" }, nullptr);
+                  newTrack.appendChild (juce::ValueTree { "clip" }, nullptr);
+                  juce::ValueTree { project }.appendChild (newTrack, nullptr);
+                  expectEquals (store.getNumDirtyChunks (), 3);
+                  expect (store.save ());
+                  expectEquals (getChunkFiles (directory).size (), 22);
+                  expect (cello::ChunkedStore::load (directory).isEquivalentTo (project));
+              });
+
+        test ("invalid store",
+              [this] ()
+              {
+                  expect (!cello::ChunkedStore::load (directory).isValid ());
+                  cello::Object project { "project", makeProject (3) };
+                  cello::ChunkedStore store { project, directory };
+                  expect (store.save ());
+                  // a missing chunk makes the store unreadable.
+                  directory.getChildFile (getChunkFiles (directory)[0]).deleteFile ();
+                  expect (!cello::ChunkedStore::load (directory).isValid ());
+              });
+    }
+
+private:
+    juce::File directory;
+};
+
+static Test_cello_chunked_store testcello_chunked_store;
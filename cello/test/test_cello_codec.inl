@@ -0,0 +1,329 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <juce_core/juce_core.h>
+#include <juce_data_structures/juce_data_structures.h>
+
+#include "../cello_codec.h"
+#include "../cello_object.h"
+
+namespace
+{
+juce::MemoryBlock makeText (size_t size)
+{
+    juce::MemoryOutputStream out;
+    juce::Random random { 1234 };
+    const char* words[] { "cello ", "value ", "tree ", "object ", "juce ", "<child " };
+    while (out.getDataSize () < size)
+        out << words[random.nextInt (6)];
+    auto block { out.getMemoryBlock () };
+    block.setSize (size);
+    return block;
+}
+
+juce::MemoryBlock makeNoise (size_t size)
+{
+    juce::MemoryBlock block { size };
+    juce::Random random { 5678 };
+    random.fillBitsRandomly (block.getData (), block.getSize ());
+    return block;
+}
+
+/**
+ * @brief Check that the LZ4 block following our header follows the end of block
+ * rules: the last 5 bytes are literals, and the last match starts at least 12
+ * bytes before the end.
+ */
+bool followsEndOfBlockRules (const juce::MemoryOutputStream& compressed, size_t size)
+{
+    const auto* in { static_cast<const juce::uint8*> (compressed.getData ()) };
+    const auto end { compressed.getDataSize () };
+    size_t ip { 12 }; // past the magic number and size.
+    size_t op { 0 };
+    const auto readLength = [&] (size_t& length)
+    {
+        for (juce::uint8 byte { 255 }; byte == 255 && ip < end;)
+        {
+            byte = in[ip++];
+            length += byte;
+        }
+    };
+    while (ip < end)
+    {
+        const auto token { in[ip++] };
+        size_t numLiterals { static_cast<size_t> (token >> 4) };
+        if (numLiterals == 15)
+            readLength (numLiterals);
+        ip += numLiterals;
+        op += numLiterals;
+        if (ip >= end)
+            return op == size && (size < 5 || numLiterals >= 5);
+
+        if (op + 12 > size)
+            return false;
+        ip += 2;
+        size_t length { static_cast<size_t> (token & 15) };
+        if (length == 15)
+            readLength (length);
+        op += length + 4;
+        if (op + 5 > size)
+            return false;
+    }
+    return false;
+}
+
+/**
+ * @brief a tree like a typical document: many children with the same property
+ * names, some repeated strings, and numeric data.
+ */
+juce::ValueTree makeSamples (int numItems)
+{
+    juce::Random random { 42 };
+    juce::ValueTree doc { "document" };
+    for (int i { 0 }; i < numItems; ++i)
+    {
+        juce::ValueTree item { "item" };
+        item.setProperty ("id", i, nullptr);
+        item.setProperty ("name", "item " + juce::String (i % 100), nullptr);
+        item.setProperty ("gain", random.nextDouble (), nullptr);
+        item.setProperty ("muted", random.nextBool (), nullptr);
+        item.setProperty ("color", "#ff" + juce::String::toHexString (i % 4096), nullptr);
+        doc.appendChild (item, nullptr);
+    }
+    return doc;
+}
+} // namespace
+
+class Test_cello_codec : public TestSuite
+{
+public:
+    Test_cello_codec ()
+    : TestSuite ("cello_codec", "cello")
+    {
+    }
+
+    void runTest () override
+    {
+        test ("round trip",
+              [this] ()
+              {
+                  const cello::LzCodec lz;
+                  const cello::GzipCodec gzip;
+                  const juce::MemoryBlock runs { 100000, true };
+                  for (const auto& input :
+                       { juce::MemoryBlock {}, makeText (3), makeText (100000), makeNoise (70000),
+                         runs })
+                  {
+                      for (const auto* codec : { static_cast<const cello::Codec*> (&lz),
+                                                 static_cast<const cello::Codec*> (&gzip) })
+                      {
+                          for (int level : { cello::Codec::defaultLevel, 1, 5, 9 })
+                          {
+                              juce::MemoryOutputStream compressed;
+                              expect (codec->compress (input.getData (), input.getSize (),
+                                                       compressed, level));
+                              juce::MemoryBlock output;
+                              expect (codec->decompress (compressed.getData (),
+                                                         compressed.getDataSize (), output));
+                              expect (output == input);
+                          }
+                      }
+                  }
+              });
+
+        test ("lz ratio and levels",
+              [this] ()
+              {
+                  const cello::LzCodec lz;
+                  const auto text { makeText (200000) };
+                  juce::MemoryOutputStream fast;
+                  lz.compress (text.getData (), text.getSize (), fast, 1);
+                  juce::MemoryOutputStream small;
+                  lz.compress (text.getData (), text.getSize (), small, 9);
+                  expect (fast.getDataSize () < text.getSize () / 2);
+                  expect (small.getDataSize () <= fast.getDataSize ());
+
+                  // incompressible data doesn't grow much.
+                  const auto noise { makeNoise (100000) };
+                  juce::MemoryOutputStream noisy;
+                  lz.compress (noise.getData (), noise.getSize (), noisy);
+                  expect (noisy.getDataSize () < noise.getSize () + noise.getSize () / 100);
+              });
+
+        test ("lz end of block",
+              [this] ()
+              {
+                  const cello::LzCodec lz;
+                  // runs compress to a single long match, ending as close to the
+                  // end of the data as the rules allow.
+                  for (size_t size { 0 }; size < 100; ++size)
+                  {
+                      const juce::MemoryBlock runs { size, true };
+                      juce::MemoryOutputStream compressed;
+                      expect (lz.compress (runs.getData (), runs.getSize (), compressed));
+                      expect (followsEndOfBlockRules (compressed, size), juce::String (size));
+                  }
+                  const auto text { makeText (10000) };
+                  juce::MemoryOutputStream compressed;
+                  expect (lz.compress (text.getData (), text.getSize (), compressed, 9));
+                  expect (followsEndOfBlockRules (compressed, text.getSize ()));
+              });
+
+        test ("gzip incomplete data",
+              [this] ()
+              {
+                  const cello::GzipCodec gzip;
+                  const auto text { makeText (10000) };
+                  juce::MemoryOutputStream compressed;
+                  expect (gzip.compress (text.getData (), text.getSize (), compressed));
+                  const auto* data { static_cast<const char*> (compressed.getData ()) };
+                  juce::MemoryBlock output;
+                  expect (gzip.decompress (data, compressed.getDataSize (), output));
+
+                  // a stream that stops early isn't complete, even if it decompresses.
+                  for (auto size : { size_t { 0 }, size_t { 5 }, compressed.getDataSize () / 2,
+                                     compressed.getDataSize () - 4,
+                                     compressed.getDataSize () - 1 })
+                      expect (!gzip.decompress (data, size, output));
+              });
+
+        test ("lz damaged data",
+              [this] ()
+              {
+                  const cello::LzCodec lz;
+                  const auto text { makeText (10000) };
+                  juce::MemoryOutputStream compressed;
+                  lz.compress (text.getData (), text.getSize (), compressed);
+                  const auto* data { static_cast<const char*> (compressed.getData ()) };
+                  juce::MemoryBlock output;
+
+                  for (size_t size { 0 }; size < compressed.getDataSize (); size += 7)
+                      expect (!lz.decompress (data, size, output));
+
+                  // damaged bytes must never be read or written out of bounds.
+                  juce::Random random { 99 };
+                  for (int i { 0 }; i < 200; ++i)
+                  {
+                      juce::MemoryBlock damaged { compressed.getData (),
+                                                  compressed.getDataSize () };
+                      damaged[random.nextInt (static_cast<int> (damaged.getSize ()))] =
+                          static_cast<char> (random.nextInt (256));
+                      if (lz.decompress (damaged.getData (), damaged.getSize (), output))
+                          expectEquals (output.getSize (), text.getSize ());
+                  }
+              });
+
+        test ("save/load",
+              [this] ()
+              {
+                  juce::TemporaryFile tempFile;
+                  const auto file { tempFile.getFile () };
+                  cello::Object doc { "document", makeSamples (500) };
+
+                  expect (doc.save (file, cello::Object::FileFormat::lz));
+                  expect (cello::Object::load (file, cello::Object::FileFormat::lz)
+                              .isEquivalentTo (doc));
+                  expect (cello::Object::load (file, cello::LzCodec {}).isEquivalentTo (doc));
+
+                  expect (doc.save (file, cello::LzCodec {}, 9));
+                  expect (cello::Object::load (file, cello::Object::FileFormat::lz)
+                              .isEquivalentTo (doc));
+
+                  // the gzip codec is compatible with the zipped format.
+                  expect (doc.save (file, cello::GzipCodec {}, 1));
+                  expect (cello::Object::load (file, cello::Object::FileFormat::zipped)
+                              .isEquivalentTo (doc));
+                  expect (cello::Object::load (file, cello::GzipCodec {}).isEquivalentTo (doc));
+                  file.deleteFile ();
+              });
+
+#if CELLO_RUN_BENCHMARKS
+        test ("benchmark: formats and codecs",
+              [this] ()
+              {
+                  struct Candidate
+                  {
+                      juce::String name;
+                      std::function<juce::Result (const cello::Object&, const juce::File&)> save;
+                      std::function<juce::ValueTree (const juce::File&)> load;
+                  };
+
+                  const auto withFormat = [] (const juce::String& name,
+                                              cello::Object::FileFormat format)
+                  {
+                      return Candidate {
+                          name, [format] (const cello::Object& object, const juce::File& file)
+                          { return object.save (file, format); },
+                          [format] (const juce::File& file)
+                          { return cello::Object::load (file, format); }
+                      };
+                  };
+
+                  const auto withCodec = [] (const juce::String& name,
+                                             std::shared_ptr<cello::Codec> codec, int level)
+                  {
+                      return Candidate {
+                          name, [codec, level] (const cello::Object& object, const juce::File& file)
+                          { return object.save (file, *codec, level); },
+                          [codec] (const juce::File& file)
+                          { return cello::Object::load (file, *codec); }
+                      };
+                  };
+
+                  using Format = cello::Object::FileFormat;
+                  const std::vector<Candidate> candidates {
+                      withFormat ("xml", Format::xml),
+                      withFormat ("binary", Format::binary),
+                      withFormat ("zipped", Format::zipped),
+                      withFormat ("compact", Format::compact),
+                      withFormat ("lz", Format::lz),
+                      withCodec ("gzip level 1", std::make_shared<cello::GzipCodec> (), 1),
+                      withCodec ("gzip level 9", std::make_shared<cello::GzipCodec> (), 9),
+                      withCodec ("lz level 9", std::make_shared<cello::LzCodec> (), 9)
+                  };
+
+                  for (int numItems : { 10000, 100000 })
+                  {
+                      cello::Object doc { "document", makeSamples (numItems) };
+                      for (const auto& candidate : candidates)
+                      {
+                          juce::TemporaryFile tempFile;
+                          const auto file { tempFile.getFile () };
+                          auto start { juce::Time::getMillisecondCounterHiRes () };
+                          expect (candidate.save (doc, file));
+                          const auto saveTime { juce::Time::getMillisecondCounterHiRes () - start };
+
+                          start = juce::Time::getMillisecondCounterHiRes ();
+                          const auto loaded { candidate.load (file) };
+                          const auto loadTime { juce::Time::getMillisecondCounterHiRes () - start };
+                          expectEquals (loaded.getNumChildren (), numItems);
+
+                          logMessage (juce::String (numItems) + " items, " + candidate.name + ": " +
+                                      juce::String (file.getSize ()) + " bytes, save " +
+                                      juce::String (saveTime, 1) + " ms, load " +
+                                      juce::String (loadTime, 1) + " ms");
+                          file.deleteFile ();
+                      }
+                  }
+              });
+#endif
+    }
+};
+
+static Test_cello_codec testcello_codec;
@@ -0,0 +1,208 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <juce_core/juce_core.h>
+#include <juce_data_structures/juce_data_structures.h>
+
+#include "../cello_compact.h"
+#include "../cello_object.h"
+
+namespace
+{
+juce::ValueTree makeRecords (int count, int numProperties)
+{
+    juce::ValueTree root { "records" };
+    for (int i { 0 }; i < count; ++i)
+    {
+        juce::ValueTree record { "record" };
+        for (int p { 0 }; p < numProperties; ++p)
+            record.setProperty ("property_" + juce::String (p), i * p, nullptr);
+        root.appendChild (record, nullptr);
+    }
+    return root;
+}
+
+juce::ValueTree roundTrip (const juce::ValueTree& tree)
+{
+    juce::MemoryOutputStream out;
+    cello::CompactFormat::write (tree, out);
+    juce::MemoryInputStream in { out.getData (), out.getDataSize (), false };
+    return cello::CompactFormat::read (in);
+}
+
+bool identical (const juce::ValueTree& lhs, const juce::ValueTree& rhs)
+{
+    // like isEquivalentTo(), but values must also have the same type.
+    if (lhs.getType () != rhs.getType () || lhs.getNumProperties () != rhs.getNumProperties () ||
+        lhs.getNumChildren () != rhs.getNumChildren ())
+        return false;
+    for (int i { 0 }; i < lhs.getNumProperties (); ++i)
+    {
+        const auto name { lhs.getPropertyName (i) };
+        if (!rhs.hasProperty (name) || !lhs[name].equalsWithSameType (rhs[name]))
+            return false;
+    }
+    for (int i { 0 }; i < lhs.getNumChildren (); ++i)
+    {
+        if (!identical (lhs.getChild (i), rhs.getChild (i)))
+            return false;
+    }
+    return true;
+}
+} // namespace
+
+class Test_cello_compact : public TestSuite
+{
+public:
+    Test_cello_compact ()
+    : TestSuite ("cello_compact", "cello")
+    {
+    }
+
+    void runTest () override
+    {
+        test ("value types",
+              [this] ()
+              {
+                  juce::ValueTree tree { "types" };
+                  tree.setProperty ("void", {}, nullptr);
+                  tree.setProperty ("int", -12345, nullptr);
+                  tree.setProperty ("maxInt", std::numeric_limits<int>::max (), nullptr);
+                  tree.setProperty ("smallInt64", juce::int64 { 7 }, nullptr);
+                  tree.setProperty ("int64", std::numeric_limits<juce::int64>::min (), nullptr);
+                  tree.setProperty ("true", true, nullptr);
+                  tree.setProperty ("false", false, nullptr);
+                  tree.setProperty ("double", -3.25e100, nullptr);
+                  tree.setProperty ("string", juce::String::fromUTF8 ("na\xc3\xafve"), nullptr);
+                  tree.setProperty ("empty", juce::String {}, nullptr);
+                  const char bytes[] { 0, 1, 2, -1 };
+                  tree.setProperty ("binary", juce::MemoryBlock { bytes, sizeof (bytes) }, nullptr);
+                  juce::Array<juce::var> inner { 1, 2.5, "three" };
+                  juce::Array<juce::var> array { inner, true, juce::var {} };
+                  tree.setProperty ("array", array, nullptr);
+
+                  juce::ValueTree child { "child" };
+                  child.setProperty ("int", 1, nullptr);
+                  child.appendChild (juce::ValueTree { "grandchild" }, nullptr);
+                  tree.appendChild (child, nullptr);
+                  tree.appendChild (juce::ValueTree { "types" }, nullptr);
+
+                  const auto result { roundTrip (tree) };
+                  expect (result.isValid ());
+                  expect (identical (tree, result));
+              });
+
+        test ("size",
+              [this] ()
+              {
+                  const auto tree { makeRecords (1000, 30) };
+                  juce::MemoryOutputStream binary;
+                  tree.writeToStream (binary);
+                  juce::MemoryOutputStream compact;
+                  expect (cello::CompactFormat::write (tree, compact));
+                  // names are only written once.
+                  expect (compact.getDataSize () * 2 < binary.getDataSize ());
+                  expect (roundTrip (tree).isEquivalentTo (tree));
+              });
+
+        test ("save/load",
+              [this] ()
+              {
+                  juce::TemporaryFile tempFile;
+                  cello::Object records { "records", makeRecords (100, 5) };
+                  expect (records.save (tempFile.getFile (), cello::Object::FileFormat::compact));
+                  const auto loaded { cello::Object::load (tempFile.getFile (),
+                                                           cello::Object::FileFormat::compact) };
+                  expect (identical (loaded, records));
+                  tempFile.getFile ().deleteFile ();
+              });
+
+        test ("read from a stream",
+              [this] ()
+              {
+                  // the reader doesn't keep the data that follows a tree.
+                  const auto first { makeRecords (1000, 5) };
+                  const auto second { makeRecords (10, 2) };
+                  juce::MemoryOutputStream out;
+                  expect (cello::CompactFormat::write (first, out));
+                  const auto firstSize { out.getDataSize () };
+                  expect (cello::CompactFormat::write (second, out));
+                  out.writeInt (1234);
+
+                  juce::MemoryInputStream in { out.getData (), out.getDataSize (), false };
+                  expect (identical (cello::CompactFormat::read (in), first));
+                  expectEquals (in.getPosition (), static_cast<juce::int64> (firstSize));
+                  expect (identical (cello::CompactFormat::read (in), second));
+                  expectEquals (in.readInt (), 1234);
+                  expect (in.isExhausted ());
+              });
+
+        test ("invalid data",
+              [this] ()
+              {
+                  juce::MemoryOutputStream out;
+                  cello::CompactFormat::write (makeRecords (10, 3), out);
+                  const auto* data { static_cast<const char*> (out.getData ()) };
+
+                  // truncated at every possible length.
+                  for (size_t size { 0 }; size < out.getDataSize (); ++size)
+                  {
+                      juce::MemoryInputStream in { data, size, false };
+                      expect (!cello::CompactFormat::read (in).isValid ());
+                  }
+
+                  // not our format
+                  juce::MemoryOutputStream binary;
+                  makeRecords (10, 3).writeToStream (binary);
+                  juce::MemoryInputStream in { binary.getData (), binary.getDataSize (), false };
+                  expect (!cello::CompactFormat::read (in).isValid ());
+              });
+
+#if CELLO_RUN_BENCHMARKS
+        test ("benchmark: compact vs. binary",
+              [this] ()
+              {
+                  const auto tree { makeRecords (100000, 30) };
+                  for (auto format :
+                       { cello::Object::FileFormat::binary, cello::Object::FileFormat::zipped,
+                         cello::Object::FileFormat::compact })
+                  {
+                      juce::TemporaryFile tempFile;
+                      const auto file { tempFile.getFile () };
+                      auto start { juce::Time::getMillisecondCounterHiRes () };
+                      expect (cello::Object { "records", tree }.save (file, format));
+                      const auto saveTime { juce::Time::getMillisecondCounterHiRes () - start };
+
+                      start = juce::Time::getMillisecondCounterHiRes ();
+                      const auto loaded { cello::Object::load (file, format) };
+                      const auto loadTime { juce::Time::getMillisecondCounterHiRes () - start };
+                      expectEquals (loaded.getNumChildren (), tree.getNumChildren ());
+
+                      logMessage ("format " + juce::String (static_cast<int> (format)) + ": " +
+                                  juce::String (file.getSize ()) + " bytes, save " +
+                                  juce::String (saveTime, 1) + " ms, load " +
+                                  juce::String (loadTime, 1) + " ms");
+                      file.deleteFile ();
+                  }
+              });
+#endif
+    }
+};
+
+static Test_cello_compact testcello_compact;
@@ -0,0 +1,201 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <juce_core/juce_core.h>
+
+#include "../cello_object.h"
+
+namespace
+{
+juce::ValueTree makeItem (int key, float value)
+{
+    juce::ValueTree item { "item" };
+    item.setProperty ("key", key, nullptr);
+    item.setProperty ("value", value, nullptr);
+    return item;
+}
+
+/**
+ * @brief Make a list of items using the keys in the order given.
+ */
+juce::ValueTree makeList (std::initializer_list<int> keys)
+{
+    juce::ValueTree list { "list" };
+    for (auto key : keys)
+        list.appendChild (makeItem (key, key * 0.5f), nullptr);
+    return list;
+}
+
+int countEdits (const cello::Patch& patch, cello::Patch::EditType type)
+{
+    return static_cast<int> (std::count_if (patch.begin (), patch.end (),
+                                            [type] (const cello::Patch::Edit& edit)
+                                            { return edit.type == type; }));
+}
+} // namespace
+
+class Test_cello_diff : public TestSuite
+{
+public:
+    Test_cello_diff ()
+    : TestSuite ("cello_diff", "cello")
+    {
+    }
+
+    /**
+     * @brief Diff two trees, apply the patch to a copy of the first, and verify
+     * that the result is equivalent to the second.
+     */
+    cello::Patch checkRoundTrip (const juce::ValueTree& from, const juce::ValueTree& to,
+                                 const juce::Identifier& key = {})
+    {
+        const auto patch { cello::Diff { key }.compare (from, to) };
+        auto patched { from.createCopy () };
+        expect (patch.apply (patched));
+        expect (patched.isEquivalentTo (to));
+        return patch;
+    }
+
+    void runTest () override
+    {
+        using EditType = cello::Patch::EditType;
+
+        test ("equivalent trees",
+              [this] ()
+              {
+                  const auto list { makeList ({ 1, 2, 3 }) };
+                  expect (cello::Diff ().compare (list, list.createCopy ()).isEmpty ());
+
+                  // property order doesn't matter.
+                  juce::ValueTree a { "a" };
+                  a.setProperty ("x", 1, nullptr).setProperty ("y", 2, nullptr);
+                  juce::ValueTree b { "a" };
+                  b.setProperty ("y", 2, nullptr).setProperty ("x", 1, nullptr);
+                  expect (cello::Diff ().compare (a, b).isEmpty ());
+              });
+
+        test ("property edits",
+              [this] ()
+              {
+                  juce::ValueTree from { "a" };
+                  from.setProperty ("x", 1, nullptr)
+                      .setProperty ("y", 2, nullptr)
+                      .setProperty ("z", 3, nullptr);
+                  auto to { from.createCopy () };
+                  to.setProperty ("x", 100, nullptr);
+                  to.removeProperty ("y", nullptr);
+                  // same value, different type is a change.
+                  to.setProperty ("z", "3", nullptr);
+
+                  const auto patch { checkRoundTrip (from, to) };
+                  expectEquals (patch.size (), 3);
+                  expectEquals (countEdits (patch, EditType::setProperty), 2);
+                  expectEquals (countEdits (patch, EditType::removeProperty), 1);
+              });
+
+        test ("positional children",
+              [this] ()
+              {
+                  const auto from { makeList ({ 1, 2, 3, 4 }) };
+                  auto to { from.createCopy () };
+                  to.getChild (2).setProperty ("value", -1.f, nullptr);
+                  to.appendChild (makeItem (5, 2.5f), nullptr);
+
+                  auto patch { checkRoundTrip (from, to) };
+                  expectEquals (patch.size (), 2);
+                  expectEquals (countEdits (patch, EditType::setProperty), 1);
+                  expectEquals (countEdits (patch, EditType::insertChild), 1);
+                  // the property change is made in place on the matching child.
+                  for (const auto& edit : patch)
+                  {
+                      if (edit.type == EditType::setProperty)
+                          expect (edit.path == std::vector<int> { 2 });
+                  }
+
+                  patch = checkRoundTrip (to, from);
+                  expectEquals (countEdits (patch, EditType::removeChild), 1);
+              });
+
+        test ("keyed children",
+              [this] ()
+              {
+                  const juce::Identifier key { "key" };
+                  // moving one child to the end should be one edit.
+                  auto patch { checkRoundTrip (makeList ({ 4, 1, 2, 3 }),
+                                               makeList ({ 1, 2, 3, 4 }), key) };
+                  expectEquals (patch.size (), 1);
+                  expectEquals (countEdits (patch, EditType::moveChild), 1);
+
+                  // matching by position would rewrite every item instead.
+                  patch = checkRoundTrip (makeList ({ 4, 1, 2, 3 }),
+                                          makeList ({ 1, 2, 3, 4 }));
+                  expectEquals (countEdits (patch, EditType::setProperty), 8);
+
+                  // combination of removes, inserts, and moves.
+                  patch = checkRoundTrip (makeList ({ 1, 2, 3, 4, 5, 6, 7, 8 }),
+                                          makeList ({ 9, 8, 2, 3, 10, 5, 1, 7 }), key);
+                  expectEquals (countEdits (patch, EditType::removeChild), 2);
+                  expectEquals (countEdits (patch, EditType::insertChild), 2);
+                  expectEquals (countEdits (patch, EditType::moveChild), 2);
+                  expectEquals (countEdits (patch, EditType::setProperty), 0);
+
+                  checkRoundTrip (makeList ({ 1, 2, 3 }), makeList ({ 3, 2, 1 }), key);
+                  checkRoundTrip (makeList ({}), makeList ({ 3, 2, 1 }), key);
+                  checkRoundTrip (makeList ({ 1, 2, 3 }), makeList ({}), key);
+              });
+
+        test ("nested changes",
+              [this] ()
+              {
+                  juce::ValueTree from { "root" };
+                  for (int i { 0 }; i < 10; ++i)
+                      from.appendChild (makeList ({ 1, 2, 3, 4, 5 }), nullptr);
+                  auto to { from.createCopy () };
+                  to.getChild (7).getChild (3).setProperty ("value", 99, nullptr);
+
+                  const auto patch { checkRoundTrip (from, to) };
+                  expectEquals (patch.size (), 1);
+                  expect (patch.begin ()->path == std::vector<int> { 7, 3 });
+              });
+
+        test ("apply to object",
+              [this] ()
+              {
+                  cello::Object list { "list", makeList ({ 1, 2, 3 }) };
+                  juce::UndoManager undo;
+                  list.setUndoManager (&undo);
+                  const auto original { list.clone (true) };
+
+                  const auto target { makeList ({ 3, 4, 1 }) };
+                  int childAdded { 0 };
+                  list.onChildAdded = [&childAdded] (juce::ValueTree&, int, int)
+                  { ++childAdded; };
+                  expect (list.apply (cello::Diff { "key" }.compare (list, target)));
+                  expectEquals (childAdded, 1);
+                  expect (juce::ValueTree { list }.isEquivalentTo (target));
+
+                  // the whole patch is undone in one step.
+                  expect (list.undo ());
+                  expect (juce::ValueTree { list }.isEquivalentTo (original));
+                  expect (!list.canUndo ());
+              });
+    }
+};
+
+static Test_cello_diff testcello_diff;
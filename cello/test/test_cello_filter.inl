@@ -0,0 +1,329 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <cmath>
+#include <limits>
+#include <juce_core/juce_core.h>
+
+#include "../cello_filter.h"
+#include "../cello_object.h"
+#include "../cello_query.h"
+
+namespace
+{
+using CompareOp = cello::ColumnFilter::Op;
+
+const CompareOp allCompareOps[] { CompareOp::less,         CompareOp::lessEqual,
+                                  CompareOp::greater,      CompareOp::greaterEqual,
+                                  CompareOp::equal,        CompareOp::notEqual };
+
+template <typename T> bool referenceCompare (T value, CompareOp op, T operand)
+{
+    switch (op)
+    {
+        case CompareOp::less: return value < operand;
+        case CompareOp::lessEqual: return value <= operand;
+        case CompareOp::greater: return value > operand;
+        case CompareOp::greaterEqual: return value >= operand;
+        case CompareOp::equal: return value == operand;
+        case CompareOp::notEqual: return value != operand;
+    }
+    return false;
+}
+
+/**
+ * @brief Values from a small range, so that every comparison has matches
+ * (including equal ones).
+ */
+template <typename T> std::vector<T> makeFilterValues (size_t count, juce::Random& random)
+{
+    std::vector<T> values (count);
+    for (auto& value : values)
+        value = static_cast<T> (random.nextInt (20) - 10);
+    return values;
+}
+
+juce::ValueTree makeFilterTree (int count)
+{
+    juce::ValueTree parent { "voices" };
+    for (int i { 0 }; i < count; ++i)
+    {
+        juce::ValueTree voice { "voice" };
+        voice.setProperty ("note", 48 + (i % 36), nullptr);
+        voice.setProperty ("gain", static_cast<double> (i % 10) / 10.0, nullptr);
+        if (i % 3 == 0)
+            voice.setProperty ("held", true, nullptr);
+        parent.appendChild (voice, nullptr);
+    }
+    return parent;
+}
+
+} // namespace
+
+class Test_cello_filter : public TestSuite
+{
+public:
+    Test_cello_filter ()
+    : TestSuite ("cello_filter", "cello")
+    {
+    }
+
+    void runTest () override
+    {
+        tearDown ([] () { cello::ColumnFilter::setScalarOnly (false); });
+
+        test ("selection",
+              [this] ()
+              {
+                  cello::Selection none { 70 };
+                  expectEquals (static_cast<int> (none.count ()), 0);
+                  cello::Selection all { 70, true };
+                  expectEquals (static_cast<int> (all.count ()), 70);
+                  expectEquals (static_cast<int> (all.getNumWords ()), 2);
+                  // bits past the end stay clear.
+                  expectEquals (all.getWords ()[1], juce::uint64 { 0x3f });
+
+                  none.set (3, true);
+                  none.set (69, true);
+                  expect (none[3] && none[69] && !none[4]);
+                  auto both { none };
+                  both &= all;
+                  expectEquals (static_cast<int> (both.count ()), 2);
+                  none.set (3, false);
+                  both |= none;
+                  expectEquals (static_cast<int> (both.count ()), 2);
+                  both &= none;
+                  expectEquals (static_cast<int> (both.count ()), 1);
+              });
+
+        test ("compare kernels",
+              [this] ()
+              {
+                  logMessage ("filter kernels: " + cello::ColumnFilter::getKernelName ());
+                  auto& random { juce::Random::getSystemRandom () };
+                  for (const auto scalarOnly : { false, true })
+                  {
+                      cello::ColumnFilter::setScalarOnly (scalarOnly);
+                      for (const size_t count : { 0, 1, 63, 64, 65, 1000 })
+                      {
+                          auto floats { makeFilterValues<float> (count, random) };
+                          const auto doubles { makeFilterValues<double> (count, random) };
+                          const auto ints { makeFilterValues<int> (count, random) };
+                          if (count > 10)
+                              floats[10] = std::numeric_limits<float>::quiet_NaN ();
+
+                          for (const auto op : allCompareOps)
+                          {
+                              const auto f { cello::ColumnFilter::compare (floats.data (), count,
+                                                                           op, 2.f) };
+                              const auto d { cello::ColumnFilter::compare (doubles.data (),
+                                                                           count, op, -3.0) };
+                              const auto n { cello::ColumnFilter::compare (ints.data (), count,
+                                                                           op, 0) };
+                              expectEquals (static_cast<int> (f.size ()), static_cast<int> (count));
+                              for (size_t i { 0 }; i < count; ++i)
+                              {
+                                  expect (f[i] == referenceCompare (floats[i], op, 2.f));
+                                  expect (d[i] == referenceCompare (doubles[i], op, -3.0));
+                                  expect (n[i] == referenceCompare (ints[i], op, 0));
+                              }
+                          }
+                      }
+                  }
+              });
+
+        test ("range kernels",
+              [this] ()
+              {
+                  auto& random { juce::Random::getSystemRandom () };
+                  for (const auto scalarOnly : { false, true })
+                  {
+                      cello::ColumnFilter::setScalarOnly (scalarOnly);
+                      const size_t count { 333 };
+                      auto floats { makeFilterValues<float> (count, random) };
+                      floats[100] = std::numeric_limits<float>::quiet_NaN ();
+                      const auto ints { makeFilterValues<int> (count, random) };
+
+                      const auto f { cello::ColumnFilter::range (floats.data (), count, -2.f,
+                                                                 4.f) };
+                      const auto n { cello::ColumnFilter::range (ints.data (), count, 0, 0) };
+                      for (size_t i { 0 }; i < count; ++i)
+                      {
+                          expect (f[i] == (floats[i] >= -2.f && floats[i] <= 4.f));
+                          expect (n[i] == (ints[i] == 0));
+                      }
+
+                      cello::Column<float> column { "column" };
+                      juce::ValueTree parent { "parent" };
+                      for (int i { 0 }; i < 10; ++i)
+                          parent.appendChild (juce::ValueTree { "child" }.setProperty (
+                                                  "column", static_cast<float> (i), nullptr),
+                                              nullptr);
+                      cello::Object { "parent", parent }.exportColumns (column);
+                      expectEquals (
+                          static_cast<int> (cello::ColumnFilter::range (column, 2.f, 5.f).count ()),
+                          4);
+                  }
+              });
+
+        test ("conditions",
+              [this] ()
+              {
+                  const auto voices { makeFilterTree (100) };
+                  using Condition = cello::Condition;
+
+                  const auto low { Condition::compare ("note", CompareOp::less, 60) };
+                  const auto loud { Condition::range ("gain", 0.5, 1.0) };
+                  const auto held { Condition::compare ("held", CompareOp::equal, 1) };
+
+                  const auto lowAndLoud { (low && loud).evaluate (voices) };
+                  const auto lowOrHeld { (low || held).evaluate (voices) };
+                  const auto nested { (loud && (low || held)).evaluate (voices) };
+                  for (int i { 0 }; i < voices.getNumChildren (); ++i)
+                  {
+                      const auto voice { voices.getChild (i) };
+                      const auto isLow { static_cast<int> (voice["note"]) < 60 };
+                      const auto isLoud { static_cast<double> (voice["gain"]) >= 0.5 };
+                      // children without the property don't match.
+                      const auto isHeld { voice.hasProperty ("held") };
+                      const auto index { static_cast<size_t> (i) };
+                      expect (lowAndLoud[index] == (isLow && isLoud));
+                      expect (lowOrHeld[index] == (isLow || isHeld));
+                      expect (nested[index] == (isLoud && (isLow || isHeld)));
+                  }
+              });
+
+        test ("query",
+              [this] ()
+              {
+                  const auto voices { makeFilterTree (100) };
+                  cello::Query predicates;
+                  predicates
+                      .addFilter ([] (juce::ValueTree tree)
+                                  { return static_cast<int> (tree["note"]) >= 70; })
+                      .addFilter ([] (juce::ValueTree tree)
+                                  { return static_cast<double> (tree["gain"]) < 0.3; });
+
+                  cello::Query conditions;
+                  conditions.where (cello::Condition::compare ("note", CompareOp::greaterEqual, 70))
+                      .where (cello::Condition::compare ("gain", CompareOp::less, 0.3));
+
+                  // conditions and predicates can be used together; predicates only
+                  // see the children that the conditions selected.
+                  int predicateCalls { 0 };
+                  cello::Query mixed;
+                  mixed.where (cello::Condition::compare ("note", CompareOp::greaterEqual, 70))
+                      .addFilter (
+                          [&predicateCalls] (juce::ValueTree tree)
+                          {
+                              ++predicateCalls;
+                              return static_cast<double> (tree["gain"]) < 0.3;
+                          });
+
+                  const auto expected { predicates.search (voices, false) };
+                  expect (expected.getNumChildren () > 0);
+                  expect (conditions.search (voices, false).isEquivalentTo (expected));
+                  expect (mixed.search (voices, false).isEquivalentTo (expected));
+                  int highNotes { 0 };
+                  for (const auto& voice : voices)
+                      highNotes += static_cast<int> (voice["note"]) >= 70 ? 1 : 0;
+                  expectEquals (predicateCalls, highNotes);
+              });
+
+#if CELLO_RUN_BENCHMARKS
+        test ("benchmark: filter kernels",
+              [this] ()
+              {
+                  constexpr size_t count { 1000000 };
+                  auto& random { juce::Random::getSystemRandom () };
+                  const auto values { makeFilterValues<float> (count, random) };
+
+                  const auto timeFilter = [&values] ()
+                  {
+                      const auto start { juce::Time::getMillisecondCounterHiRes () };
+                      size_t selected { 0 };
+                      for (int i { 0 }; i < 10; ++i)
+                          selected += cello::ColumnFilter::range (values.data (), count, -2.f, 4.f)
+                                          .count ();
+                      return std::make_pair (juce::Time::getMillisecondCounterHiRes () - start,
+                                             selected);
+                  };
+
+                  const auto vector { timeFilter () };
+                  cello::ColumnFilter::setScalarOnly (true);
+                  const auto scalar { timeFilter () };
+                  expect (vector.second == scalar.second);
+                  logMessage ("10 x " + juce::String (static_cast<int> (count)) +
+                              " range filters: " + cello::ColumnFilter::getKernelName () + " " +
+                              juce::String (scalar.first, 1) + " ms, vector " +
+                              juce::String (vector.first, 1) + " ms");
+              });
+
+        test ("benchmark: query conditions",
+              [this] ()
+              {
+                  const auto voices { makeFilterTree (10000) };
+                  cello::Query predicates;
+                  predicates.addFilter (
+                      [] (juce::ValueTree tree)
+                      {
+                          const auto note { static_cast<int> (tree["note"]) };
+                          return note >= 60 && note <= 72 &&
+                                 static_cast<double> (tree["gain"]) > 0.5;
+                      });
+                  cello::Query conditions;
+                  conditions.where (cello::Condition::range ("note", 60, 72) &&
+                                    cello::Condition::compare ("gain", CompareOp::greater, 0.5));
+
+                  const auto timeQuery = [&voices] (const cello::Query& query, double& best)
+                  {
+                      const auto start { juce::Time::getMillisecondCounterHiRes () };
+                      const auto result { query.search (voices, false) };
+                      best = std::min (best, juce::Time::getMillisecondCounterHiRes () - start);
+                      return result.getNumChildren ();
+                  };
+
+                  // run each once before timing, then alternate which goes first and
+                  // keep the best time of each.
+                  double predicateTime { std::numeric_limits<double>::max () };
+                  double conditionTime { std::numeric_limits<double>::max () };
+                  double warmup { 0 };
+                  expectEquals (timeQuery (conditions, warmup), timeQuery (predicates, warmup));
+                  for (int run { 0 }; run < 10; ++run)
+                  {
+                      if (run % 2 == 0)
+                      {
+                          timeQuery (predicates, predicateTime);
+                          timeQuery (conditions, conditionTime);
+                      }
+                      else
+                      {
+                          timeQuery (conditions, conditionTime);
+                          timeQuery (predicates, predicateTime);
+                      }
+                  }
+                  logMessage ("query of 10000 children, best of 10: std::function predicate " +
+                              juce::String (predicateTime, 1) + " ms, conditions " +
+                              juce::String (conditionTime, 1) + " ms");
+              });
+#endif
+    }
+};
+
+static Test_cello_filter testcello_filter;
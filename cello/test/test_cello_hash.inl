@@ -0,0 +1,162 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <juce_core/juce_core.h>
+
+#include "../cello_object.h"
+
+class Test_cello_hash : public TestSuite
+{
+public:
+    Test_cello_hash ()
+    : TestSuite ("cello_hash", "cello")
+    {
+    }
+
+    /**
+     * @brief Verify that the incrementally updated hash matches one
+     * calculated from scratch.
+     */
+    void checkTracker (const cello::HashTracker& tracker, const cello::Object& object)
+    {
+        expect (tracker.getHash () == cello::HashNode { object }.hash);
+    }
+
+    void runTest () override
+    {
+        test ("content hashes",
+              [this] ()
+              {
+                  juce::ValueTree a { "a" };
+                  a.setProperty ("x", 1, nullptr).setProperty ("y", "two", nullptr);
+                  juce::ValueTree b { "a" };
+                  b.setProperty ("y", "two", nullptr).setProperty ("x", 1, nullptr);
+                  // property order doesn't matter
+                  expect (cello::HashNode { a }.hash == cello::HashNode { b }.hash);
+
+                  // ...but types and values do.
+                  b.setProperty ("x", "1", nullptr);
+                  expect (cello::HashNode { a }.hash != cello::HashNode { b }.hash);
+                  b.setProperty ("x", 1, nullptr);
+                  expect (cello::HashNode { a }.hash == cello::HashNode { b }.hash);
+                  expect (cello::HashNode { a }.hash !=
+                          cello::HashNode { a.createCopy ().setProperty ("x", 2, nullptr) }
+                              .hash);
+
+                  // child order matters.
+                  a.appendChild (juce::ValueTree { "c1" }, nullptr);
+                  a.appendChild (juce::ValueTree { "c2" }, nullptr);
+                  b.appendChild (juce::ValueTree { "c2" }, nullptr);
+                  b.appendChild (juce::ValueTree { "c1" }, nullptr);
+                  expect (cello::HashNode { a }.hash != cello::HashNode { b }.hash);
+                  b.moveChild (0, 1, nullptr);
+                  expect (cello::HashNode { a }.hash == cello::HashNode { b }.hash);
+              });
+
+        test ("incremental updates",
+              [this] ()
+              {
+                  cello::Object root { "root", nullptr };
+                  cello::HashTracker tracker { root };
+                  checkTracker (tracker, root);
+                  const auto originalHash { tracker.getHash () };
+                  expect (!tracker.isDirty ());
+
+                  root.setattr ("name", juce::String ("root"));
+                  checkTracker (tracker, root);
+                  expect (tracker.isDirty ());
+                  root.delattr ("name");
+                  checkTracker (tracker, root);
+                  // back to where we started.
+                  expect (tracker.getHash () == originalHash);
+                  expect (!tracker.isDirty ());
+
+                  cello::Object leaf { "/a/b/c", root };
+                  checkTracker (tracker, root);
+                  cello::Object b { "/a/b", root };
+                  const auto bHash { tracker.getHash (b) };
+                  expect (bHash == cello::HashNode { b }.hash);
+
+                  leaf.setattr ("value", 3.14);
+                  checkTracker (tracker, root);
+                  expect (tracker.getHash (b) != bHash);
+                  expect (tracker.getHash (leaf) == cello::HashNode { leaf }.hash);
+
+                  for (int i { 0 }; i < 5; ++i)
+                  {
+                      cello::Object child { "child", nullptr };
+                      child.setattr ("index", i);
+                      b.append (&child);
+                      checkTracker (tracker, root);
+                  }
+                  b.move (0, 4);
+                  checkTracker (tracker, root);
+                  b.remove (2);
+                  checkTracker (tracker, root);
+
+                  // changes to children whose positions have shifted.
+                  cello::Object first { "child", nullptr };
+                  b.insert (&first, 0);
+                  checkTracker (tracker, root);
+                  juce::ValueTree bTree { b };
+                  for (int i { 0 }; i < bTree.getNumChildren (); ++i)
+                  {
+                      bTree.getChild (i).setProperty ("position", i, nullptr);
+                      checkTracker (tracker, root);
+                      expect (tracker.getHash (bTree.getChild (i)) ==
+                              cello::HashNode { bTree.getChild (i) }.hash);
+                  }
+                  b.move (4, 1);
+                  bTree.getChild (2).setProperty ("position", -1, nullptr);
+                  checkTracker (tracker, root);
+                  b.remove (0);
+                  bTree.getChild (0).setProperty ("position", -2, nullptr);
+                  checkTracker (tracker, root);
+
+                  tracker.markClean ();
+                  expect (!tracker.isDirty ());
+
+                  // trees outside of ours don't have hashes.
+                  cello::Object other { "other", nullptr };
+                  expect (tracker.getHash (other) == 0);
+              });
+
+        test ("diff with tracked hashes",
+              [this] ()
+              {
+                  cello::Object root { "root", nullptr };
+                  for (int i { 0 }; i < 10; ++i)
+                  {
+                      cello::Object child { "child", nullptr };
+                      child.setattr ("index", i);
+                      root.append (&child);
+                  }
+                  cello::HashTracker tracker { root };
+                  const auto snapshot { root.clone (true) };
+                  const cello::HashNode snapshotHash { snapshot };
+
+                  cello::Object { "child", root[3] }.setattr ("index", 100);
+                  const auto patch { cello::Diff ().compare (snapshot, snapshotHash, root,
+                                                             tracker.getNode ()) };
+                  expectEquals (patch.size (), 1);
+              });
+    }
+};
+
+static Test_cello_hash testcello_hash;
@@ -0,0 +1,269 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <juce_core/juce_core.h>
+
+#include "../cello_object.h"
+
+namespace
+{
+class Doc : public cello::Object
+{
+public:
+    Doc ()
+    : cello::Object ("doc", nullptr)
+    {
+    }
+
+    Doc (juce::ValueTree tree)
+    : cello::Object ("doc", tree)
+    {
+    }
+
+    MAKE_VALUE_MEMBER (juce::String, title, {});
+    MAKE_VALUE_MEMBER (int, revision, 0);
+};
+
+void deleteFiles (const juce::File& file)
+{
+    file.deleteFile ();
+    cello::Journal::getJournalFile (file).deleteFile ();
+}
+} // namespace
+
+class Test_cello_journal : public TestSuite
+{
+public:
+    Test_cello_journal ()
+    : TestSuite ("cello_journal", "cello")
+    {
+    }
+
+    void runTest () override
+    {
+        test ("journal and replay",
+              [this] ()
+              {
+                  juce::TemporaryFile tempFile;
+                  const auto file { tempFile.getFile () };
+                  const auto journalFile { cello::Journal::getJournalFile (file) };
+
+                  Doc doc;
+                  for (int i { 0 }; i < 100; ++i)
+                  {
+                      cello::Object item { "item", nullptr };
+                      item.setattr ("index", i).setattr ("data",
+                                                         juce::String::repeatedString ("x", 100));
+                      doc.append (&item);
+                  }
+
+                  {
+                      cello::Journal journal { doc, file };
+                      // the initial snapshot is written right away.
+                      expect (file.existsAsFile ());
+                      expect (!journalFile.existsAsFile ());
+
+                      doc.title = "journaled";
+                      ++doc.revision;
+                      doc.remove (10);
+                      doc.move (0, 50);
+                      cello::Object { "item", doc[3] }.setattr ("index", -3);
+                      cello::Object { "item", doc[4] }.delattr ("data");
+                      cello::Object added { "added", nullptr };
+                      doc.insert (&added, 7);
+
+                      expect (journal.getPendingSize () > 0);
+                      expect (journal.flush ());
+                      expectEquals (journal.getPendingSize (), size_t { 0 });
+                      // the journal only holds the changes, not the document.
+                      expect (journalFile.getSize () < file.getSize () / 10);
+
+                      const auto loaded { cello::Object::load (
+                          file, cello::Object::FileFormat::journaled) };
+                      expect (loaded.isEquivalentTo (doc));
+
+                      // more changes are appended to the same journal.
+                      doc.title = "again";
+                      expect (journal.flush ());
+                      expect (cello::Journal::load (file).isEquivalentTo (doc));
+                  }
+
+                  // ...and an Object can be created from the snapshot + journal.
+                  Doc reloaded { cello::Object::load (file,
+                                                      cello::Object::FileFormat::journaled) };
+                  expect (reloaded.getCreationType () == cello::Object::CreationType::wrapped);
+                  expect (static_cast<juce::String> (reloaded.title) == "again");
+                  expect (juce::ValueTree { reloaded }.isEquivalentTo (doc));
+                  deleteFiles (file);
+              });
+
+        test ("nested changes",
+              [this] ()
+              {
+                  juce::TemporaryFile tempFile;
+                  const auto file { tempFile.getFile () };
+
+                  Doc doc;
+                  juce::ValueTree root { doc };
+                  for (int i { 0 }; i < 5; ++i)
+                  {
+                      juce::ValueTree group { "group" };
+                      group.setProperty ("index", i, nullptr);
+                      for (int j { 0 }; j < 5; ++j)
+                          group.appendChild (juce::ValueTree { "item" }, nullptr);
+                      root.appendChild (group, nullptr);
+                  }
+
+                  cello::Journal journal { doc, file };
+                  // each change is recorded at the position its tree has when it's made.
+                  root.moveChild (4, 0, nullptr);
+                  root.getChild (0).getChild (2).setProperty ("value", 1, nullptr);
+                  root.removeChild (1, nullptr);
+                  root.getChild (2).getChild (4).setProperty ("value", 2, nullptr);
+                  root.getChild (3).addChild (juce::ValueTree { "item" }, 0, nullptr);
+                  root.getChild (3).getChild (1).setProperty ("value", 3, nullptr);
+                  root.getChild (3).moveChild (5, 0, nullptr);
+                  root.getChild (3).getChild (0).setProperty ("value", 4, nullptr);
+                  expect (journal.flush ());
+                  expect (cello::Journal::load (file).isEquivalentTo (root));
+                  deleteFiles (file);
+              });
+
+        test ("compaction",
+              [this] ()
+              {
+                  juce::TemporaryFile tempFile;
+                  const auto file { tempFile.getFile () };
+                  const auto journalFile { cello::Journal::getJournalFile (file) };
+
+                  Doc doc;
+                  cello::Journal journal { doc, file };
+                  journal.setCompactionThreshold (1000, 0.5);
+
+                  doc.title = "short";
+                  expect (journal.flush ());
+                  expect (journalFile.existsAsFile ());
+
+                  for (int i { 0 }; i < 100; ++i)
+                      doc.revision = i;
+                  expect (journal.flush ());
+                  // the journal got too large and was folded into the snapshot.
+                  expect (!journalFile.existsAsFile ());
+                  expect (cello::Journal::load (file).isEquivalentTo (doc));
+
+                  // saving in journaled format also writes a new snapshot.
+                  doc.title = "saved";
+                  expect (journal.flush ());
+                  expect (journalFile.existsAsFile ());
+                  expect (doc.save (file, cello::Object::FileFormat::journaled));
+                  expect (!journalFile.existsAsFile ());
+                  doc.title = "after save";
+                  expect (journal.flush ());
+                  expect (cello::Journal::load (file).isEquivalentTo (doc));
+                  deleteFiles (file);
+              });
+
+        test ("lazily loaded document",
+              [this] ()
+              {
+                  juce::TemporaryFile lazyTemp;
+                  juce::TemporaryFile tempFile;
+                  const auto file { tempFile.getFile () };
+
+                  juce::ValueTree original { "doc" };
+                  original.setProperty ("title", juce::String {}, nullptr);
+                  original.setProperty ("revision", 0, nullptr);
+                  for (int i { 0 }; i < 20; ++i)
+                  {
+                      juce::ValueTree item { "item" };
+                      item.setProperty ("index", i, nullptr);
+                      original.appendChild (item, nullptr);
+                  }
+                  expect (cello::LazyTree::save (original, lazyTemp.getFile ()));
+
+                  Doc doc { cello::Object::load (lazyTemp.getFile (),
+                                                 cello::Object::FileFormat::lazy) };
+                  {
+                      cello::Journal journal { doc, file };
+                      // the snapshot holds the contents of the placeholders.
+                      expect (cello::Journal::load (file).isEquivalentTo (original));
+
+                      // materializing a child isn't journaled, editing it is.
+                      cello::Object { "item", doc[3] }.setattr ("index", -3);
+                      cello::Object added { "item", nullptr };
+                      doc.append (&added);
+                      expect (journal.flush ());
+                      auto expected { original.createCopy () };
+                      expected.getChild (3).setProperty ("index", -3, nullptr);
+                      expected.appendChild (juce::ValueTree { "item" }, nullptr);
+                      expect (cello::Journal::load (file).isEquivalentTo (expected));
+
+                      // ...as is compacting the journal into a new snapshot.
+                      journal.setCompactionThreshold (0, 0.0);
+                      doc.title = "compacted";
+                      expect (journal.flush ());
+                      expect (!cello::Journal::getJournalFile (file).existsAsFile ());
+                      expected.setProperty ("title", "compacted", nullptr);
+                      expect (cello::Journal::load (file).isEquivalentTo (expected));
+                  }
+                  deleteFiles (file);
+              });
+
+        test ("partial record",
+              [this] ()
+              {
+                  juce::TemporaryFile tempFile;
+                  const auto file { tempFile.getFile () };
+                  const auto journalFile { cello::Journal::getJournalFile (file) };
+
+                  Doc doc;
+                  cello::Journal journal { doc, file };
+                  doc.title = "complete";
+                  expect (journal.flush ());
+                  const auto expected { juce::ValueTree { doc }.createCopy () };
+                  const auto size { journalFile.getSize () };
+
+                  doc.title = "interrupted";
+                  expect (journal.flush ());
+                  // simulate a crash partway through writing the last record.
+                  juce::MemoryBlock contents;
+                  expect (journalFile.loadFileAsData (contents));
+                  contents.setSize (static_cast<size_t> (size + 6));
+                  expect (journalFile.replaceWithData (contents.getData (), contents.getSize ()));
+
+                  expect (cello::Journal::load (file).isEquivalentTo (expected));
+
+                  // journaling the reloaded document drops the partial record, so
+                  // new changes are replayed.
+                  Doc reloaded { cello::Journal::load (file) };
+                  {
+                      cello::Journal resumed { reloaded, file };
+                      expectEquals (journalFile.getSize (), size);
+                      reloaded.revision = 2;
+                      expect (resumed.flush ());
+                  }
+                  const auto replayed { cello::Journal::load (file) };
+                  expect (replayed.isEquivalentTo (reloaded));
+                  expectEquals (static_cast<int> (replayed["revision"]), 2);
+                  deleteFiles (file);
+              });
+    }
+};
+
+static Test_cello_journal testcello_journal;
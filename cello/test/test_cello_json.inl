@@ -0,0 +1,229 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <juce_core/juce_core.h>
+#include <juce_data_structures/juce_data_structures.h>
+
+#include "../cello_json.h"
+#include "../cello_object.h"
+
+namespace
+{
+juce::String toJson (const juce::ValueTree& tree, bool allOnOneLine = true)
+{
+    juce::MemoryOutputStream out;
+    cello::JsonFormat::write (tree, out, allOnOneLine);
+    return out.toString ();
+}
+
+juce::ValueTree fromJson (const juce::String& text)
+{
+    juce::MemoryInputStream in { text.toRawUTF8 (), text.getNumBytesAsUTF8 (), false };
+    return cello::JsonFormat::read (in);
+}
+
+bool sameValueTypes (const juce::ValueTree& lhs, const juce::ValueTree& rhs)
+{
+    for (int i { 0 }; i < lhs.getNumProperties (); ++i)
+    {
+        const auto name { lhs.getPropertyName (i) };
+        if (!lhs[name].hasSameTypeAs (rhs[name]))
+            return false;
+    }
+    for (int i { 0 }; i < lhs.getNumChildren (); ++i)
+    {
+        if (!sameValueTypes (lhs.getChild (i), rhs.getChild (i)))
+            return false;
+    }
+    return true;
+}
+} // namespace
+
+class Test_cello_json : public TestSuite
+{
+public:
+    Test_cello_json ()
+    : TestSuite ("cello_json", "cello")
+    {
+    }
+
+    void runTest () override
+    {
+        test ("text",
+              [this] ()
+              {
+                  juce::ValueTree tree { "root" };
+                  tree.setProperty ("x", 1, nullptr);
+                  tree.setProperty ("y", "b", nullptr);
+                  tree.appendChild (juce::ValueTree { "child" }, nullptr);
+                  expectEquals (toJson (tree),
+                                juce::String (R"({"type":"root","properties":{"x":1,"y":"b"},)"
+                                              R"("children":[{"type":"child"}]})"));
+
+                  const auto indented { toJson (tree, false) };
+                  expect (indented.contains ("\n    \"x\": 1,\n"));
+                  expect (fromJson (indented).isEquivalentTo (tree));
+              });
+
+        test ("value types",
+              [this] ()
+              {
+                  juce::ValueTree tree { "values" };
+                  tree.setProperty ("int", -42, nullptr);
+                  tree.setProperty ("int64", juce::int64 { 1 } << 40, nullptr);
+                  tree.setProperty ("double", 0.1, nullptr);
+                  tree.setProperty ("integral", 3.0, nullptr);
+                  tree.setProperty ("large", 1.5e300, nullptr);
+                  tree.setProperty ("true", true, nullptr);
+                  tree.setProperty ("false", false, nullptr);
+                  tree.setProperty ("void", {}, nullptr);
+                  tree.setProperty ("string",
+                                    juce::String::fromUTF8 ("\"quoted\"\n\t\\ caf\xc3\xa9 \x01"),
+                                    nullptr);
+                  juce::Array<juce::var> array { 1, "two", 3.5 };
+                  array.add (juce::Array<juce::var> { true, juce::var () });
+                  tree.setProperty ("array", array, nullptr);
+                  const char bytes[] { 0, 1, 2, 3, '"', 127 };
+                  tree.setProperty ("binary", juce::MemoryBlock { bytes, sizeof (bytes) }, nullptr);
+                  juce::ValueTree child { "child" };
+                  child.appendChild (juce::ValueTree { "grandchild" }.setProperty ("x", 1, nullptr),
+                                     nullptr);
+                  tree.appendChild (child, nullptr);
+
+                  const auto text { toJson (tree) };
+                  expect (text.contains (R"("integral":3.0)"));
+                  expect (text.contains (R"("double":0.1,)"));
+                  expect (text.contains (R"(\u0001)"));
+
+                  const auto loaded { fromJson (text) };
+                  expect (loaded.isEquivalentTo (tree));
+                  expect (sameValueTypes (tree, loaded));
+              });
+
+        test ("reading",
+              [this] ()
+              {
+                  // keys in any order, whitespace, unknown keys, and escapes
+                  const auto tree { fromJson (R"(
+                      {
+                          "properties": {"name": "\u00e9\ud83c\udfb5\/",
+                                         "big": 12345678901234567890,
+                                         "object": {"a": [1, 2]},
+                                         "int64": -9223372036854775808},
+                          "version": 2,
+                          "children": [],
+                          "type": "root"
+                      })") };
+                  expect (tree.isValid ());
+                  expect (tree.hasType ("root"));
+                  expectEquals (tree["name"].toString (),
+                                juce::String::fromUTF8 ("\xc3\xa9\xf0\x9f\x8e\xb5/"));
+                  expect (tree["big"].isDouble ());
+                  expect (tree["int64"].isInt64 ());
+                  expect (tree["object"].getDynamicObject () != nullptr);
+                  expect (!tree.hasProperty ("version"));
+                  expectEquals (tree.getNumChildren (), 0);
+              });
+
+        test ("read from a stream",
+              [this] ()
+              {
+                  // the reader doesn't keep the text that follows a tree.
+                  const juce::String text { R"({"type": "a"} {"type": "b"}tail)" };
+                  juce::MemoryInputStream in { text.toRawUTF8 (), text.getNumBytesAsUTF8 (),
+                                               false };
+                  expect (cello::JsonFormat::read (in).hasType ("a"));
+                  expectEquals (in.getPosition (), juce::int64 { 13 });
+                  expect (cello::JsonFormat::read (in).hasType ("b"));
+                  expectEquals (in.readEntireStreamAsString (), juce::String { "tail" });
+              });
+
+        test ("malformed",
+              [this] ()
+              {
+                  for (const auto* text :
+                       { "", "{}", R"({"properties": {}})", R"({"type": "a")",
+                         R"({"type": "a", "children": [{"type": "b"})",
+                         R"({"type": "a", "properties": {"x": tru}})",
+                         R"({"type": "a", "properties": {"x": 1,}})", R"({"type": "a" "b"})",
+                         R"({"type": "a", "children": [{}]})", R"({"type": "\x"})" })
+                  {
+                      expect (!fromJson (text).isValid (), text);
+                  }
+              });
+
+        test ("save and load",
+              [this] ()
+              {
+                  cello::Object root { "root", nullptr };
+                  for (int i { 0 }; i < 10000; ++i)
+                  {
+                      cello::Object item { "item", nullptr };
+                      item.setattr ("index", i);
+                      item.setattr ("name", "item " + juce::String (i));
+                      root.append (&item);
+                  }
+                  juce::TemporaryFile tempFile;
+                  const auto file { tempFile.getFile () };
+                  expect (root.save (file, cello::Object::FileFormat::json));
+                  expect (file.loadFileAsString ().startsWith (R"({"type":"root")"));
+                  const auto loaded { cello::Object::load (file, cello::Object::FileFormat::json) };
+                  expectEquals (loaded.getNumChildren (), 10000);
+                  expect (loaded.isEquivalentTo (root));
+              });
+
+#if CELLO_RUN_BENCHMARKS
+        test ("benchmark: json",
+              [this] ()
+              {
+                  juce::ValueTree root { "root" };
+                  for (int i { 0 }; i < 200000; ++i)
+                  {
+                      juce::ValueTree item { "item" };
+                      item.setProperty ("index", i, nullptr);
+                      item.setProperty ("gain", i * 0.001, nullptr);
+                      item.setProperty ("name", "item " + juce::String (i), nullptr);
+                      root.appendChild (item, nullptr);
+                  }
+
+                  auto start { juce::Time::getMillisecondCounterHiRes () };
+                  juce::MemoryOutputStream out;
+                  cello::JsonFormat::write (root, out);
+                  const auto writeTime { juce::Time::getMillisecondCounterHiRes () - start };
+
+                  start = juce::Time::getMillisecondCounterHiRes ();
+                  juce::MemoryInputStream in { out.getData (), out.getDataSize (), false };
+                  const auto loaded { cello::JsonFormat::read (in) };
+                  const auto readTime { juce::Time::getMillisecondCounterHiRes () - start };
+                  expect (loaded.isEquivalentTo (root));
+
+                  start = juce::Time::getMillisecondCounterHiRes ();
+                  const auto xml { root.toXmlString () };
+                  const auto xmlTime { juce::Time::getMillisecondCounterHiRes () - start };
+
+                  logMessage ("200000 children, " + juce::String (out.getDataSize () / 1024) +
+                              " KB: write " + juce::String (writeTime, 1) + " ms, read " +
+                              juce::String (readTime, 1) + " ms (toXmlString " +
+                              juce::String (xmlTime, 1) + " ms)");
+              });
+#endif
+    }
+};
+
+static Test_cello_json testcello_json;
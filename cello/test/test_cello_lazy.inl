@@ -0,0 +1,357 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <juce_core/juce_core.h>
+#include <juce_data_structures/juce_data_structures.h>
+
+#include "../cello_change_feed.h"
+#include "../cello_hash.h"
+#include "../cello_journal.h"
+#include "../cello_lazy.h"
+#include "../cello_object.h"
+#include "../cello_query.h"
+
+namespace
+{
+class Track : public cello::Object
+{
+public:
+    Track (juce::ValueTree tree)
+    : cello::Object ("track", tree)
+    {
+    }
+
+    MAKE_VALUE_MEMBER (juce::String, name, {});
+    MAKE_VALUE_MEMBER (int, index, -1);
+};
+
+juce::ValueTree makeDocument (int numTracks)
+{
+    juce::ValueTree doc { "doc" };
+    doc.setProperty ("title", "lazy document", nullptr);
+    for (int i { 0 }; i < numTracks; ++i)
+    {
+        juce::ValueTree track { "track" };
+        track.setProperty ("name", "track " + juce::String (i), nullptr);
+        track.setProperty ("index", i, nullptr);
+        for (int j { 0 }; j < 10; ++j)
+            track.appendChild (juce::ValueTree { "clip" }.setProperty ("start", j, nullptr),
+                               nullptr);
+        doc.appendChild (track, nullptr);
+    }
+    doc.appendChild (juce::ValueTree { "settings" }.setProperty ("tempo", 120.0, nullptr),
+                     nullptr);
+    return doc;
+}
+
+int countPlaceholders (const juce::ValueTree& tree)
+{
+    int count { 0 };
+    for (int i { 0 }; i < tree.getNumChildren (); ++i)
+        count += cello::LazyTree::isPlaceholder (tree, i) ? 1 : 0;
+    return count;
+}
+} // namespace
+
+class Test_cello_lazy : public TestSuite
+{
+public:
+    Test_cello_lazy ()
+    : TestSuite ("cello_lazy", "cello")
+    {
+    }
+
+    void runTest () override
+    {
+        setup (
+            [this] ()
+            {
+                document = makeDocument (20);
+                expect (cello::Object { "doc", document }.save (tempFile.getFile (),
+                                                               cello::Object::FileFormat::lazy));
+            });
+
+        tearDown ([this] () { tempFile.getFile ().deleteFile (); });
+
+        test ("load placeholders",
+              [this] ()
+              {
+                  auto loaded { cello::LazyTree::load (tempFile.getFile ()) };
+                  expect (loaded.hasType ("doc"));
+                  expect (loaded.getProperty ("title") == document.getProperty ("title"));
+                  expectEquals (loaded.getNumChildren (), document.getNumChildren ());
+                  expectEquals (countPlaceholders (loaded), document.getNumChildren ());
+                  for (int i { 0 }; i < loaded.getNumChildren (); ++i)
+                  {
+                      // types are known before parsing...
+                      expect (loaded.getChild (i).getType () == document.getChild (i).getType ());
+                      // ...but nothing else is, and a placeholder has no properties
+                      // of its own.
+                      expectEquals (loaded.getChild (i).getNumChildren (), 0);
+                      expectEquals (loaded.getChild (i).getNumProperties (), 0);
+                      expect (cello::LazyTree::isPlaceholder (loaded.getChild (i)));
+                      expect (cello::LazyTree::getContents (loaded, i)
+                                  .isEquivalentTo (document.getChild (i)));
+                  }
+                  expectEquals (countPlaceholders (loaded), document.getNumChildren ());
+
+                  // copies have the contents of the placeholders.
+                  expect (cello::LazyTree::withoutPlaceholders (loaded).isEquivalentTo (document));
+                  expectEquals (countPlaceholders (loaded), document.getNumChildren ());
+
+                  expect (cello::LazyTree::containsPlaceholders (loaded));
+                  cello::LazyTree::materializeAll (loaded);
+                  expect (!cello::LazyTree::containsPlaceholders (loaded));
+                  expect (loaded.isEquivalentTo (document));
+              });
+
+        test ("materialize on access",
+              [this] ()
+              {
+                  cello::Object doc { "doc", cello::Object::load (
+                                                 tempFile.getFile (),
+                                                 cello::Object::FileFormat::lazy) };
+                  expect (doc.getCreationType () == cello::Object::CreationType::wrapped);
+                  const auto total { doc.getNumChildren () };
+
+                  // operator[] parses the child it returns...
+                  expect (doc[1]["name"] == "track 1");
+                  expect (!cello::LazyTree::isPlaceholder (doc[1]));
+                  expectEquals (countPlaceholders (doc), total - 1);
+                  // ...as does creating an Object that wraps a child.
+                  juce::ValueTree docTree { doc };
+                  Track track3 { docTree.getChild (3) };
+                  expect (track3.getCreationType () == cello::Object::CreationType::wrapped);
+                  expectEquals (static_cast<int> (track3.index), 3);
+                  expectEquals (track3.getNumChildren (), 10);
+                  expectEquals (countPlaceholders (doc), total - 2);
+
+                  // wrapping a child by type (using a Path)
+                  cello::Object settings { "settings", doc };
+                  expect (settings.getCreationType () == cello::Object::CreationType::wrapped);
+                  expectEquals (settings.getattr ("tempo", 0.0), 120.0);
+                  expectEquals (countPlaceholders (doc), total - 3);
+
+                  // queries look at every child, but don't change the tree.
+                  cello::Query query { [] (juce::ValueTree tree)
+                                       { return static_cast<int> (tree["index"]) >= 15; } };
+                  expectEquals (doc.find (query, false).getNumChildren (), 5);
+                  expectEquals (countPlaceholders (doc), total - 3);
+
+                  // ...neither does exporting columns.
+                  cello::Column<int> indices { "index", -1 };
+                  doc.exportColumns (indices);
+                  expectEquals (indices[7], 7);
+                  expectEquals (countPlaceholders (doc), total - 3);
+
+                  // upsert() has to look at every child.
+                  cello::Object replacement { "track", nullptr };
+                  replacement.setattr ("index", 7);
+                  replacement.setattr ("name", juce::String { "replaced" });
+                  expect (doc.upsert (&replacement, "index"));
+                  expectEquals (countPlaceholders (doc), 0);
+                  expect (doc[7].getProperty ("name") == "replaced");
+                  expect (juce::ValueTree { doc }.getChild (8).isEquivalentTo (
+                      document.getChild (8)));
+              });
+
+        test ("materializing isn't an edit",
+              [this] ()
+              {
+                  cello::Object doc { "doc", cello::Object::load (
+                                                 tempFile.getFile (),
+                                                 cello::Object::FileFormat::lazy) };
+                  cello::HashTracker hashes { doc };
+                  cello::ChangeFeed feed { doc };
+                  const auto generation { doc.getGeneration () };
+                  int childrenAdded { 0 };
+                  doc.onChildAdded = [&childrenAdded] (juce::ValueTree&, int, int)
+                  { ++childrenAdded; };
+
+                  // placeholders are hashed by their contents.
+                  expect (hashes.getHash () == cello::HashNode { document }.hash);
+
+                  Track track { doc[2] };
+                  cello::LazyTree::materializeAll (doc);
+                  expectEquals (countPlaceholders (doc), 0);
+                  expect (!hashes.isDirty ());
+                  expectEquals (feed.getNumReady (), 0);
+                  expect (doc.getGeneration () == generation);
+                  expectEquals (childrenAdded, 0);
+
+                  // edits inside a materialized child are seen as usual.
+                  track.name = "changed";
+                  expect (hashes.isDirty ());
+                  expectEquals (feed.getNumReady (), 1);
+              });
+
+        test ("remove placeholders",
+              [this] ()
+              {
+                  juce::UndoManager undo;
+                  cello::Object doc { "doc", cello::Object::load (
+                                                 tempFile.getFile (),
+                                                 cello::Object::FileFormat::lazy) };
+                  doc.setUndoManager (&undo);
+                  const auto total { doc.getNumChildren () };
+
+                  // a removed placeholder keeps its data...
+                  undo.beginNewTransaction ();
+                  const auto removed { doc.remove (4) };
+                  expect (removed.isEquivalentTo (document.getChild (4)));
+                  expectEquals (countPlaceholders (doc), total - 1);
+
+                  // ...so undoing the removal puts the data back.
+                  expect (undo.undo ());
+                  expectEquals (doc.getNumChildren (), total);
+                  expect (juce::ValueTree { doc }.getChild (4).isEquivalentTo (
+                      document.getChild (4)));
+
+                  // as does moving a placeholder to another tree.
+                  juce::ValueTree other { "other" };
+                  auto moved { juce::ValueTree { doc }.getChild (6) };
+                  juce::ValueTree { doc }.removeChild (moved, nullptr);
+                  other.appendChild (moved, nullptr);
+                  expect (other.getChild (0).isEquivalentTo (document.getChild (6)));
+
+                  // the other placeholders are where they were.
+                  cello::LazyTree::materializeAll (doc);
+                  expect (juce::ValueTree { doc }.getChild (6).isEquivalentTo (
+                      document.getChild (7)));
+              });
+
+        test ("save partially loaded",
+              [this] ()
+              {
+                  auto loaded { cello::Object::load (tempFile.getFile (),
+                                                     cello::Object::FileFormat::lazy) };
+                  cello::Object doc { "doc", loaded };
+                  Track track { doc[0] };
+                  track.name = "changed";
+
+                  // unchanged placeholders are copied across without parsing them.
+                  juce::TemporaryFile lazyCopy;
+                  expect (doc.save (lazyCopy.getFile (), cello::Object::FileFormat::lazy));
+                  expectEquals (countPlaceholders (loaded), loaded.getNumChildren () - 1);
+                  auto reloaded { cello::LazyTree::load (lazyCopy.getFile ()) };
+                  cello::LazyTree::materializeAll (reloaded);
+                  expect (reloaded.getChild (0).getProperty ("name") == "changed");
+                  expect (reloaded.getChild (1).isEquivalentTo (document.getChild (1)));
+
+                  // other formats save the data of the placeholders.
+                  juce::TemporaryFile xmlCopy;
+                  expect (doc.save (xmlCopy.getFile (), cello::Object::FileFormat::xml));
+                  expectEquals (countPlaceholders (loaded), loaded.getNumChildren () - 1);
+                  expect (cello::Object::load (xmlCopy.getFile ()).isEquivalentTo (reloaded));
+
+                  lazyCopy.getFile ().deleteFile ();
+                  xmlCopy.getFile ().deleteFile ();
+              });
+
+        test ("save asynchronously",
+              [this] ()
+              {
+                  auto loaded { cello::Object::load (tempFile.getFile (),
+                                                     cello::Object::FileFormat::lazy) };
+                  cello::Object doc { "doc", loaded };
+                  Track track { doc[0] };
+                  track.name = "changed";
+                  auto expected { document.createCopy () };
+                  expected.getChild (0).setProperty ("name", "changed", nullptr);
+
+                  // the background thread writes from the snapshot, without
+                  // touching the placeholders of the document we're still using.
+                  for (auto format :
+                       { cello::Object::FileFormat::lazy, cello::Object::FileFormat::journaled })
+                  {
+                      juce::TemporaryFile copy;
+                      juce::WaitableEvent done;
+                      auto result { juce::Result::fail ("not called") };
+                      doc.saveAsync (copy.getFile (), format,
+                                     [&] (juce::Result r)
+                                     {
+                                         result = r;
+                                         done.signal ();
+                                     });
+                      expect (done.wait (5000));
+                      expect (result.wasOk ());
+                      auto reloaded { cello::Object::load (copy.getFile (), format) };
+                      cello::LazyTree::materializeAll (reloaded);
+                      expect (reloaded.isEquivalentTo (expected));
+                      copy.getFile ().deleteFile ();
+                      cello::Journal::getJournalFile (copy.getFile ()).deleteFile ();
+                  }
+                  expectEquals (countPlaceholders (loaded), loaded.getNumChildren () - 1);
+              });
+
+        test ("import columns",
+              [this] ()
+              {
+                  auto loaded { cello::Object::load (tempFile.getFile (),
+                                                     cello::Object::FileFormat::lazy) };
+                  cello::Object doc { "doc", loaded };
+                  const auto total { loaded.getNumChildren () };
+                  cello::Column<int> indices { "index", -1 };
+                  doc.exportColumns (indices);
+                  expectEquals (countPlaceholders (loaded), total);
+
+                  // only the children whose values change are loaded.
+                  indices[3] = 30;
+                  indices[5] = -1;
+                  expectEquals (doc.importColumns (indices), 2);
+                  expectEquals (countPlaceholders (loaded), total - 2);
+                  expect (doc[3].getProperty ("index") == juce::var { 30 });
+                  expect (doc[3].getProperty ("name") == "track 3");
+                  expectEquals (doc[3].getNumChildren (), 10);
+
+                  juce::TemporaryFile copy;
+                  expect (doc.save (copy.getFile (), cello::Object::FileFormat::lazy));
+                  auto reloaded { cello::LazyTree::load (copy.getFile ()) };
+                  cello::LazyTree::materializeAll (reloaded);
+                  auto expected { document.createCopy () };
+                  expected.getChild (3).setProperty ("index", 30, nullptr);
+                  expected.getChild (5).setProperty ("index", -1, nullptr);
+                  expect (reloaded.isEquivalentTo (expected));
+                  copy.getFile ().deleteFile ();
+              });
+
+        test ("invalid files",
+              [this] ()
+              {
+                  const auto file { tempFile.getFile () };
+                  expect (file.replaceWithText ("<doc/>"));
+                  expect (!cello::LazyTree::load (file).isValid ());
+
+                  // a truncated file has lost its offset table.
+                  expect (cello::Object { "doc", document }.save (
+                      file, cello::Object::FileFormat::lazy));
+                  juce::MemoryBlock contents;
+                  expect (file.loadFileAsData (contents));
+                  contents.setSize (contents.getSize () - 20);
+                  expect (file.replaceWithData (contents.getData (), contents.getSize ()));
+                  expect (!cello::LazyTree::load (file).isValid ());
+              });
+    }
+
+private:
+    juce::TemporaryFile tempFile;
+    juce::ValueTree document;
+};
+
+static Test_cello_lazy testcello_lazy;
@@ -60,6 +60,24 @@ private:
     cello::Value<int> val { *this, valId, 0 };
 };
 
+struct TaggedPoint : public cello::Object
+{
+    static constexpr auto typeId { CELLO_ID ("TaggedPoint") };
+
+    TaggedPoint (juce::ValueTree tree)
+    : cello::Object (typeId, tree)
+    {
+    }
+
+    TaggedPoint (const cello::Object& parent)
+    : cello::Object (typeId, parent)
+    {
+    }
+
+    MAKE_VALUE_MEMBER (int, x, 0);
+    MAKE_VALUE_MEMBER (int, y, 0);
+};
+
 struct Vec2 : public cello::Object
 {
     Vec2 (const juce::String& id, float x_, float y_)
@@ -390,6 +408,53 @@ public:
                   expectWithinAbsoluteError<float> (pt2.y, -33.2f, 0.001f);
               });
 
+        test ("reconciling op=",
+              [&] ()
+              {
+                  const auto makeList = [] (int count)
+                  {
+                      cello::Object list { "list", nullptr };
+                      for (int i { 0 }; i < count; ++i)
+                      {
+                          Vec2 pt { "point", (float) i, (float) i * 2 };
+                          list.append (&pt);
+                      }
+                      return list;
+                  };
+
+                  juce::UndoManager undo;
+                  auto list { makeList (10) };
+                  list.setUndoManager (&undo);
+                  auto changed { makeList (10) };
+                  Vec2 { "point", changed[5] }.y = -1.f;
+
+                  // replacing rewrites every property and child...
+                  undo.beginNewTransaction ();
+                  list = changed;
+                  expect (juce::ValueTree { list }.isEquivalentTo (changed));
+                  expectGreaterThan (undo.getNumActionsInCurrentTransaction (), 10);
+                  expect (list.undo ());
+
+                  // ...but reconciling only changes what's different.
+                  int count { 0 };
+                  Vec2 fifth { "point", list[5] };
+                  fifth.onPropertyChange ("point",
+                                          [&count] (juce::Identifier) { ++count; });
+                  list.setAssignMode (cello::Object::AssignMode::reconcile);
+                  undo.beginNewTransaction ();
+                  list = changed;
+                  expect (juce::ValueTree { list }.isEquivalentTo (changed));
+                  expectEquals (undo.getNumActionsInCurrentTransaction (), 1);
+                  expectEquals (count, 1);
+                  // the child was patched in place, not replaced.
+                  expect (fifth == list[5]);
+                  expectWithinAbsoluteError<float> (fifth.y, -1.f, 0.001f);
+
+                  // the mode is kept by copies.
+                  cello::Object copy { list };
+                  expect (copy.getAssignMode () == cello::Object::AssignMode::reconcile);
+              });
+
         test ("set property lambda",
               [&] ()
               {
@@ -537,6 +602,191 @@ public:
                   }
               });
 
+        test ("overwrite existing file",
+              [&] ()
+              {
+                  for (auto format : { cello::Object::FileFormat::binary,
+                                       cello::Object::FileFormat::zipped })
+                  {
+                      juce::TemporaryFile tempFile;
+                      const auto file { tempFile.getFile () };
+
+                      cello::Object large ("root", nullptr);
+                      for (int i { 0 }; i < 50; ++i)
+                          Vec2 { "pt" + juce::String (i), large };
+                      expect (large.save (file, format));
+
+                      // a smaller tree must replace the file, not be written over it.
+                      cello::Object small ("root", nullptr);
+                      Vec2 pt { "pt", small };
+                      expect (small.save (file, format));
+                      const auto loaded { cello::Object::load (file, format) };
+                      expect (loaded.isEquivalentTo (small));
+                      expect (file.deleteFile ());
+                  }
+              });
+
+#if CELLO_RUN_BENCHMARKS
+        test ("benchmark: load binary",
+              [&] ()
+              {
+                  // compare parsing from a memory-mapped file against the
+                  // previous approach of reading the whole file onto the heap.
+                  for (size_t megabytes : { 10, 100, 1000 })
+                  {
+                      juce::TemporaryFile tempFile;
+                      const auto file { tempFile.getFile () };
+                      {
+                          cello::Object root ("root", nullptr);
+                          juce::MemoryBlock block { 1024 * 1024, true };
+                          for (size_t i { 0 }; i < megabytes; ++i)
+                          {
+                              cello::Object chunk ("chunk", nullptr);
+                              chunk.setattr ("data", block);
+                              root.append (&chunk);
+                          }
+                          expect (root.save (file, cello::Object::FileFormat::binary));
+                      }
+
+                      const auto loadCopied = [&file] ()
+                      {
+                          juce::MemoryBlock mb;
+                          file.loadFileAsData (mb);
+                          return juce::ValueTree::readFromData (mb.getData (), mb.getSize ());
+                      };
+                      const auto loadMapped = [&file] ()
+                      { return cello::Object::load (file, cello::Object::FileFormat::binary); };
+                      // the loaded tree is released after the time is taken, so each
+                      // run starts with the same amount of memory in use.
+                      const auto timeLoad = [] (const auto& load, double& best)
+                      {
+                          const auto start { juce::Time::getMillisecondCounterHiRes () };
+                          const auto tree { load () };
+                          best = std::min (best, juce::Time::getMillisecondCounterHiRes () - start);
+                          return tree.getNumChildren ();
+                      };
+
+                      // load once each way first so that neither pays for reading the
+                      // file into the cache, then alternate which goes first and keep
+                      // the best time of each.
+                      double copyTime { std::numeric_limits<double>::max () };
+                      double mapTime { std::numeric_limits<double>::max () };
+                      double warmup { 0 };
+                      timeLoad (loadCopied, warmup);
+                      timeLoad (loadMapped, warmup);
+                      for (int run { 0 }; run < 4; ++run)
+                      {
+                          if (run % 2 == 0)
+                          {
+                              timeLoad (loadCopied, copyTime);
+                              timeLoad (loadMapped, mapTime);
+                          }
+                          else
+                          {
+                              timeLoad (loadMapped, mapTime);
+                              timeLoad (loadCopied, copyTime);
+                          }
+                      }
+
+                      const auto mapped { loadMapped () };
+                      expectEquals (mapped.getNumChildren (), static_cast<int> (megabytes));
+                      expect (mapped.isEquivalentTo (loadCopied ()));
+                      logMessage (juce::String (megabytes) + " MB, best of 4: loadFileAsData " +
+                                  juce::String (copyTime, 1) + " ms, memory-mapped " +
+                                  juce::String (mapTime, 1) + " ms");
+                      file.deleteFile ();
+                  }
+              });
+#endif
+
+        test ("async save",
+              [&] ()
+              {
+                  for (auto format : { cello::Object::FileFormat::xml,
+                                       cello::Object::FileFormat::binary,
+                                       cello::Object::FileFormat::zipped,
+                                       cello::Object::FileFormat::journaled })
+                  {
+                      cello::Object root ("root", nullptr);
+                      for (int i { 0 }; i < 100; ++i)
+                      {
+                          Vec2 pt { "pt" + juce::String (i), root };
+                          pt.x = static_cast<float> (i);
+                      }
+                      const auto expected { juce::ValueTree (root).createCopy () };
+
+                      juce::TemporaryFile tempFile;
+                      const auto file { tempFile.getFile () };
+                      juce::WaitableEvent done;
+                      auto result { juce::Result::fail ("not called") };
+                      root.saveAsync (file, format,
+                                      [&] (juce::Result r)
+                                      {
+                                          result = r;
+                                          done.signal ();
+                                      });
+                      // changes made after the call aren't part of the save.
+                      root.setattr ("changed", true);
+                      Vec2 { "late", root };
+
+                      expect (done.wait (5000));
+                      expect (result.wasOk ());
+                      expect (cello::Object::load (file, format).isEquivalentTo (expected));
+                      file.deleteFile ();
+                      cello::Journal::getJournalFile (file).deleteFile ();
+                  }
+              });
+
+        test ("safe save",
+              [&] ()
+              {
+                  for (auto format : { cello::Object::FileFormat::xml,
+                                       cello::Object::FileFormat::binary,
+                                       cello::Object::FileFormat::compact,
+                                       cello::Object::FileFormat::lz })
+                  {
+                      cello::Object root ("root", nullptr);
+                      root.setSaveMode (cello::Object::SaveMode::safe);
+                      root.setattr ("version", 1);
+                      juce::TemporaryFile tempFile;
+                      const auto file { tempFile.getFile () };
+                      const auto backup { cello::Object::getBackupFile (file) };
+                      expect (root.save (file, format));
+                      expect (!backup.existsAsFile ());
+                      const auto first { juce::ValueTree (root).createCopy () };
+
+                      root.setattr ("version", 2);
+                      expect (root.save (file, format));
+                      expect (backup.existsAsFile ());
+                      expect (cello::Object::load (file, format).isEquivalentTo (root));
+
+                      // a corrupted file is detected, and we load the backup instead.
+                      juce::MemoryBlock mb;
+                      expect (file.loadFileAsData (mb));
+                      mb[2] ^= 0x20;
+                      expect (file.replaceWithData (mb.getData (), mb.getSize ()));
+                      expect (cello::Object::load (file, format).isEquivalentTo (first));
+
+                      // ...as is one that lost its end (including the checksum).
+                      mb[2] ^= 0x20;
+                      expect (file.replaceWithData (mb.getData (), mb.getSize () / 2));
+                      expect (cello::Object::load (file, format).isEquivalentTo (first));
+
+                      // ...and we also load the backup if the file is missing.
+                      file.deleteFile ();
+                      expect (cello::Object::load (file, format).isEquivalentTo (first));
+
+                      // a standard save removes the backup, whose checksum it doesn't have.
+                      root.setSaveMode (cello::Object::SaveMode::standard);
+                      root.setattr ("version", 3);
+                      expect (root.save (file, format));
+                      expect (!backup.existsAsFile ());
+                      expect (cello::Object::load (file, format).isEquivalentTo (root));
+                      file.deleteFile ();
+                      expect (!cello::Object::load (file, format).isValid ());
+                  }
+              });
+
         test ("set/get attr",
               [&] ()
               {
@@ -558,6 +808,180 @@ public:
                   expectEquals (root.getattr<int> ("nonexistent", {}), 0);
               });
 
+        test ("bulk set/get attrs",
+              [&] ()
+              {
+                  cello::Object root ("root", nullptr);
+                  juce::UndoManager undo;
+                  root.setUndoManager (&undo);
+                  root.setattr ("x", 1.f);
+
+                  int xChanges { 0 };
+                  int otherChanges { 0 };
+                  root.onPropertyChange ("x", [&xChanges] (juce::Identifier) { ++xChanges; });
+                  root.onPropertyChange (root.getType (), [&otherChanges] (juce::Identifier)
+                                         { ++otherChanges; });
+
+                  const auto before { root.getGeneration () };
+                  // setattrs() leaves transactions to the caller.
+                  undo.beginNewTransaction ();
+                  root.setattrs ({ { "x", 2.f },
+                                   { "y", 3.f },
+                                   { "name", "origin" },
+                                   { "count", 4 } });
+                  expectEquals (xChanges, 1);
+                  // one catch-all callback for the three properties without their own.
+                  expectEquals (otherChanges, 1);
+                  expect (root.getGeneration () > before);
+
+                  const auto [x, y, name, count] =
+                      root.getattrs<float, float, juce::String, int> ("x", "y", "name", "count");
+                  expectEquals (x, 2.f);
+                  expectEquals (y, 3.f);
+                  expectEquals (name, juce::String ("origin"));
+                  expectEquals (count, 4);
+
+                  // fill a struct's members.
+                  struct
+                  {
+                      float x;
+                      int missing;
+                  } fields {};
+                  std::tie (fields.x, fields.missing) =
+                      root.getattrs<float, int> (CELLO_ID ("x"), CELLO_ID ("missing"));
+                  expectEquals (fields.x, 2.f);
+                  expectEquals (fields.missing, 0);
+
+                  // unchanged values are skipped.
+                  root.setattrs ({ { "x", 2.f }, { "count", 4 } });
+                  expectEquals (xChanges, 1);
+                  expectEquals (otherChanges, 1);
+
+                  // all the changes are undone together.
+                  expect (root.undo ());
+                  expect (!root.hasattr ("y"));
+                  expect (!root.hasattr ("name"));
+                  expectEquals (root.getattr<float> ("x", 0.f), 1.f);
+
+                  // the excluded listener isn't notified.
+                  struct Counter : juce::ValueTree::Listener
+                  {
+                      void valueTreePropertyChanged (juce::ValueTree&,
+                                                     const juce::Identifier&) override
+                      {
+                          ++count;
+                      }
+                      int count { 0 };
+                  };
+                  Counter excluded;
+                  Counter other;
+                  juce::ValueTree tree { root };
+                  tree.addListener (&excluded);
+                  tree.addListener (&other);
+                  root.excludeListener (&excluded);
+                  root.setattrs ({ { "x", 5.f }, { "y", 6.f } });
+                  expectEquals (excluded.count, 0);
+                  expectEquals (other.count, 2);
+                  expectEquals (xChanges, 2);
+                  expectEquals (otherChanges, 2);
+
+                  // ...and if that's the Object itself, its callbacks aren't called.
+                  root.excludeListener (&root);
+                  root.setattrs ({ { "x", 7.f } });
+                  expectEquals (other.count, 3);
+                  expectEquals (xChanges, 2);
+                  root.excludeListener (nullptr);
+                  tree.removeListener (&excluded);
+                  tree.removeListener (&other);
+              });
+
+        test ("columns",
+              [&] ()
+              {
+                  cello::Object voices ("voices", nullptr);
+                  for (int i { 0 }; i < 4; ++i)
+                  {
+                      cello::Object voice ("voice", nullptr);
+                      voice.setattr ("note", 60 + i);
+                      if (i != 2)
+                          voice.setattr ("gain", 0.5f);
+                      voices.append (&voice);
+                  }
+
+                  cello::Column<float> gains { "gain", 1.f };
+                  cello::Column<int> notes { "note" };
+                  voices.exportColumns (gains, notes);
+                  expectEquals (static_cast<int> (gains.size ()), 4);
+                  expectEquals (static_cast<int> (notes.size ()), 4);
+                  expectEquals (gains[0], 0.5f);
+                  // a missing property gets the column's default.
+                  expectEquals (gains[2], 1.f);
+                  expectEquals (notes[3], 63);
+
+                  // values that read() got from the default aren't written back.
+                  expectEquals (voices.importColumns (gains, notes), 0);
+                  expect (!voices[2].hasProperty ("gain"));
+
+                  juce::UndoManager undo;
+                  voices.setUndoManager (&undo);
+                  for (auto& gain : gains)
+                      gain = std::min (gain, 0.75f);
+                  notes[1] += 12;
+                  // the missing gain is added, and one note changed.
+                  expectEquals (voices.importColumns (gains, notes), 2);
+                  expectEquals (static_cast<float> (voices[2].getProperty ("gain")), 0.75f);
+                  expectEquals (static_cast<int> (voices[1].getProperty ("note")), 73);
+                  expectEquals (voices.importColumns (gains, notes), 0);
+
+                  expect (voices.undo ());
+                  expect (!voices[2].hasProperty ("gain"));
+                  expectEquals (static_cast<int> (voices[1].getProperty ("note")), 61);
+
+                  // bools are stored as bytes, so the column is still an array.
+                  cello::Column<bool> muted { "muted" };
+                  voices.exportColumns (muted);
+                  static_assert (std::is_same_v<decltype (muted.data ()), juce::uint8*>);
+                  expectEquals (static_cast<int> (muted[0]), 0);
+                  muted[3] = 1;
+                  expectEquals (voices.importColumns (muted), 1);
+                  expect (static_cast<bool> (voices[3].getProperty ("muted")));
+                  expect (!voices[0].hasProperty ("muted"));
+              });
+
+#if CELLO_RUN_BENCHMARKS
+        test ("benchmark: columns",
+              [&] ()
+              {
+                  constexpr int count { 10000 };
+                  cello::Object voices ("voices", nullptr);
+                  for (int i { 0 }; i < count; ++i)
+                  {
+                      cello::Object voice ("voice", nullptr);
+                      voice.setattr ("gain", static_cast<float> (i % 100) / 100.f);
+                      voices.append (&voice);
+                  }
+
+                  auto start { juce::Time::getMillisecondCounterHiRes () };
+                  double childSum { 0 };
+                  for (int i { 0 }; i < count; ++i)
+                      childSum += cello::Object ("voice", voices[i]).getattr ("gain", 0.f);
+                  const auto childTime { juce::Time::getMillisecondCounterHiRes () - start };
+
+                  start = juce::Time::getMillisecondCounterHiRes ();
+                  cello::Column<float> gains { "gain" };
+                  voices.exportColumns (gains);
+                  double columnSum { 0 };
+                  for (auto gain : gains)
+                      columnSum += gain;
+                  const auto columnTime { juce::Time::getMillisecondCounterHiRes () - start };
+
+                  expectEquals (columnSum, childSum);
+                  logMessage (juce::String (count) + " children: sum through Objects " +
+                              juce::String (childTime, 2) + " ms, export column " +
+                              juce::String (columnTime, 2) + " ms");
+              });
+#endif
+
         test ("parentage change",
               [&] ()
               {
@@ -581,6 +1005,45 @@ public:
                           cello::Object::CreationType::wrapped);
               });
 
+        test ("static identifiers",
+              [this] ()
+              {
+                  // the same tag always yields the same interned Identifier.
+                  const auto id { CELLO_ID ("staticId") };
+                  expect (&id.get () == &decltype (id)::get ());
+                  expect (id.get () == juce::Identifier ("staticId"));
+                  expectEquals (id.toString (), juce::String ("staticId"));
+
+                  // create a new tree
+                  TaggedPoint created { juce::ValueTree {} };
+                  expect (created.getCreationType () ==
+                          cello::Object::CreationType::initialized);
+                  expect (created.getType () == juce::Identifier ("TaggedPoint"));
+                  created.x = 3;
+                  created.y = 4;
+                  expect (created.hasattr ("x"));
+
+                  // wrap an existing tree of the same type
+                  TaggedPoint wrapped { static_cast<juce::ValueTree> (created) };
+                  expect (wrapped.getCreationType () ==
+                          cello::Object::CreationType::wrapped);
+                  expectEquals (static_cast<int> (wrapped.x), 3);
+
+                  // find (then create) a child of a parent object
+                  cello::Object parent { "parent", nullptr };
+                  parent.append (&created);
+                  TaggedPoint found { parent };
+                  expect (found.getCreationType () ==
+                          cello::Object::CreationType::wrapped);
+                  expectEquals (static_cast<int> (found.y), 4);
+
+                  cello::Object empty { "empty", nullptr };
+                  TaggedPoint child { empty };
+                  expect (child.getCreationType () ==
+                          cello::Object::CreationType::initialized);
+                  expectEquals (empty.getNumChildren (), 1);
+              });
+
         test ("sort children",
               [&] ()
               {
@@ -21,6 +21,21 @@
 #include <juce_core/juce_core.h>
 
 #include "../cello_object.h"
+#include "../cello_reflect.h"
+
+namespace
+{
+/**
+ * @brief An int whose VariantConverter counts how often it's read from the
+ * tree.
+ */
+struct CountedInt
+{
+    int value;
+
+    bool operator!= (const CountedInt& rhs) const { return value != rhs.value; }
+};
+} // namespace
 
 namespace juce
 {
@@ -49,6 +64,19 @@ template <> struct VariantConverter<std::complex<float>>
     }
 };
 
+template <> struct VariantConverter<CountedInt>
+{
+    static inline int reads { 0 };
+
+    static CountedInt fromVar (const var& v)
+    {
+        ++reads;
+        return { static_cast<int> (v) };
+    }
+
+    static var toVar (const CountedInt& val) { return val.value; }
+};
+
 } // namespace juce
 
 namespace
@@ -78,6 +106,78 @@ public:
     MAKE_VALUE_MEMBER (std::complex<float>, complexVal, {});
 };
 
+struct GainLimits
+{
+    static constexpr float minimum { -96.f };
+    static constexpr float maximum { 6.f };
+};
+
+class ObjectWithPolicies : public cello::Object
+{
+public:
+    ObjectWithPolicies ()
+    : cello::Object ("policies", nullptr)
+    {
+    }
+
+    cello::Value<float, cello::Clamp<0, 1>> level { *this, CELLO_ID ("level"), 2.f };
+    cello::Value<int, cello::Clamp<-10, 10>> offset { *this, CELLO_ID ("offset"), 0 };
+    cello::Value<float, cello::Range<GainLimits>> gain { *this, CELLO_ID ("gain"), 0.f };
+    MAKE_VALUE_MEMBER (float, unchecked, {});
+};
+
+class ObjectWithArrays : public cello::Object
+{
+public:
+    ObjectWithArrays ()
+    : cello::Object ("arrays", nullptr)
+    {
+    }
+
+    ObjectWithArrays (juce::ValueTree tree)
+    : cello::Object ("arrays", tree)
+    {
+    }
+
+    MAKE_VALUE_MEMBER (std::vector<float>, curve, {});
+    MAKE_VALUE_MEMBER (std::vector<juce::int16>, samples, {});
+};
+
+struct VoiceData
+{
+    float gain;
+    float pan;
+    int note;
+};
+
+class ReflectedVoice : public cello::Object
+{
+public:
+    ReflectedVoice ()
+    : cello::Object ("voice", nullptr)
+    {
+    }
+
+    MAKE_VALUE_MEMBER (float, gain, 1.f);
+    MAKE_VALUE_MEMBER (float, pan, 0.f);
+    MAKE_VALUE_MEMBER (int, note, 60);
+};
+
+class ObjectWithCountedValue : public cello::Object
+{
+public:
+    ObjectWithCountedValue ()
+    : cello::Object ("countedObject", nullptr)
+    {
+    }
+
+    MAKE_VALUE_MEMBER (CountedInt, counted, {});
+};
+
+const auto voiceFields { cello::reflect<VoiceData> (
+    CELLO_FIELD (ReflectedVoice, VoiceData, gain), CELLO_FIELD (ReflectedVoice, VoiceData, pan),
+    CELLO_FIELD (ReflectedVoice, VoiceData, note)) };
+
 } // namespace
 
 class Test_cello_value : public TestSuite
@@ -129,6 +229,255 @@ public:
                   expect (o.intVal == 3);
               });
 
+        test ("update",
+              [&] ()
+              {
+                  ObjectWithOperators o;
+                  o.intVal = 10;
+                  int changeCount { 0 };
+                  o.intVal.onPropertyChange ([&changeCount] (juce::Identifier)
+                                             { ++changeCount; });
+
+                  // returns the previous value
+                  expectEquals (o.intVal.update ([] (const int& v) { return v * 3; }), 10);
+                  expectEquals (static_cast<int> (o.intVal), 30);
+                  expectEquals (changeCount, 1);
+
+                  // goes through validation in both directions
+                  o.intVal.onGet = [] (const int& v) { return v + 1; };
+                  o.intVal.onSet = [] (const int& v) { return juce::jmin (v, 100); };
+                  expectEquals (o.intVal.update ([] (const int& v) { return v * 10; }), 31);
+                  expectEquals (static_cast<int> (juce::ValueTree (o)["intVal"]), 100);
+                  o.intVal.onGet = nullptr;
+
+                  // no change, no notification...
+                  o.intVal += 50;
+                  expectEquals (static_cast<int> (o.intVal), 100);
+                  expectEquals (changeCount, 2);
+                  // ...unless we're forcing updates
+                  {
+                      cello::ScopedForceUpdater forcer { o.intVal };
+                      o.intVal.update ([] (const int& v) { return v; });
+                  }
+                  expectEquals (changeCount, 3);
+
+                  // a property that doesn't exist yet reads as a default value.
+                  juce::ValueTree (o).removeProperty ("floatVal", nullptr);
+                  expectEquals (o.floatVal++, 0.f);
+                  expectEquals (static_cast<float> (o.floatVal), 1.f);
+              });
+
+#if CELLO_RUN_BENCHMARKS
+        test ("benchmark: increment",
+              [&] ()
+              {
+                  ObjectWithOperators o;
+                  constexpr int count { 1000000 };
+                  auto start { juce::Time::getMillisecondCounterHiRes () };
+                  for (int i { 0 }; i < count; ++i)
+                      o.intVal.set (static_cast<int> (o.intVal) + 1);
+                  const auto setTime { juce::Time::getMillisecondCounterHiRes () - start };
+
+                  start = juce::Time::getMillisecondCounterHiRes ();
+                  for (int i { 0 }; i < count; ++i)
+                      ++o.intVal;
+                  const auto updateTime { juce::Time::getMillisecondCounterHiRes () - start };
+
+                  expectEquals (static_cast<int> (o.intVal), 2 * count);
+                  logMessage (juce::String (count) + " increments: get/set " +
+                              juce::String (setTime, 1) + " ms, update " +
+                              juce::String (updateTime, 1) + " ms");
+              });
+#endif
+
+        test ("validator policies",
+              [&] ()
+              {
+                  ObjectWithPolicies o;
+                  // the initial value is validated too.
+                  expectEquals (static_cast<float> (o.level), 1.f);
+                  o.level = -0.5f;
+                  expectEquals (static_cast<float> (o.level), 0.f);
+                  o.level = 0.25f;
+                  expectEquals (static_cast<float> (o.level), 0.25f);
+
+                  o.offset = 20;
+                  expectEquals (static_cast<int> (o.offset), 10);
+                  o.offset -= 25;
+                  expectEquals (static_cast<int> (o.offset), -10);
+                  expectEquals (static_cast<int> (--o.offset), -10);
+
+                  o.gain = 12.f;
+                  expectEquals (static_cast<float> (o.gain), 6.f);
+                  o.gain = -120.f;
+                  expectEquals (static_cast<float> (o.gain), -96.f);
+
+                  // reads are limited even if the tree is changed directly.
+                  juce::ValueTree (o).setProperty ("level", 5.f, nullptr);
+                  expectEquals (static_cast<float> (o.level), 1.f);
+
+                  // a runtime validator runs first, then the policy.
+                  o.gain.onSet = [] (const float& val) { return val * 2.f; };
+                  o.gain       = 2.f;
+                  expectEquals (static_cast<float> (o.gain), 4.f);
+                  o.gain = 5.f;
+                  expectEquals (static_cast<float> (o.gain), 6.f);
+              });
+
+#if CELLO_RUN_BENCHMARKS
+        test ("benchmark: validators",
+              [&] ()
+              {
+                  ObjectWithPolicies o;
+                  o.unchecked.onSet = [] (const float& val)
+                  { return juce::jlimit (0.f, 1.f, val); };
+                  constexpr int count { 1000000 };
+
+                  auto start { juce::Time::getMillisecondCounterHiRes () };
+                  for (int i { 0 }; i < count; ++i)
+                      o.unchecked = static_cast<float> (i % 3) * 0.5f;
+                  const auto functionTime { juce::Time::getMillisecondCounterHiRes () -
+                                            start };
+
+                  start = juce::Time::getMillisecondCounterHiRes ();
+                  for (int i { 0 }; i < count; ++i)
+                      o.level = static_cast<float> (i % 3) * 0.5f;
+                  const auto policyTime { juce::Time::getMillisecondCounterHiRes () - start };
+
+                  expectEquals (static_cast<float> (o.level),
+                                static_cast<float> (o.unchecked));
+                  logMessage (juce::String (count) + " validated sets: std::function " +
+                              juce::String (functionTime, 1) + " ms, policy " +
+                              juce::String (policyTime, 1) + " ms");
+              });
+#endif
+
+        test ("packed arrays",
+              [&] ()
+              {
+                  ObjectWithArrays o;
+                  expect (o.curve.view ().empty ());
+
+                  const std::vector<float> curve { 0.f, 0.25f, 0.5f, 1.f };
+                  o.curve = curve;
+                  const juce::ValueTree tree { o };
+                  const auto* stored { tree.getPropertyPointer ("curve") };
+                  expect (stored != nullptr && stored->isBinaryData ());
+                  expectEquals (static_cast<int> (stored->getBinaryData ()->getSize ()),
+                                static_cast<int> (curve.size () * sizeof (float)));
+
+                  // views point at the stored data.
+                  const auto view { o.curve.view () };
+                  expectEquals (static_cast<int> (view.size ()), 4);
+                  expect (view.data () == o.curve.view ().data ());
+                  expectEquals (view[3], 1.f);
+                  expect (static_cast<std::vector<float>> (o.curve) == curve);
+
+                  // setting an identical vector doesn't change the property.
+                  int changes { 0 };
+                  o.curve.onPropertyChange ([&changes] (juce::Identifier) { ++changes; });
+                  o.curve = curve;
+                  expectEquals (changes, 0);
+                  o.curve = std::vector<float> { 1.f };
+                  expectEquals (changes, 1);
+
+                  // arrays of vars (e.g. written by other code) are still readable.
+                  juce::ValueTree (o).setProperty ("samples", juce::Array<juce::var> { 1, -2, 3 },
+                                                   nullptr);
+                  expect (static_cast<std::vector<juce::int16>> (o.samples) ==
+                          std::vector<juce::int16> { 1, -2, 3 });
+                  expect (o.samples.view ().empty ());
+
+                  // ...and packed arrays survive each of the save formats.
+                  o.samples = std::vector<juce::int16> { -32768, 0, 32767 };
+                  for (auto format :
+                       { cello::Object::FileFormat::xml, cello::Object::FileFormat::binary,
+                         cello::Object::FileFormat::compact, cello::Object::FileFormat::lz,
+                         cello::Object::FileFormat::json })
+                  {
+                      juce::TemporaryFile tempFile;
+                      const auto file { tempFile.getFile () };
+                      expect (o.save (file, format));
+                      ObjectWithArrays loaded { cello::Object::load (file, format) };
+                      expect (static_cast<std::vector<float>> (loaded.curve) ==
+                              std::vector<float> { 1.f });
+                      expect (static_cast<std::vector<juce::int16>> (loaded.samples) ==
+                              std::vector<juce::int16> { -32768, 0, 32767 });
+                  }
+              });
+
+#if CELLO_RUN_BENCHMARKS
+        test ("benchmark: packed arrays",
+              [&] ()
+              {
+                  constexpr int count { 100000 };
+                  std::vector<float> waveform (count);
+                  for (int i { 0 }; i < count; ++i)
+                      waveform[static_cast<size_t> (i)] = std::sin (static_cast<float> (i) * 0.01f);
+
+                  juce::Array<juce::var> vars;
+                  vars.ensureStorageAllocated (count);
+                  auto start { juce::Time::getMillisecondCounterHiRes () };
+                  for (auto sample : waveform)
+                      vars.add (sample);
+                  juce::ValueTree unpacked { "unpacked" };
+                  unpacked.setProperty ("waveform", std::move (vars), nullptr);
+                  const auto varTime { juce::Time::getMillisecondCounterHiRes () - start };
+
+                  ObjectWithArrays o;
+                  start = juce::Time::getMillisecondCounterHiRes ();
+                  o.curve = waveform;
+                  const auto packedTime { juce::Time::getMillisecondCounterHiRes () - start };
+
+                  float sum { 0.f };
+                  start = juce::Time::getMillisecondCounterHiRes ();
+                  for (auto sample : o.curve.view ())
+                      sum += sample;
+                  const auto viewTime { juce::Time::getMillisecondCounterHiRes () - start };
+
+                  expectEquals (static_cast<int> (o.curve.view ().size ()), count);
+                  logMessage (juce::String (count) + " floats: store as vars " +
+                              juce::String (varTime, 2) + " ms, packed " +
+                              juce::String (packedTime, 2) + " ms; sum through view " +
+                              juce::String (viewTime, 2) + " ms (" + juce::String (sum) +
+                              ")");
+              });
+#endif
+
+        test ("reflection",
+              [&] ()
+              {
+                  static_assert (decltype (voiceFields)::size () == 3);
+                  ReflectedVoice voice;
+                  voice.pan = -0.5f;
+
+                  const auto before { voiceFields.toStruct (voice) };
+                  expectEquals (before.gain, 1.f);
+                  expectEquals (before.pan, -0.5f);
+                  expectEquals (before.note, 60);
+
+                  // only the changed field is written back.
+                  int changes { 0 };
+                  voice.onPropertyChange (voice.getType (),
+                                          [&changes] (juce::Identifier) { ++changes; });
+                  auto after { before };
+                  after.note = 64;
+                  expectEquals (voiceFields.writeChanges (voice, after, before), 1);
+                  expectEquals (changes, 1);
+                  expectEquals (static_cast<int> (voice.note), 64);
+
+                  VoiceData replacement { 0.25f, 0.5f, 64 };
+                  voiceFields.fromStruct (voice, replacement);
+                  expectEquals (changes, 3);
+                  expectEquals (static_cast<float> (voice.gain), 0.25f);
+                  expectEquals (static_cast<float> (voice.pan), 0.5f);
+
+                  VoiceData copy {};
+                  voiceFields.read (voice, copy);
+                  expectEquals (copy.gain, 0.25f);
+                  expectEquals (copy.note, 64);
+              });
+
         test ("variant conversion",
               [&] ()
               {
@@ -176,6 +525,257 @@ public:
                   expectEquals (static_cast<int> (cachedInt), 200);
                   expectEquals (updateCount, 2);
               });
+
+        test ("Realtime value",
+              [this] ()
+              {
+                  ObjectWithOperators obj;
+                  obj.floatVal = 0.5f;
+                  cello::Value<float>::Realtime gain (obj.floatVal);
+                  auto note { obj.intVal.getRealtime () };
+                  expectWithinAbsoluteError (gain.load (), 0.5f, 0.001f);
+                  expectEquals (static_cast<int> (note), 0);
+
+                  // the Value's own callback slot is still available.
+                  int callbackCount { 0 };
+                  obj.floatVal.onPropertyChange ([&callbackCount] (juce::Identifier)
+                                                 { ++callbackCount; });
+                  obj.floatVal = 0.75f;
+                  expectEquals (callbackCount, 1);
+                  expectWithinAbsoluteError (gain.load (), 0.75f, 0.001f);
+
+                  // changes made through a different object sharing the tree
+                  // are mirrored as well, after validation.
+                  obj.intVal.onGet = [] (const int& v) { return v * 2; };
+                  cello::Object other { obj };
+                  other.setattr ("intVal", 21);
+                  expectEquals (note.load (), 42);
+
+                  // other properties don't disturb the mirror.
+                  obj.stringVal = "changed";
+                  expectEquals (note.load (), 42);
+              });
+
+        test ("cached reads",
+              [this] ()
+              {
+                  ObjectWithOperators obj;
+                  int getCount { 0 };
+                  obj.intVal.onGet = [&getCount] (const int& v)
+                  {
+                      ++getCount;
+                      return v;
+                  };
+                  obj.intVal.setCached (true);
+                  expect (obj.intVal.isCached ());
+
+                  // repeated reads only fetch from the tree once.
+                  expectEquals (static_cast<int> (obj.intVal), 0);
+                  expectEquals (static_cast<int> (obj.intVal), 0);
+                  expectEquals (getCount, 1);
+
+                  // setting through the Value, another Object sharing the tree, or
+                  // the tree itself invalidates the cache.
+                  obj.intVal = 10;
+                  expectEquals (static_cast<int> (obj.intVal), 10);
+                  cello::Object other { obj };
+                  other.setattr ("intVal", 20);
+                  expectEquals (static_cast<int> (obj.intVal), 20);
+                  juce::ValueTree (obj).setProperty ("intVal", 30, nullptr);
+                  expectEquals (static_cast<int> (obj.intVal), 30);
+                  expectEquals (getCount, 4);
+
+                  // ...as does a change to any other property (we don't track which
+                  // property changed, only that one did).
+                  obj.floatVal = 2.f;
+                  expectEquals (static_cast<int> (obj.intVal), 30);
+                  expectEquals (getCount, 5);
+
+                  // a value set while excluding our Object from callbacks is seen
+                  // when it's set through the Value.
+                  obj.excludeListener (&obj);
+                  obj.intVal = 40;
+                  obj.excludeListener (nullptr);
+                  expectEquals (static_cast<int> (obj.intVal), 40);
+
+                  obj.intVal.setCached (false);
+                  expectEquals (static_cast<int> (obj.intVal), 40);
+                  expectEquals (static_cast<int> (obj.intVal), 40);
+                  expectEquals (getCount, 8);
+              });
+
+#if CELLO_RUN_BENCHMARKS
+        test ("benchmark: cached reads",
+              [this] ()
+              {
+                  ObjectWithOperators obj;
+                  obj.floatVal = 0.5f;
+                  constexpr int reads { 10000000 };
+
+                  const auto timeReads = [&obj] ()
+                  {
+                      float sum { 0.f };
+                      const auto start { juce::Time::getMillisecondCounterHiRes () };
+                      for (int i { 0 }; i < reads; ++i)
+                          sum += obj.floatVal;
+                      const auto elapsed { juce::Time::getMillisecondCounterHiRes () - start };
+                      return std::make_pair (elapsed, sum);
+                  };
+
+                  const auto uncached { timeReads () };
+                  obj.floatVal.setCached (true);
+                  const auto cached { timeReads () };
+                  expectEquals (cached.second, uncached.second);
+                  logMessage (juce::String (reads) + " reads: uncached " +
+                              juce::String (uncached.first, 1) + " ms, cached " +
+                              juce::String (cached.first, 1) + " ms");
+              });
+#endif
+
+        test ("change detection",
+              [this] ()
+              {
+                  using Detection = cello::ChangeDetection;
+                  ObjectWithOperators obj;
+                  ObjectWithOperators exact;
+                  int callbackCount { 0 };
+                  obj.floatVal.onPropertyChange ([&callbackCount] (juce::Identifier)
+                                                 { ++callbackCount; });
+                  exact.floatVal.onPropertyChange ([&callbackCount] (juce::Identifier)
+                                                   { ++callbackCount; });
+
+                  // floats default to a tolerance of 0.001, everything else to exact.
+                  expect (obj.floatVal.getChangeDetection ().getMode () ==
+                          Detection::Mode::absolute);
+                  expect (obj.intVal.getChangeDetection ().getMode () == Detection::Mode::exact);
+                  obj.floatVal = 0.0005f;
+                  expectEquals (callbackCount, 0);
+
+                  // each Value has its own setting.
+                  exact.floatVal.setChangeDetection (Detection::exact ());
+                  exact.floatVal = 0.0005f;
+                  expectEquals (callbackCount, 1);
+                  obj.floatVal = 0.0009f;
+                  expectEquals (callbackCount, 1);
+
+                  obj.floatVal.setChangeDetection (Detection::absolute (0.1));
+                  obj.floatVal = 0.05f;
+                  expectEquals (callbackCount, 1);
+                  obj.floatVal = 0.2f;
+                  expectEquals (callbackCount, 2);
+
+                  // ulps are relative to the magnitude of the value.
+                  obj.floatVal.setChangeDetection (Detection::ulps (4));
+                  obj.floatVal = 1000.f;
+                  expectEquals (callbackCount, 3);
+                  auto nearby { 1000.f };
+                  for (int i { 0 }; i < 3; ++i)
+                      nearby = std::nextafter (nearby, 2000.f);
+                  obj.floatVal = nearby;
+                  expectEquals (callbackCount, 3);
+                  obj.floatVal = 1000.1f;
+                  expectEquals (callbackCount, 4);
+
+                  expect (Detection::ulpsApart (0.f, -0.f) == 0);
+                  expect (Detection::ulpsApart (1.0, std::nextafter (1.0, 2.0)) == 1);
+                  const auto tiny { std::numeric_limits<float>::denorm_min () };
+                  expect (Detection::ulpsApart (-tiny, tiny) == 2);
+                  expect (Detection::ulpsApart (std::numeric_limits<float>::quiet_NaN (),
+                                                1.f) > 4);
+
+                  // always notifies, whether or not the value changed.
+                  obj.floatVal.setChangeDetection (Detection::always ());
+                  obj.floatVal = 1000.1f;
+                  obj.floatVal = 1000.1f;
+                  expectEquals (callbackCount, 6);
+                  expectWithinAbsoluteError (static_cast<float> (obj.floatVal), 1000.1f,
+                                             0.001f);
+
+                  // a tolerance also applies to integers...
+                  obj.intVal.setChangeDetection (Detection::absolute (2));
+                  obj.intVal = 2;
+                  expectEquals (static_cast<int> (obj.intVal), 0);
+                  obj.intVal = 3;
+                  expectEquals (static_cast<int> (obj.intVal), 3);
+                  // ...but not to other types.
+                  obj.stringVal.setChangeDetection (Detection::absolute (2));
+                  obj.stringVal = "a";
+                  expectEquals (static_cast<juce::String> (obj.stringVal), juce::String ("a"));
+              });
+
+        test ("redundant sets",
+              [this] ()
+              {
+                  ObjectWithCountedValue obj;
+                  auto& reads { juce::VariantConverter<CountedInt>::reads };
+                  reads = 0;
+
+                  // the first set has to read the tree to compare, after that we
+                  // compare against the value we wrote.
+                  const auto generation { obj.getGeneration () };
+                  obj.counted = CountedInt { 5 };
+                  expectEquals (reads, 1);
+                  // each change is counted once.
+                  expectEquals (obj.getGeneration (), generation + 1);
+                  for (int i { 0 }; i < 10; ++i)
+                      obj.counted = CountedInt { 5 };
+                  obj.counted = CountedInt { 6 };
+                  obj.counted = CountedInt { 6 };
+                  obj.counted.update ([] (const CountedInt& c) { return CountedInt { c.value }; });
+                  expectEquals (reads, 1);
+
+                  // a change made to the tree some other way is seen.
+                  juce::ValueTree tree { obj };
+                  tree.setProperty ("counted", 7, nullptr);
+                  obj.counted = CountedInt { 6 };
+                  expectEquals (static_cast<int> (tree["counted"]), 6);
+                  expectEquals (reads, 2);
+
+                  // ...as is one made by a callback while we're setting the value.
+                  obj.counted.onPropertyChange (
+                      [&tree] (juce::Identifier)
+                      {
+                          if (static_cast<int> (tree["counted"]) == 8)
+                              tree.setProperty ("counted", 9, nullptr);
+                      });
+                  obj.counted = CountedInt { 8 };
+                  expectEquals (static_cast<int> (tree["counted"]), 9);
+                  obj.counted = CountedInt { 8 };
+                  expectEquals (static_cast<int> (tree["counted"]), 9);
+                  obj.counted.onPropertyChange (nullptr);
+                  obj.counted = CountedInt { 8 };
+                  expectEquals (static_cast<int> (tree["counted"]), 8);
+              });
+
+#if CELLO_RUN_BENCHMARKS
+        test ("benchmark: redundant sets",
+              [this] ()
+              {
+                  ObjectWithOperators obj;
+                  obj.floatVal = 0.5f;
+                  constexpr int count { 10000000 };
+
+                  float sum { 0.f };
+                  auto start { juce::Time::getMillisecondCounterHiRes () };
+                  for (int i { 0 }; i < count; ++i)
+                      sum += obj.floatVal;
+                  const auto readTime { juce::Time::getMillisecondCounterHiRes () - start };
+
+                  int callbackCount { 0 };
+                  obj.floatVal.onPropertyChange ([&callbackCount] (juce::Identifier)
+                                                 { ++callbackCount; });
+                  start = juce::Time::getMillisecondCounterHiRes ();
+                  for (int i { 0 }; i < count; ++i)
+                      obj.floatVal = 0.5f;
+                  const auto setTime { juce::Time::getMillisecondCounterHiRes () - start };
+
+                  expectEquals (callbackCount, 0);
+                  expectWithinAbsoluteError (sum, 0.5f * count, 0.01f * count);
+                  logMessage (juce::String (count) + " redundant sets: " +
+                              juce::String (setTime, 1) + " ms (" + juce::String (count) +
+                              " reads: " + juce::String (readTime, 1) + " ms)");
+              });
+#endif
     }
 
 private:
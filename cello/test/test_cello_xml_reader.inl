@@ -0,0 +1,137 @@
+/*
+    Copyright (c) 2023 Brett g Porter
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <juce_core/juce_core.h>
+#include <juce_data_structures/juce_data_structures.h>
+
+#include "../cello_xml_reader.h"
+
+namespace
+{
+juce::ValueTree parse (const juce::String& text)
+{
+    juce::MemoryInputStream in { text.toRawUTF8 (), text.getNumBytesAsUTF8 (), false };
+    return cello::XmlTreeReader::read (in);
+}
+} // namespace
+
+class Test_cello_xml_reader : public TestSuite
+{
+public:
+    Test_cello_xml_reader ()
+    : TestSuite ("cello_xml_reader", "cello")
+    {
+    }
+
+    void runTest () override
+    {
+        test ("round trip",
+              [this] ()
+              {
+                  juce::ValueTree root { "root" };
+                  root.setProperty ("text", "<quoted> \"text\" & 'more'\nline two", nullptr);
+                  root.setProperty ("unicode", juce::String::fromUTF8 ("caf\xc3\xa9 \xe2\x99\xab"),
+                                    nullptr);
+                  root.setProperty ("number", 42, nullptr);
+                  const char bytes[] { 0, 1, 2, 3, -1, 'a', 'b' };
+                  root.setProperty ("binary", juce::MemoryBlock { bytes, sizeof (bytes) }, nullptr);
+                  for (int i { 0 }; i < 3; ++i)
+                  {
+                      juce::ValueTree child { "child" };
+                      child.setProperty ("index", i, nullptr);
+                      child.appendChild (juce::ValueTree { "grandchild" }, nullptr);
+                      root.appendChild (child, nullptr);
+                  }
+                  root.appendChild (juce::ValueTree { "empty" }, nullptr);
+
+                  const auto xml { root.toXmlString () };
+                  const auto streamed { parse (xml) };
+                  expect (streamed.isValid ());
+                  // the result must match what juce builds from the same XML.
+                  expect (streamed.isEquivalentTo (juce::ValueTree::fromXml (xml)));
+                  expect (streamed.getProperty ("text") == root.getProperty ("text"));
+                  expect (streamed.getProperty ("unicode") == root.getProperty ("unicode"));
+                  const auto* mb { streamed.getProperty ("binary").getBinaryData () };
+                  expect (mb != nullptr && *mb == juce::MemoryBlock { bytes, sizeof (bytes) });
+                  expectEquals (streamed.getNumChildren (), 4);
+              });
+
+        test ("markup",
+              [this] ()
+              {
+                  const auto tree { parse (
+                      "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                      "<!DOCTYPE root [ <!ELEMENT root ANY> ]>\n"
+                      "<!-- a comment -- with dashes -->\n"
+                      "<root a='single' b = \"&#65;&#x42;&unknown;\">\n"
+                      "  some text<![CDATA[ <notATag/> ]]>\n"
+                      "  <!-- <commented/> -->\n"
+                      "  <child/>\n"
+                      "</root>\n"
+                      "trailing text is ignored") };
+                  expect (tree.hasType ("root"));
+                  expect (tree.getProperty ("a") == "single");
+                  expect (tree.getProperty ("b") == "AB&unknown;");
+                  expectEquals (tree.getNumChildren (), 1);
+                  expect (tree.getChild (0).hasType ("child"));
+              });
+
+        test ("malformed",
+              [this] ()
+              {
+                  expect (!parse ({}).isValid ());
+                  expect (!parse ("no tags").isValid ());
+                  expect (!parse ("<root>").isValid ());
+                  expect (!parse ("<root></other>").isValid ());
+                  expect (!parse ("<root a=1/>").isValid ());
+                  expect (!parse ("<root a=\"1/>").isValid ());
+                  expect (!parse ("<root><child></root>").isValid ());
+                  expect (parse ("<root/>").isValid ());
+              });
+
+        test ("large documents",
+              [this] ()
+              {
+                  // larger than the read buffer, so tags and attributes span refills.
+                  juce::ValueTree root { "root" };
+                  for (int i { 0 }; i < 5000; ++i)
+                  {
+                      juce::ValueTree child { "child" };
+                      child.setProperty ("index", i, nullptr);
+                      child.setProperty ("name", "child number " + juce::String (i), nullptr);
+                      root.appendChild (child, nullptr);
+                  }
+                  const auto xml { root.toXmlString () };
+                  expect (xml.getNumBytesAsUTF8 () > 100 * 1024);
+                  expect (parse (xml).isEquivalentTo (juce::ValueTree::fromXml (xml)));
+
+                  // ...and the zipped format is decompressed as it's read.
+                  juce::MemoryOutputStream zipped;
+                  {
+                      juce::GZIPCompressorOutputStream zipper { zipped };
+                      root.writeToStream (zipper);
+                  }
+                  juce::MemoryInputStream in { zipped.getData (), zipped.getDataSize (), false };
+                  expect (cello::Object::load (in, cello::Object::FileFormat::zipped)
+                              .isEquivalentTo (root));
+              });
+    }
+};
+
+static Test_cello_xml_reader testcello_xml_reader;